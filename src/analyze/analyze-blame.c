@@ -3,8 +3,58 @@
 #include "analyze.h"
 #include "analyze-blame.h"
 #include "analyze-time-data.h"
+#include "bus-error.h"
 #include "format-table.h"
 
+static int add_generator_runtimes(sd_bus *bus, Table *table) {
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_(sd_bus_message_unrefp) sd_bus_message *reply = NULL;
+        const char *path;
+        uint64_t t;
+        int r;
+
+        assert(bus);
+        assert(table);
+
+        r = sd_bus_get_property(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        "/org/freedesktop/systemd1",
+                        "org.freedesktop.systemd1.Manager",
+                        "GeneratorRuntimes",
+                        &error,
+                        &reply,
+                        "a(st)");
+        if (r < 0) {
+                /* Older managers don't record this */
+                log_debug_errno(r, "Failed to get generator runtimes, ignoring: %s", bus_error_message(&error, r));
+                return 0;
+        }
+
+        r = sd_bus_message_enter_container(reply, 'a', "(st)");
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        while ((r = sd_bus_message_read(reply, "(st)", &path, &t)) > 0) {
+                if (t <= 0)
+                        continue;
+
+                r = table_add_many(table,
+                                   TABLE_TIMESPAN_MSEC, t,
+                                   TABLE_PATH, path);
+                if (r < 0)
+                        return table_log_add_error(r);
+        }
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        r = sd_bus_message_exit_container(reply);
+        if (r < 0)
+                return bus_log_parse_error(r);
+
+        return 0;
+}
+
 int verb_blame(int argc, char *argv[], void *userdata) {
         _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
         _cleanup_(unit_times_free_arrayp) UnitTimes *times = NULL;
@@ -59,6 +109,10 @@ int verb_blame(int argc, char *argv[], void *userdata) {
                         return table_log_add_error(r);
         }
 
+        r = add_generator_runtimes(bus, table);
+        if (r < 0)
+                return r;
+
         pager_open(arg_pager_flags);
 
         r = table_print(table, NULL);
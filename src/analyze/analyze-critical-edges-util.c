@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "alloc-util.h"
+#include "analyze-critical-edges-util.h"
+#include "strv.h"
+
+/* This ignores everything except ordering (socket activation, jobs waiting for devices, CPU contention, …),
+ * hence the savings are upper bounds, not promises. */
+
+EdgeNode* edge_node_free(EdgeNode *n) {
+        if (!n)
+                return NULL;
+
+        strv_free(n->after);
+        return mfree(n);
+}
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(edge_node_hash_ops, char, string_hash_func, string_compare_func,
+                                              EdgeNode, edge_node_free);
+
+int edge_node_add(Hashmap **nodes, const char *name, usec_t duration, EdgeNode **ret) {
+        _cleanup_(edge_node_freep) EdgeNode *e = NULL;
+        int r;
+
+        assert(nodes);
+        assert(name);
+
+        e = new(EdgeNode, 1);
+        if (!e)
+                return -ENOMEM;
+
+        *e = (EdgeNode) {
+                .name = name,
+                .duration = duration,
+        };
+
+        r = hashmap_ensure_put(nodes, &edge_node_hash_ops, e->name, e);
+        if (r < 0)
+                return r;
+
+        if (ret)
+                *ret = e;
+
+        TAKE_PTR(e);
+        return 0;
+}
+
+static int simulate(
+                Hashmap *nodes,
+                EdgeNode *n,
+                const CriticalEdge *skip,
+                unsigned generation,
+                EdgeNodeLoadAfter load_after,
+                void *userdata) {
+
+        usec_t start = 0;
+        int r;
+
+        assert(n);
+
+        if (n->generation == generation)
+                return 0;
+        if (n->visiting) /* Ordering cycle, PID1 would have broken it somewhere, ignore this edge */
+                return 0;
+
+        if (!n->after_loaded && load_after) {
+                r = load_after(nodes, n, userdata);
+                if (r < 0)
+                        return r;
+        }
+        n->after_loaded = true;
+
+        n->visiting = true;
+        n->critical = NULL;
+
+        STRV_FOREACH(i, n->after) {
+                EdgeNode *d;
+
+                d = hashmap_get(nodes, *i);
+                if (!d)
+                        continue;
+                if (skip && skip->unit == n && skip->after == d)
+                        continue;
+
+                r = simulate(nodes, d, skip, generation, load_after, userdata);
+                if (r < 0) {
+                        n->visiting = false;
+                        return r;
+                }
+
+                if (d->generation != generation) /* Part of a cycle */
+                        continue;
+
+                if (!n->critical || d->finish > start) {
+                        start = d->finish;
+                        n->critical = d;
+                }
+        }
+
+        n->visiting = false;
+        n->finish = start + n->duration;
+        n->generation = generation;
+        return 0;
+}
+
+int critical_edges_analyze(
+                Hashmap *nodes,
+                EdgeNode *target,
+                EdgeNodeLoadAfter load_after,
+                void *userdata,
+                usec_t *ret_finish,
+                CriticalEdge **ret_edges,
+                size_t *ret_n_edges) {
+
+        _cleanup_free_ CriticalEdge *edges = NULL;
+        unsigned generation = 0;
+        size_t n_edges = 0;
+        usec_t baseline;
+        EdgeNode *n;
+        int r;
+
+        assert(target);
+        assert(ret_finish);
+        assert(ret_edges);
+        assert(ret_n_edges);
+
+        /* Results of earlier runs are not valid anymore */
+        HASHMAP_FOREACH(n, nodes)
+                n->generation = 0;
+
+        r = simulate(nodes, target, NULL, ++generation, load_after, userdata);
+        if (r < 0)
+                return r;
+
+        baseline = target->finish;
+
+        /* Remember the critical path before the following runs overwrite it */
+        for (EdgeNode *i = target; i->critical; i = i->critical) {
+                if (!GREEDY_REALLOC(edges, n_edges + 1))
+                        return -ENOMEM;
+
+                edges[n_edges++] = (CriticalEdge) {
+                        .unit = i,
+                        .after = i->critical,
+                };
+        }
+
+        for (size_t i = 0; i < n_edges; i++) {
+                r = simulate(nodes, target, edges + i, ++generation, load_after, userdata);
+                if (r < 0)
+                        return r;
+
+                edges[i].saving = baseline > target->finish ? baseline - target->finish : 0;
+        }
+
+        *ret_finish = baseline;
+        *ret_edges = TAKE_PTR(edges);
+        *ret_n_edges = n_edges;
+        return 0;
+}
@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <stdbool.h>
+
+#include "hashmap.h"
+#include "time-util.h"
+
+typedef struct EdgeNode EdgeNode;
+
+struct EdgeNode {
+        const char *name;           /* Not owned */
+        usec_t duration;
+        char **after;               /* Only the units that are part of the graph */
+        bool after_loaded;
+
+        /* Simulation state, valid if generation matches the current run */
+        unsigned generation;
+        bool visiting;
+        usec_t finish;
+        EdgeNode *critical;         /* The unit that determined when we could start */
+};
+
+typedef struct CriticalEdge {
+        EdgeNode *unit;
+        EdgeNode *after;
+        usec_t saving;              /* How much earlier the target is reached without this edge */
+} CriticalEdge;
+
+/* Called to fill in n->after when the simulation reaches a node whose after_loaded is not set yet, so that
+ * dependencies only need to be acquired for the units that actually matter. */
+typedef int (*EdgeNodeLoadAfter)(Hashmap *nodes, EdgeNode *n, void *userdata);
+
+EdgeNode* edge_node_free(EdgeNode *n);
+DEFINE_TRIVIAL_CLEANUP_FUNC(EdgeNode*, edge_node_free);
+
+/* Adds a node to the graph, which is a Hashmap of name → EdgeNode owning the nodes */
+int edge_node_add(Hashmap **nodes, const char *name, usec_t duration, EdgeNode **ret);
+
+/* Replays reaching 'target' as if every unit started as soon as all units it is ordered after finished,
+ * and then replays it once more without each edge on the resulting critical path. Returns the time it
+ * took to reach the target, and the edges of the critical path in order, starting at the target. */
+int critical_edges_analyze(
+                Hashmap *nodes,
+                EdgeNode *target,
+                EdgeNodeLoadAfter load_after,
+                void *userdata,
+                usec_t *ret_finish,
+                CriticalEdge **ret_edges,
+                size_t *ret_n_edges);
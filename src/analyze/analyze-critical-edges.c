@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "analyze.h"
+#include "analyze-critical-edges.h"
+#include "analyze-critical-edges-util.h"
+#include "analyze-time-data.h"
+#include "bus-error.h"
+#include "format-table.h"
+#include "hashmap.h"
+#include "special.h"
+#include "strv.h"
+
+/* Replays the boot as if every unit started as soon as all units it is ordered After= were up, using the
+ * time each unit took to start during this boot. Then, for each ordering edge on the resulting critical
+ * path, replays it again without that edge, to estimate how much earlier the target would have been reached
+ * if the edge was dropped or relaxed. See analyze-critical-edges-util.c for the simulation itself. */
+
+static int edge_node_load_after(Hashmap *nodes, EdgeNode *n, void *userdata) {
+        _cleanup_strv_free_ char **deps = NULL;
+        _cleanup_free_ char *path = NULL;
+        sd_bus *bus = ASSERT_PTR(userdata);
+        int r;
+
+        assert(n);
+
+        path = unit_dbus_path_from_name(n->name);
+        if (!path)
+                return log_oom();
+
+        r = bus_get_unit_property_strv(bus, path, "After", &deps);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get After= dependencies of %s: %m", n->name);
+
+        STRV_FOREACH(d, deps)
+                if (hashmap_contains(nodes, *d)) {
+                        r = strv_extend(&n->after, *d);
+                        if (r < 0)
+                                return log_oom();
+                }
+
+        return 0;
+}
+
+static int resolve_unit_id(sd_bus *bus, const char *name, char **ret) {
+        _cleanup_(sd_bus_error_free) sd_bus_error error = SD_BUS_ERROR_NULL;
+        _cleanup_free_ char *path = NULL;
+        int r;
+
+        assert(bus);
+        assert(name);
+        assert(ret);
+
+        /* The unit list only carries primary names, hence resolve aliases such as default.target first */
+
+        path = unit_dbus_path_from_name(name);
+        if (!path)
+                return log_oom();
+
+        r = sd_bus_get_property_string(
+                        bus,
+                        "org.freedesktop.systemd1",
+                        path,
+                        "org.freedesktop.systemd1.Unit",
+                        "Id",
+                        &error,
+                        ret);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get ID of %s: %s", name, bus_error_message(&error, r));
+
+        return 0;
+}
+
+int verb_critical_edges(int argc, char *argv[], void *userdata) {
+        _cleanup_(sd_bus_flush_close_unrefp) sd_bus *bus = NULL;
+        _cleanup_(unit_times_free_arrayp) UnitTimes *times = NULL;
+        _cleanup_hashmap_free_ Hashmap *nodes = NULL;
+        _cleanup_(table_unrefp) Table *table = NULL;
+        _cleanup_free_ CriticalEdge *edges = NULL;
+        _cleanup_free_ char *target = NULL;
+        size_t n_edges = 0;
+        BootTimes *boot;
+        EdgeNode *t;
+        usec_t baseline;
+        TableCell *cell;
+        int n, r;
+
+        r = acquire_bus(&bus, NULL);
+        if (r < 0)
+                return bus_log_connect_error(r, arg_transport);
+
+        n = acquire_time_data(bus, &times);
+        if (n <= 0)
+                return n;
+
+        r = acquire_boot_times(bus, &boot);
+        if (r < 0)
+                return r;
+
+        for (UnitTimes *u = times; u->has_data; u++) {
+                /* Only consider what was started as part of the boot */
+                if (u->activated <= 0 || u->activated > boot->finish_time)
+                        continue;
+
+                r = edge_node_add(&nodes, u->name, u->time, NULL);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to add entry to hashmap: %m");
+        }
+
+        r = resolve_unit_id(bus, argc > 1 ? argv[1] : SPECIAL_DEFAULT_TARGET, &target);
+        if (r < 0)
+                return r;
+
+        t = hashmap_get(nodes, target);
+        if (!t)
+                return log_error_errno(SYNTHETIC_ERRNO(ENOENT),
+                                       "Unit %s was not reached during boot, or has no timing information.", target);
+
+        r = critical_edges_analyze(nodes, t, edge_node_load_after, bus, &baseline, &edges, &n_edges);
+        if (r == -ENOMEM)
+                return log_oom();
+        if (r < 0)
+                return r;
+
+        table = table_new("saving", "unit", "after");
+        if (!table)
+                return log_oom();
+
+        assert_se(cell = table_get_cell(table, 0, 0));
+        r = table_set_align_percent(table, cell, 100);
+        if (r < 0)
+                return r;
+
+        r = table_set_sort(table, (size_t) 0);
+        if (r < 0)
+                return r;
+
+        r = table_set_reverse(table, 0, true);
+        if (r < 0)
+                return r;
+
+        for (size_t i = 0; i < n_edges; i++) {
+                r = table_add_many(table,
+                                   TABLE_TIMESPAN_MSEC, edges[i].saving,
+                                   TABLE_STRING, edges[i].unit->name,
+                                   TABLE_STRING, edges[i].after->name);
+                if (r < 0)
+                        return table_log_add_error(r);
+        }
+
+        pager_open(arg_pager_flags);
+
+        printf("Simulated time to reach %s through After= ordering alone: %s\n"
+               "Estimated saving if a single edge on the critical path is dropped:\n\n",
+               target, FORMAT_TIMESPAN(baseline, USEC_PER_MSEC));
+
+        if (n_edges == 0) {
+                printf("%s is not ordered after any unit that was started during boot.\n", target);
+                return EXIT_SUCCESS;
+        }
+
+        r = table_print(table, NULL);
+        if (r < 0)
+                return r;
+
+        return EXIT_SUCCESS;
+}
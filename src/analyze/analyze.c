@@ -19,6 +19,7 @@
 #include "analyze-cat-config.h"
 #include "analyze-condition.h"
 #include "analyze-critical-chain.h"
+#include "analyze-critical-edges.h"
 #include "analyze-dot.h"
 #include "analyze-dump.h"
 #include "analyze-exit-status.h"
@@ -187,6 +188,8 @@ static int help(int argc, char *argv[], void *userdata) {
                "                             time to init\n"
                "  critical-chain [UNIT...]   Print a tree of the time critical chain\n"
                "                             of units\n"
+               "  critical-edges [UNIT]      Estimate how much each ordering dependency\n"
+               "                             on the critical chain delays the boot\n"
                "  plot                       Output SVG graphic showing service\n"
                "                             initialization\n"
                "  dot [UNIT...]              Output dependency graph in %s format\n"
@@ -548,6 +551,7 @@ static int run(int argc, char *argv[]) {
                 { "time",              VERB_ANY, 1,        VERB_DEFAULT, verb_time              },
                 { "blame",             VERB_ANY, 1,        0,            verb_blame             },
                 { "critical-chain",    VERB_ANY, VERB_ANY, 0,            verb_critical_chain    },
+                { "critical-edges",    VERB_ANY, 2,        0,            verb_critical_edges    },
                 { "plot",              VERB_ANY, 1,        0,            verb_plot              },
                 { "dot",               VERB_ANY, VERB_ANY, 0,            verb_dot               },
                 /* ↓ The following seven verbs are deprecated, from here … ↓ */
@@ -0,0 +1,128 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "analyze-critical-edges-util.h"
+#include "strv.h"
+#include "tests.h"
+
+static EdgeNode* add_node(Hashmap **nodes, const char *name, usec_t duration, char **after) {
+        EdgeNode *n;
+
+        assert_se(edge_node_add(nodes, name, duration, &n) >= 0);
+        assert_se(n->after = strv_copy(after));
+        n->after_loaded = true;
+
+        return n;
+}
+
+static void assert_edge(const CriticalEdge *e, const char *unit, const char *after, usec_t saving) {
+        log_debug("%s → %s: %s", e->unit->name, e->after->name, FORMAT_TIMESPAN(e->saving, 0));
+
+        assert_se(streq(e->unit->name, unit));
+        assert_se(streq(e->after->name, after));
+        assert_se(e->saving == saving);
+}
+
+TEST(critical_path) {
+        _cleanup_hashmap_free_ Hashmap *nodes = NULL;
+        _cleanup_free_ CriticalEdge *edges = NULL;
+        size_t n_edges;
+        usec_t finish;
+        EdgeNode *t;
+
+        /*  a (10) ← b (20) ← d (1)
+         *    ↖ c (5) ←──────┘ */
+        add_node(&nodes, "a", 10, NULL);
+        add_node(&nodes, "b", 20, STRV_MAKE("a"));
+        add_node(&nodes, "c", 5, STRV_MAKE("a"));
+        t = add_node(&nodes, "d", 1, STRV_MAKE("b", "c", "not-in-graph"));
+
+        assert_se(critical_edges_analyze(nodes, t, NULL, NULL, &finish, &edges, &n_edges) >= 0);
+        assert_se(finish == 31);
+        assert_se(n_edges == 2);
+
+        /* Without d → b, d waits for c only, which finishes at 15 */
+        assert_edge(edges + 0, "d", "b", 15);
+        /* Without b → a, b finishes at 20, still later than c */
+        assert_edge(edges + 1, "b", "a", 10);
+
+        /* The results of an earlier run don't leak into the next one */
+        edges = mfree(edges);
+        assert_se(critical_edges_analyze(nodes, t, NULL, NULL, &finish, &edges, &n_edges) >= 0);
+        assert_se(finish == 31);
+        assert_se(n_edges == 2);
+}
+
+TEST(cycle) {
+        _cleanup_hashmap_free_ Hashmap *nodes = NULL;
+        _cleanup_free_ CriticalEdge *edges = NULL;
+        size_t n_edges;
+        usec_t finish;
+        EdgeNode *t;
+
+        /* e and f are ordered after each other, the edge closing the cycle is ignored */
+        add_node(&nodes, "a", 10, NULL);
+        add_node(&nodes, "e", 3, STRV_MAKE("f"));
+        add_node(&nodes, "f", 4, STRV_MAKE("e", "a"));
+        t = add_node(&nodes, "t", 1, STRV_MAKE("e"));
+
+        assert_se(critical_edges_analyze(nodes, t, NULL, NULL, &finish, &edges, &n_edges) >= 0);
+        assert_se(finish == 18);
+        assert_se(n_edges == 3);
+
+        assert_edge(edges + 0, "t", "e", 17);
+        assert_edge(edges + 1, "e", "f", 14);
+        assert_edge(edges + 2, "f", "a", 10);
+}
+
+TEST(no_edges) {
+        _cleanup_hashmap_free_ Hashmap *nodes = NULL;
+        _cleanup_free_ CriticalEdge *edges = NULL;
+        size_t n_edges;
+        usec_t finish;
+        EdgeNode *t;
+
+        add_node(&nodes, "a", 10, NULL);
+        t = add_node(&nodes, "t", 7, STRV_MAKE("not-in-graph"));
+
+        assert_se(critical_edges_analyze(nodes, t, NULL, NULL, &finish, &edges, &n_edges) >= 0);
+        assert_se(finish == 7);
+        assert_se(n_edges == 0);
+}
+
+static int load_after(Hashmap *nodes, EdgeNode *n, void *userdata) {
+        unsigned *n_calls = ASSERT_PTR(userdata);
+
+        (*n_calls)++;
+
+        if (streq(n->name, "b"))
+                return strv_extend(&n->after, "a");
+        if (streq(n->name, "t"))
+                return strv_extend(&n->after, "b");
+
+        return 0;
+}
+
+TEST(load_after) {
+        _cleanup_hashmap_free_ Hashmap *nodes = NULL;
+        _cleanup_free_ CriticalEdge *edges = NULL;
+        unsigned n_calls = 0;
+        size_t n_edges;
+        usec_t finish;
+        EdgeNode *t;
+
+        /* Dependencies are only acquired for the units the simulation reaches, and only once */
+        assert_se(edge_node_add(&nodes, "a", 10, NULL) >= 0);
+        assert_se(edge_node_add(&nodes, "b", 20, NULL) >= 0);
+        assert_se(edge_node_add(&nodes, "unrelated", 20, NULL) >= 0);
+        assert_se(edge_node_add(&nodes, "t", 1, &t) >= 0);
+
+        assert_se(critical_edges_analyze(nodes, t, load_after, &n_calls, &finish, &edges, &n_edges) >= 0);
+        assert_se(n_calls == 3);
+        assert_se(finish == 31);
+        assert_se(n_edges == 2);
+
+        assert_edge(edges + 0, "t", "b", 30);
+        assert_edge(edges + 1, "b", "a", 10);
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -548,7 +548,7 @@ int decompress_startswith(
                 return -EBADMSG;
 }
 
-int compress_stream_xz(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size) {
+int compress_stream_xz(int fdf, int fdt, uint64_t max_bytes, uint64_t max_input_bytes, uint64_t *ret_uncompressed_size) {
 #if HAVE_XZ
         _cleanup_(lzma_end) lzma_stream s = LZMA_STREAM_INIT;
         lzma_ret ret;
@@ -569,21 +569,25 @@ int compress_stream_xz(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncom
                         size_t m = sizeof(buf);
                         ssize_t n;
 
-                        if (max_bytes != UINT64_MAX && (uint64_t) m > max_bytes)
-                                m = (size_t) max_bytes;
+                        if (max_input_bytes != UINT64_MAX && (uint64_t) m > max_input_bytes)
+                                m = (size_t) max_input_bytes;
 
-                        n = read(fdf, buf, m);
-                        if (n < 0)
-                                return -errno;
+                        if (m == 0)
+                                n = 0;
+                        else {
+                                n = read(fdf, buf, m);
+                                if (n < 0)
+                                        return -errno;
+                        }
                         if (n == 0)
                                 action = LZMA_FINISH;
                         else {
                                 s.next_in = buf;
                                 s.avail_in = n;
 
-                                if (max_bytes != UINT64_MAX) {
-                                        assert(max_bytes >= (uint64_t) n);
-                                        max_bytes -= n;
+                                if (max_input_bytes != UINT64_MAX) {
+                                        assert(max_input_bytes >= (uint64_t) n);
+                                        max_input_bytes -= n;
                                 }
                         }
                 }
@@ -604,6 +608,10 @@ int compress_stream_xz(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncom
 
                         n = sizeof(out) - s.avail_out;
 
+                        if (max_bytes != UINT64_MAX && s.total_out > max_bytes)
+                                return log_debug_errno(SYNTHETIC_ERRNO(EFBIG),
+                                                       "Compressed stream longer than %" PRIu64 " bytes", max_bytes);
+
                         k = loop_write(fdt, out, n, false);
                         if (k < 0)
                                 return k;
@@ -627,7 +635,7 @@ int compress_stream_xz(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncom
 
 #define LZ4_BUFSIZE (512*1024u)
 
-int compress_stream_lz4(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size) {
+int compress_stream_lz4(int fdf, int fdt, uint64_t max_bytes, uint64_t max_input_bytes, uint64_t *ret_uncompressed_size) {
 
 #if HAVE_LZ4
         LZ4F_errorCode_t c;
@@ -662,9 +670,15 @@ int compress_stream_lz4(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_unco
         log_debug("Buffer size is %zu bytes, header size %zu bytes.", out_allocsize, n);
 
         for (;;) {
+                size_t m = LZ4_BUFSIZE;
                 ssize_t k;
 
-                k = loop_read(fdf, in_buff, LZ4_BUFSIZE, true);
+                if (max_input_bytes != UINT64_MAX && (uint64_t) m > max_input_bytes - total_in)
+                        m = (size_t) (max_input_bytes - total_in);
+                if (m == 0)
+                        break;
+
+                k = loop_read(fdf, in_buff, m, true);
                 if (k < 0)
                         return k;
                 if (k == 0)
@@ -852,7 +866,7 @@ int decompress_stream_lz4(int in, int out, uint64_t max_bytes) {
 #endif
 }
 
-int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size) {
+int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t max_input_bytes, uint64_t *ret_uncompressed_size) {
 #if HAVE_ZSTD
         _cleanup_(ZSTD_freeCCtxp) ZSTD_CCtx *cctx = NULL;
         _cleanup_free_ void *in_buff = NULL, *out_buff = NULL;
@@ -886,11 +900,19 @@ int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_unc
                         .size = 0,
                         .pos = 0
                 };
+                size_t m = in_allocsize;
                 ssize_t red;
 
-                red = loop_read(fdf, in_buff, in_allocsize, true);
-                if (red < 0)
-                        return red;
+                if (max_input_bytes != UINT64_MAX && (uint64_t) m > max_input_bytes - in_bytes)
+                        m = (size_t) (max_input_bytes - in_bytes);
+
+                if (m == 0)
+                        red = 0;
+                else {
+                        red = loop_read(fdf, in_buff, m, true);
+                        if (red < 0)
+                                return red;
+                }
                 is_last_chunk = red == 0;
 
                 in_bytes += (size_t) red;
@@ -990,11 +1012,19 @@ int decompress_stream_zstd(int fdf, int fdt, uint64_t max_bytes) {
                         .size = 0,
                         .pos = 0
                 };
+                size_t m = in_allocsize;
                 ssize_t red;
 
-                red = loop_read(fdf, in_buff, in_allocsize, true);
-                if (red < 0)
-                        return red;
+                if (max_input_bytes != UINT64_MAX && (uint64_t) m > max_input_bytes - in_bytes)
+                        m = (size_t) (max_input_bytes - in_bytes);
+
+                if (m == 0)
+                        red = 0;
+                else {
+                        red = loop_read(fdf, in_buff, m, true);
+                        if (red < 0)
+                                return red;
+                }
                 if (red == 0)
                         break;
 
@@ -52,9 +52,9 @@ int decompress_startswith(Compression compression,
                           const void *prefix, size_t prefix_len,
                           uint8_t extra);
 
-int compress_stream_xz(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size);
-int compress_stream_lz4(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size);
-int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size);
+int compress_stream_xz(int fdf, int fdt, uint64_t max_bytes, uint64_t max_input_bytes, uint64_t *ret_uncompressed_size);
+int compress_stream_lz4(int fdf, int fdt, uint64_t max_bytes, uint64_t max_input_bytes, uint64_t *ret_uncompressed_size);
+int compress_stream_zstd(int fdf, int fdt, uint64_t max_bytes, uint64_t max_input_bytes, uint64_t *ret_uncompressed_size);
 
 int decompress_stream_xz(int fdf, int fdt, uint64_t max_size);
 int decompress_stream_lz4(int fdf, int fdt, uint64_t max_size);
@@ -83,14 +83,14 @@ static inline int compress_blob_explicit(
                 src, src_size,                                      \
                 dst, dst_alloc_size, dst_size)
 
-static inline int compress_stream(int fdf, int fdt, uint64_t max_bytes, uint64_t *ret_uncompressed_size) {
+static inline int compress_stream(int fdf, int fdt, uint64_t max_bytes, uint64_t max_input_bytes, uint64_t *ret_uncompressed_size) {
         switch (DEFAULT_COMPRESSION) {
         case COMPRESSION_ZSTD:
-                return compress_stream_zstd(fdf, fdt, max_bytes, ret_uncompressed_size);
+                return compress_stream_zstd(fdf, fdt, max_bytes, max_input_bytes, ret_uncompressed_size);
         case COMPRESSION_LZ4:
-                return compress_stream_lz4(fdf, fdt, max_bytes, ret_uncompressed_size);
+                return compress_stream_lz4(fdf, fdt, max_bytes, max_input_bytes, ret_uncompressed_size);
         case COMPRESSION_XZ:
-                return compress_stream_xz(fdf, fdt, max_bytes, ret_uncompressed_size);
+                return compress_stream_xz(fdf, fdt, max_bytes, max_input_bytes, ret_uncompressed_size);
         default:
                 return -EOPNOTSUPP;
         }
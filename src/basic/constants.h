@@ -102,5 +102,7 @@
 #define VARLINK_ADDR_PATH_MANAGED_OOM_SYSTEM "/run/systemd/io.system.ManagedOOM"
 /* Path where systemd-oomd listens for varlink connections from user managers to report changes in ManagedOOM settings. */
 #define VARLINK_ADDR_PATH_MANAGED_OOM_USER "/run/systemd/oom/io.system.ManagedOOM"
+/* Path where PID1 listens for varlink queries about its units. */
+#define VARLINK_ADDR_PATH_MANAGER_SYSTEM "/run/systemd/io.systemd.Manager"
 
 #define KERNEL_BASELINE_VERSION "4.15"
@@ -1594,6 +1594,16 @@ unsigned _hashmap_buckets(HashmapBase *h) {
         return n_buckets(h);
 }
 
+size_t _hashmap_memory_usage(HashmapBase *h) {
+        if (!h)
+                return 0;
+
+        /* Entries are stored inline in the head until the table outgrows the direct buckets, afterwards in a
+         * separately allocated array of buckets and DIBs. Keys and values are owned by the caller. */
+        return hashmap_type_info[h->type].head_size +
+                (h->has_indirect ? malloc_usable_size(h->indirect.storage) : 0);
+}
+
 int _hashmap_merge(Hashmap *h, Hashmap *other) {
         Iterator i;
         unsigned idx;
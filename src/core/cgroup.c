@@ -46,6 +46,9 @@
 
 #define CGROUP_CPU_QUOTA_DEFAULT_PERIOD_USEC ((usec_t) 100 * USEC_PER_MSEC)
 
+/* The number of units whose cgroup ran empty that we process per event loop iteration */
+#define CGROUP_EMPTY_QUEUE_BATCH_MAX 64U
+
 /* Returns the log level to use when cgroup attribute writes fail. When an attribute is missing or we have access
  * problems we downgrade to LOG_DEBUG. This is supposed to be nice to container managers and kernels which want to mask
  * out specific attributes from us. */
@@ -106,14 +109,45 @@ bool unit_has_host_root_cgroup(Unit *u) {
         return unit_has_name(u, SPECIAL_ROOT_SLICE);
 }
 
+static void unit_flush_cgroup_attribute_cache(Unit *u) {
+        assert(u);
+
+        u->cgroup_attribute_cache = hashmap_free(u->cgroup_attribute_cache);
+}
+
+static void unit_update_cgroup_attribute_cache(Unit *u, const char *attribute, const char *value) {
+        _cleanup_free_ char *k = NULL;
+
+        assert(u);
+        assert(attribute);
+
+        free(hashmap_remove2(u->cgroup_attribute_cache, attribute, (void**) &k));
+
+        /* If we fail to remember the value that only means we'll write it again next time */
+        if (value)
+                (void) hashmap_put_strdup(&u->cgroup_attribute_cache, attribute, value);
+}
+
 static int set_attribute_and_warn(Unit *u, const char *controller, const char *attribute, const char *value) {
         int r;
 
+        /* Re-realizing a unit writes all attributes of its controllers again, even if only one of them
+         * changed (or only the controllers of some sibling did), so skip those that are already in place. */
+        if (streq_ptr(hashmap_get(u->cgroup_attribute_cache, attribute), value)) {
+                u->manager->n_cgroup_attribute_writes_skipped++;
+                return 0;
+        }
+
         r = cg_set_attribute(controller, u->cgroup_path, attribute, value);
-        if (r < 0)
+        if (r < 0) {
                 log_unit_full_errno(u, LOG_LEVEL_CGROUP_WRITE(r), r, "Failed to set '%s' attribute on '%s' to '%.*s': %m",
                                     strna(attribute), empty_to_root(u->cgroup_path), (int) strcspn(value, NEWLINE), value);
+                unit_update_cgroup_attribute_cache(u, attribute, NULL);
+                return r;
+        }
 
+        u->manager->n_cgroup_attribute_writes++;
+        unit_update_cgroup_attribute_cache(u, attribute, value);
         return r;
 }
 
@@ -2246,6 +2280,11 @@ static int unit_update_cgroup(
                 return log_unit_error_errno(u, r, "Failed to create cgroup %s: %m", empty_to_root(u->cgroup_path));
         created = r;
 
+        /* A new cgroup, or controllers that are (re-)enabled or disabled, start out with the kernel's
+         * defaults, hence forget what we wrote before. */
+        if (created || u->cgroup_realized_mask != target_mask)
+                unit_flush_cgroup_attribute_cache(u);
+
         if (cg_unified_controller(SYSTEMD_CGROUP_CONTROLLER) > 0) {
                 uint64_t cgroup_id = 0;
 
@@ -2812,6 +2851,8 @@ void unit_release_cgroup(Unit *u) {
         /* Forgets all cgroup details for this cgroup — but does *not* destroy the cgroup. This is hence OK to call
          * when we close down everything for reexecution, where we really want to leave the cgroup in place. */
 
+        unit_flush_cgroup_attribute_cache(u);
+
         if (u->cgroup_path) {
                 (void) hashmap_remove(u->manager->cgroup_unit, u->cgroup_path);
                 u->cgroup_path = mfree(u->cgroup_path);
@@ -2876,6 +2917,8 @@ void unit_prune_cgroup(Unit *u) {
 
         is_root_slice = unit_has_name(u, SPECIAL_ROOT_SLICE);
 
+        unit_flush_cgroup_attribute_cache(u);
+
         r = cg_trim_everywhere(u->manager->cgroup_supported, u->cgroup_path, !is_root_slice);
         if (r < 0)
                 /* One reason we could have failed here is, that the cgroup still contains a process.
@@ -3036,18 +3079,37 @@ int unit_watch_all_pids(Unit *u) {
 
 static int on_cgroup_empty_event(sd_event_source *s, void *userdata) {
         Manager *m = ASSERT_PTR(userdata);
-        Unit *u;
         int r;
 
         assert(s);
 
-        u = m->cgroup_empty_queue;
-        if (!u)
-                return 0;
+        /* When many units run empty at the same time (think of a large number of scopes exiting together)
+         * let's process a bunch of them per event loop iteration, but not all of them, so that other
+         * events get a chance to be dispatched in between. */
+        for (unsigned n = 0; n < CGROUP_EMPTY_QUEUE_BATCH_MAX; n++) {
+                Unit *u;
 
-        assert(u->in_cgroup_empty_queue);
-        u->in_cgroup_empty_queue = false;
-        LIST_REMOVE(cgroup_empty_queue, m->cgroup_empty_queue, u);
+                u = m->cgroup_empty_queue;
+                if (!u)
+                        break;
+
+                assert(u->in_cgroup_empty_queue);
+                u->in_cgroup_empty_queue = false;
+                LIST_REMOVE(cgroup_empty_queue, m->cgroup_empty_queue, u);
+                assert(m->n_cgroup_empty_queued > 0);
+                m->n_cgroup_empty_queued--;
+
+                /* Update state based on OOM kills before we notify about cgroup empty event */
+                (void) unit_check_oom(u);
+                (void) unit_check_oomd_kill(u);
+
+                unit_add_to_gc_queue(u);
+
+                if (UNIT_VTABLE(u)->notify_cgroup_empty)
+                        UNIT_VTABLE(u)->notify_cgroup_empty(u);
+        }
+
+        m->n_cgroup_empty_batches++;
 
         if (m->cgroup_empty_queue) {
                 /* More stuff queued, let's make sure we remain enabled */
@@ -3056,16 +3118,31 @@ static int on_cgroup_empty_event(sd_event_source *s, void *userdata) {
                         log_debug_errno(r, "Failed to reenable cgroup empty event source, ignoring: %m");
         }
 
-        /* Update state based on OOM kills before we notify about cgroup empty event */
-        (void) unit_check_oom(u);
-        (void) unit_check_oomd_kill(u);
+        return 0;
+}
+
+static void unit_enqueue_cgroup_empty(Unit *u) {
+        Manager *m;
+        int r;
 
-        unit_add_to_gc_queue(u);
+        assert(u);
 
-        if (UNIT_VTABLE(u)->notify_cgroup_empty)
-                UNIT_VTABLE(u)->notify_cgroup_empty(u);
+        /* Adds the unit to the cgroup empty queue, after the caller verified that the cgroup is empty */
 
-        return 0;
+        if (u->in_cgroup_empty_queue)
+                return;
+
+        m = u->manager;
+
+        LIST_PREPEND(cgroup_empty_queue, m->cgroup_empty_queue, u);
+        u->in_cgroup_empty_queue = true;
+        m->n_cgroup_empty_queued++;
+        m->n_cgroup_empty_queued_max = MAX(m->n_cgroup_empty_queued_max, m->n_cgroup_empty_queued);
+
+        /* Trigger the defer event */
+        r = sd_event_source_set_enabled(m->cgroup_empty_event_source, SD_EVENT_ONESHOT);
+        if (r < 0)
+                log_debug_errno(r, "Failed to enable cgroup empty event source: %m");
 }
 
 void unit_add_to_cgroup_empty_queue(Unit *u) {
@@ -3105,13 +3182,7 @@ void unit_add_to_cgroup_empty_queue(Unit *u) {
         if (r == 0)
                 return;
 
-        LIST_PREPEND(cgroup_empty_queue, u->manager->cgroup_empty_queue, u);
-        u->in_cgroup_empty_queue = true;
-
-        /* Trigger the defer event */
-        r = sd_event_source_set_enabled(u->manager->cgroup_empty_event_source, SD_EVENT_ONESHOT);
-        if (r < 0)
-                log_debug_errno(r, "Failed to enable cgroup empty event source: %m");
+        unit_enqueue_cgroup_empty(u);
 }
 
 static void unit_remove_from_cgroup_empty_queue(Unit *u) {
@@ -3122,6 +3193,8 @@ static void unit_remove_from_cgroup_empty_queue(Unit *u) {
 
         LIST_REMOVE(cgroup_empty_queue, u->manager->cgroup_empty_queue, u);
         u->in_cgroup_empty_queue = false;
+        assert(u->manager->n_cgroup_empty_queued > 0);
+        u->manager->n_cgroup_empty_queued--;
 }
 
 int unit_check_oomd_kill(Unit *u) {
@@ -3299,7 +3372,9 @@ static int unit_check_cgroup_events(Unit *u) {
                 if (streq(values[0], "1"))
                         unit_remove_from_cgroup_empty_queue(u);
                 else
-                        unit_add_to_cgroup_empty_queue(u);
+                        /* "populated" is exactly what cg_is_empty_recursive() would look at, hence
+                         * don't read the file a second time. */
+                        unit_enqueue_cgroup_empty(u);
         }
 
         /* Disregard freezer state changes due to operations not initiated by us */
@@ -3988,6 +4063,24 @@ static int unit_get_io_accounting_raw(Unit *u, uint64_t ret[static _CGROUP_IO_AC
         return 0;
 }
 
+static bool unit_io_accounting_is_current(Unit *u) {
+        usec_t ts;
+
+        assert(u);
+
+        /* All metrics are parsed from the same io.stat file, and clients typically query all of them at
+         * once (e.g. "systemctl show" gets all properties in one go), which we process in a single event
+         * loop iteration. Hence let's only read the file once per iteration. */
+
+        if (u->io_accounting_timestamp == 0)
+                return false;
+
+        if (sd_event_now(u->manager->event, CLOCK_MONOTONIC, &ts) != 0)
+                return false; /* Event loop not running yet */
+
+        return ts == u->io_accounting_timestamp;
+}
+
 int unit_get_io_accounting(
                 Unit *u,
                 CGroupIOAccountingMetric metric,
@@ -3995,6 +4088,7 @@ int unit_get_io_accounting(
                 uint64_t *ret) {
 
         uint64_t raw[_CGROUP_IO_ACCOUNTING_METRIC_MAX];
+        usec_t ts;
         int r;
 
         /* Retrieve an IO account parameter. This will subtract the counter when the unit was started. */
@@ -4002,7 +4096,7 @@ int unit_get_io_accounting(
         if (!UNIT_CGROUP_BOOL(u, io_accounting))
                 return -ENODATA;
 
-        if (allow_cache && u->io_accounting_last[metric] != UINT64_MAX)
+        if ((allow_cache || unit_io_accounting_is_current(u)) && u->io_accounting_last[metric] != UINT64_MAX)
                 goto done;
 
         r = unit_get_io_accounting_raw(u, raw);
@@ -4019,6 +4113,8 @@ int unit_get_io_accounting(
                         u->io_accounting_last[i] = 0;
         }
 
+        u->io_accounting_timestamp = sd_event_now(u->manager->event, CLOCK_MONOTONIC, &ts) == 0 ? ts : 0;
+
 done:
         if (ret)
                 *ret = u->io_accounting_last[metric];
@@ -4065,6 +4161,7 @@ int unit_reset_io_accounting(Unit *u) {
 
         for (CGroupIOAccountingMetric i = 0; i < _CGROUP_IO_ACCOUNTING_METRIC_MAX; i++)
                 u->io_accounting_last[i] = UINT64_MAX;
+        u->io_accounting_timestamp = 0;
 
         r = unit_get_io_accounting_raw(u, u->io_accounting_base);
         if (r < 0) {
@@ -4103,6 +4200,10 @@ void unit_invalidate_cgroup(Unit *u, CGroupMask m) {
         if (m & (CGROUP_MASK_CPU | CGROUP_MASK_CPUACCT))
                 m |= CGROUP_MASK_CPU | CGROUP_MASK_CPUACCT;
 
+        /* Whoever invalidates the cgroup wants the attributes written again, even if we believe they are
+         * already in place: they might have been changed behind our back in cgroupfs. */
+        unit_flush_cgroup_attribute_cache(u);
+
         if (FLAGS_SET(u->cgroup_invalidated_mask, m)) /* NOP? */
                 return;
 
@@ -1,10 +1,14 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include "core-varlink.h"
+#include "job.h"
 #include "mkdir-label.h"
+#include "path-util.h"
+#include "socket-util.h"
 #include "strv.h"
 #include "user-util.h"
 #include "varlink.h"
+#include "varlink-internal.h"
 
 typedef struct LookupParameters {
         const char *user_name;
@@ -16,11 +20,50 @@ typedef struct LookupParameters {
         const char *service;
 } LookupParameters;
 
+typedef struct ListUnitsParameters {
+        char **states;
+        char **patterns;
+        char **fields;
+} ListUnitsParameters;
+
+typedef struct ListUnitsOperation {
+        Manager *manager;
+        Varlink *link;
+        char **fields;
+
+        /* The units that matched when the call was made. We only keep their names and look them up again
+         * when generating their reply, as they might go away in the meantime. */
+        char **ids;
+        size_t n_ids;
+        size_t next;
+
+        /* The reply for the last unit generated so far. It's only sent once we know whether more follow. */
+        JsonVariant *last;
+
+        sd_event_source *event_source;
+} ListUnitsOperation;
+
+/* Stop generating replies while this much output is queued on a connection, and continue once it drained */
+#define LIST_UNITS_OUTPUT_MAX (1U*1024U*1024U)
+
 static const char* const managed_oom_mode_properties[] = {
         "ManagedOOMSwap",
         "ManagedOOMMemoryPressure",
 };
 
+static const char* const unit_fields[] = {
+        "id",
+        "description",
+        "loadState",
+        "activeState",
+        "subState",
+        "following",
+        "jobId",
+        "jobType",
+        "stateChangeTimestamp",
+        NULL
+};
+
 static int build_user_json(const char *user_name, uid_t uid, JsonVariant **ret) {
         assert(user_name);
         assert(uid_is_valid(uid));
@@ -475,6 +518,232 @@ static int vl_method_get_memberships(Varlink *link, JsonVariant *parameters, Var
         return varlink_error(link, "io.systemd.UserDatabase.NoRecordFound", NULL);
 }
 
+static void list_units_parameters_done(ListUnitsParameters *p) {
+        assert(p);
+
+        p->states = strv_free(p->states);
+        p->patterns = strv_free(p->patterns);
+        p->fields = strv_free(p->fields);
+}
+
+static bool unit_field_wanted(char **fields, const char *field) {
+        return strv_isempty(fields) || strv_contains(fields, field);
+}
+
+static int build_unit_json(Unit *u, char **fields, JsonVariant **ret) {
+        Unit *following;
+
+        assert(u);
+        assert(ret);
+
+        following = unit_following(u);
+
+        return json_build(ret, JSON_BUILD_OBJECT(
+                                   JSON_BUILD_PAIR_CONDITION(unit_field_wanted(fields, "id"), "id", JSON_BUILD_STRING(u->id)),
+                                   JSON_BUILD_PAIR_CONDITION(unit_field_wanted(fields, "description"), "description", JSON_BUILD_STRING(unit_description(u))),
+                                   JSON_BUILD_PAIR_CONDITION(unit_field_wanted(fields, "loadState"), "loadState", JSON_BUILD_STRING(unit_load_state_to_string(u->load_state))),
+                                   JSON_BUILD_PAIR_CONDITION(unit_field_wanted(fields, "activeState"), "activeState", JSON_BUILD_STRING(unit_active_state_to_string(unit_active_state(u)))),
+                                   JSON_BUILD_PAIR_CONDITION(unit_field_wanted(fields, "subState"), "subState", JSON_BUILD_STRING(unit_sub_state_to_string(u))),
+                                   JSON_BUILD_PAIR_CONDITION(following && unit_field_wanted(fields, "following"), "following", JSON_BUILD_STRING(following ? following->id : NULL)),
+                                   JSON_BUILD_PAIR_CONDITION(u->job && unit_field_wanted(fields, "jobId"), "jobId", JSON_BUILD_UNSIGNED(u->job ? u->job->id : 0)),
+                                   JSON_BUILD_PAIR_CONDITION(u->job && unit_field_wanted(fields, "jobType"), "jobType", JSON_BUILD_STRING(u->job ? job_type_to_string(u->job->type) : NULL)),
+                                   JSON_BUILD_PAIR_CONDITION(dual_timestamp_is_set(&u->state_change_timestamp) && unit_field_wanted(fields, "stateChangeTimestamp"),
+                                                             "stateChangeTimestamp", JSON_BUILD_UNSIGNED(u->state_change_timestamp.realtime))));
+}
+
+static bool varlink_on_manager_socket(Manager *m, Varlink *link) {
+        _cleanup_free_ char *address = NULL;
+        int fd;
+
+        assert(m);
+        assert(link);
+
+        /* The userdb and ManagedOOM sockets are served by the same server object, make sure the
+         * io.systemd.Manager interface is only reachable through its own socket. Test runs do not listen on
+         * any of the sockets, whoever drives the server there decides what to expose. */
+
+        if (MANAGER_IS_TEST_RUN(m))
+                return true;
+
+        fd = varlink_get_fd(link);
+        if (fd < 0)
+                return false;
+
+        if (getsockname_pretty(fd, &address) < 0)
+                return false;
+
+        return path_equal(address, VARLINK_ADDR_PATH_MANAGER_SYSTEM);
+}
+
+static ListUnitsOperation* list_units_operation_free(ListUnitsOperation *op) {
+        if (!op)
+                return NULL;
+
+        sd_event_source_disable_unref(op->event_source);
+        varlink_unref(op->link);
+        strv_free(op->fields);
+        strv_free(op->ids);
+        json_variant_unref(op->last);
+
+        return mfree(op);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(ListUnitsOperation*, list_units_operation_free);
+
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(
+                list_units_operation_hash_ops,
+                void, trivial_hash_func, trivial_compare_func,
+                ListUnitsOperation, list_units_operation_free);
+
+static int list_units_operation_dispatch(ListUnitsOperation *op) {
+        int r;
+
+        assert(op);
+
+        /* Generates replies until the output buffer is filled up to LIST_UNITS_OUTPUT_MAX. Returns > 0 if
+         * the final reply has been enqueued, 0 if there's more to do once the output drained. */
+
+        while (op->next < op->n_ids) {
+                size_t size;
+                Unit *u;
+
+                r = varlink_get_output_buffer_size(op->link, &size);
+                if (r < 0)
+                        return r;
+                if (size >= LIST_UNITS_OUTPUT_MAX)
+                        return 0;
+
+                u = manager_get_unit(op->manager, op->ids[op->next++]);
+                if (!u)
+                        continue;
+
+                if (op->last) {
+                        r = varlink_notify(op->link, op->last);
+                        if (r < 0)
+                                return r;
+
+                        op->last = json_variant_unref(op->last);
+                }
+
+                r = build_unit_json(u, op->fields, &op->last);
+                if (r < 0)
+                        return r;
+        }
+
+        if (!op->last)
+                r = varlink_error(op->link, "io.systemd.Manager.NoSuchUnit", NULL);
+        else
+                r = varlink_reply(op->link, op->last);
+        if (r < 0)
+                return r;
+
+        return 1;
+}
+
+static int on_list_units_output(sd_event_source *s, void *userdata) {
+        ListUnitsOperation *op = ASSERT_PTR(userdata);
+        Manager *m = op->manager;
+        int r;
+
+        r = list_units_operation_dispatch(op);
+        if (r == 0)
+                return 0;
+        if (r < 0) {
+                log_debug_errno(r, "Failed to generate io.systemd.Manager.ListUnits() replies: %m");
+                (void) varlink_error_errno(op->link, r);
+        }
+
+        list_units_operation_free(hashmap_remove(m->varlink_list_units, op->link));
+        return 0;
+}
+
+static int vl_method_list_units(Varlink *link, JsonVariant *parameters, VarlinkMethodFlags flags, void *userdata) {
+
+        static const JsonDispatch dispatch_table[] = {
+                { "states",   JSON_VARIANT_ARRAY, json_dispatch_strv, offsetof(ListUnitsParameters, states),   0 },
+                { "patterns", JSON_VARIANT_ARRAY, json_dispatch_strv, offsetof(ListUnitsParameters, patterns), 0 },
+                { "fields",   JSON_VARIANT_ARRAY, json_dispatch_strv, offsetof(ListUnitsParameters, fields),   0 },
+                {}
+        };
+
+        _cleanup_(list_units_parameters_done) ListUnitsParameters p = {};
+        _cleanup_(list_units_operation_freep) ListUnitsOperation *op = NULL;
+        Manager *m = ASSERT_PTR(userdata);
+        const char *k;
+        Unit *u;
+        int r;
+
+        assert(link);
+        assert(parameters);
+
+        if (!varlink_on_manager_socket(m, link))
+                return varlink_errorb(link, VARLINK_ERROR_METHOD_NOT_FOUND,
+                                      JSON_BUILD_OBJECT(JSON_BUILD_PAIR("method", JSON_BUILD_CONST_STRING("io.systemd.Manager.ListUnits"))));
+
+        /* Anyone can call this method, like ListUnitsByPatterns() on the bus. It returns the same
+         * information, one unit per reply, with the fields to include selectable by the caller. As there
+         * might be a lot of units, the replies are not all generated at once, but only as fast as the
+         * client reads them, see list_units_operation_dispatch(). */
+
+        r = json_dispatch(parameters, dispatch_table, NULL, 0, &p);
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(f, p.fields)
+                if (!strv_contains((char**) unit_fields, *f))
+                        return varlink_error_invalid_parameter(link, JSON_VARIANT_STRING_CONST("fields"));
+
+        if (!FLAGS_SET(flags, VARLINK_METHOD_MORE))
+                return varlink_error(link, VARLINK_ERROR_EXPECTED_MORE, NULL);
+
+        op = new(ListUnitsOperation, 1);
+        if (!op)
+                return -ENOMEM;
+
+        *op = (ListUnitsOperation) {
+                .manager = m,
+                .link = varlink_ref(link),
+                .fields = TAKE_PTR(p.fields),
+        };
+
+        HASHMAP_FOREACH_KEY(u, k, m->units) {
+                if (k != u->id)
+                        continue;
+
+                if (!strv_isempty(p.states) &&
+                    !strv_contains(p.states, unit_load_state_to_string(u->load_state)) &&
+                    !strv_contains(p.states, unit_active_state_to_string(unit_active_state(u))) &&
+                    !strv_contains(p.states, unit_sub_state_to_string(u)))
+                        continue;
+
+                if (!strv_fnmatch_or_empty(p.patterns, u->id, FNM_NOESCAPE))
+                        continue;
+
+                r = strv_extend_with_size(&op->ids, &op->n_ids, u->id);
+                if (r < 0)
+                        return r;
+        }
+
+        r = list_units_operation_dispatch(op);
+        if (r != 0)
+                return r < 0 ? r : 0;
+
+        /* Continue whenever something happened on the event loop, i.e. also after the connection was
+         * written to. */
+        r = sd_event_add_post(m->event, &op->event_source, on_list_units_output, op);
+        if (r < 0)
+                return r;
+
+        (void) sd_event_source_set_description(op->event_source, "varlink-list-units");
+
+        r = hashmap_ensure_put(&m->varlink_list_units, &list_units_operation_hash_ops, link, op);
+        if (r < 0)
+                return r;
+
+        TAKE_PTR(op);
+        return 0;
+}
+
 static void vl_disconnect(VarlinkServer *s, Varlink *link, void *userdata) {
         Manager *m = ASSERT_PTR(userdata);
 
@@ -483,6 +752,35 @@ static void vl_disconnect(VarlinkServer *s, Varlink *link, void *userdata) {
 
         if (link == m->managed_oom_varlink)
                 m->managed_oom_varlink = varlink_unref(link);
+
+        list_units_operation_free(hashmap_remove(m->varlink_list_units, link));
+}
+
+static int manager_varlink_listen_system(VarlinkServer *s) {
+        static const char *const addresses[] = {
+                "/run/systemd/userdb/io.systemd.DynamicUser",
+                VARLINK_ADDR_PATH_MANAGED_OOM_SYSTEM,
+                VARLINK_ADDR_PATH_MANAGER_SYSTEM,
+        };
+        int r;
+
+        assert(s);
+
+        /* A server deserialized from an older version of us might lack some of the sockets, hence only bind
+         * to the ones that are missing. */
+
+        (void) mkdir_p_label("/run/systemd/userdb", 0755);
+
+        for (size_t i = 0; i < ELEMENTSOF(addresses); i++) {
+                if (varlink_server_contains_socket(s, addresses[i]))
+                        continue;
+
+                r = varlink_server_listen_address(s, addresses[i], 0666);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to bind to varlink socket %s: %m", addresses[i]);
+        }
+
+        return 0;
 }
 
 static int manager_varlink_init_system(Manager *m) {
@@ -491,8 +789,15 @@ static int manager_varlink_init_system(Manager *m) {
 
         assert(m);
 
-        if (m->varlink_server)
+        if (m->varlink_server) {
+                if (MANAGER_IS_SYSTEM(m) && !MANAGER_IS_TEST_RUN(m)) {
+                        r = manager_varlink_listen_system(m->varlink_server);
+                        if (r < 0)
+                                return r;
+                }
+
                 return 1;
+        }
 
         if (!MANAGER_IS_SYSTEM(m))
                 return 0;
@@ -502,15 +807,9 @@ static int manager_varlink_init_system(Manager *m) {
                 return log_error_errno(r, "Failed to set up varlink server: %m");
 
         if (!MANAGER_IS_TEST_RUN(m)) {
-                (void) mkdir_p_label("/run/systemd/userdb", 0755);
-
-                r = varlink_server_listen_address(s, "/run/systemd/userdb/io.systemd.DynamicUser", 0666);
-                if (r < 0)
-                        return log_error_errno(r, "Failed to bind to varlink socket: %m");
-
-                r = varlink_server_listen_address(s, VARLINK_ADDR_PATH_MANAGED_OOM_SYSTEM, 0666);
+                r = manager_varlink_listen_system(s);
                 if (r < 0)
-                        return log_error_errno(r, "Failed to bind to varlink socket: %m");
+                        return r;
         }
 
         r = varlink_server_attach_event(s, m->event, SD_EVENT_PRIORITY_NORMAL);
@@ -600,7 +899,8 @@ int manager_setup_varlink_server(Manager *m, VarlinkServer **ret) {
                         "io.systemd.UserDatabase.GetUserRecord",  vl_method_get_user_record,
                         "io.systemd.UserDatabase.GetGroupRecord", vl_method_get_group_record,
                         "io.systemd.UserDatabase.GetMemberships", vl_method_get_memberships,
-                        "io.systemd.ManagedOOM.SubscribeManagedOOMCGroups",  vl_method_subscribe_managed_oom_cgroups);
+                        "io.systemd.ManagedOOM.SubscribeManagedOOMCGroups",  vl_method_subscribe_managed_oom_cgroups,
+                        "io.systemd.Manager.ListUnits", vl_method_list_units);
         if (r < 0)
                 return log_debug_errno(r, "Failed to register varlink methods: %m");
 
@@ -625,6 +925,7 @@ void manager_varlink_done(Manager *m) {
          * installed (vl_disconnect() above) to be called, where we will unref it too. */
         varlink_close_unref(TAKE_PTR(m->managed_oom_varlink));
 
+        m->varlink_list_units = hashmap_free(m->varlink_list_units);
         m->varlink_server = varlink_server_unref(m->varlink_server);
         m->managed_oom_varlink = varlink_close_unref(m->managed_oom_varlink);
 }
@@ -1499,6 +1499,7 @@ int bus_property_get_exec_ex_command_list(
 
 static char *exec_command_flags_to_exec_chars(ExecCommandFlags flags) {
         return strjoin(FLAGS_SET(flags, EXEC_COMMAND_IGNORE_FAILURE)   ? "-" : "",
+                       FLAGS_SET(flags, EXEC_COMMAND_PARALLEL)         ? "&" : "",
                        FLAGS_SET(flags, EXEC_COMMAND_NO_ENV_EXPAND)    ? ":" : "",
                        FLAGS_SET(flags, EXEC_COMMAND_FULLY_PRIVILEGED) ? "+" : "",
                        FLAGS_SET(flags, EXEC_COMMAND_NO_SETUID)        ? "!" : "",
@@ -1638,6 +1638,7 @@ void bus_unit_send_change_signal(Unit *u) {
         if (r < 0)
                 log_unit_debug_errno(u, r, "Failed to send unit change signal for %s: %m", u->id);
 
+        u->manager->n_dbus_unit_signals_sent++;
         u->sent_dbus_new_signal = true;
 }
 
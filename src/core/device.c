@@ -108,6 +108,9 @@ static int device_set_sysfs(Device *d, const char *sysfs) {
         d->sysfs = TAKE_PTR(copy);
         unit_add_to_dbus_queue(UNIT(d));
 
+        /* Template instances in SYSTEMD_WANTS= are derived from the sysfs path, hence parse it again */
+        d->wants_property_raw = mfree(d->wants_property_raw);
+
         return 0;
 }
 
@@ -137,6 +140,7 @@ static void device_done(Unit *u) {
         device_unset_sysfs(d);
         d->deserialized_sysfs = mfree(d->deserialized_sysfs);
         d->wants_property = strv_free(d->wants_property);
+        d->wants_property_raw = mfree(d->wants_property_raw);
         d->path = mfree(d->path);
 }
 
@@ -532,25 +536,20 @@ static int device_update_description(Unit *u, sd_device *dev, const char *path)
         return 0;
 }
 
-static int device_add_udev_wants(Unit *u, sd_device *dev) {
-        _cleanup_strv_free_ char **added = NULL;
-        const char *wants, *property;
+static int device_parse_udev_wants(Unit *u, const char *property, const char *wants, char ***ret) {
+        _cleanup_strv_free_ char **names = NULL;
         Device *d = DEVICE(u);
         int r;
 
         assert(d);
-        assert(dev);
-
-        property = MANAGER_IS_USER(u->manager) ? "SYSTEMD_USER_WANTS" : "SYSTEMD_WANTS";
-
-        r = sd_device_get_property_value(dev, property, &wants);
-        if (r < 0)
-                return 0;
+        assert(property);
+        assert(wants);
+        assert(ret);
 
-        for (;;) {
+        for (const char *p = wants;;) {
                 _cleanup_free_ char *word = NULL, *k = NULL;
 
-                r = extract_first_word(&wants, &word, NULL, EXTRACT_UNQUOTE);
+                r = extract_first_word(&p, &word, NULL, EXTRACT_UNQUOTE);
                 if (r == 0)
                         break;
                 if (r == -ENOMEM)
@@ -579,13 +578,46 @@ static int device_add_udev_wants(Unit *u, sd_device *dev) {
                                 return log_unit_error_errno(u, r, "Failed to mangle unit name \"%s\": %m", word);
                 }
 
-                r = unit_add_dependency_by_name(u, UNIT_WANTS, k, true, UNIT_DEPENDENCY_UDEV);
+                r = strv_consume(&names, TAKE_PTR(k));
                 if (r < 0)
-                        return log_unit_error_errno(u, r, "Failed to add Wants= dependency: %m");
+                        return log_oom();
+        }
 
-                r = strv_consume(&added, TAKE_PTR(k));
-                if (r < 0)
+        *ret = TAKE_PTR(names);
+        return 0;
+}
+
+static int device_add_udev_wants(Unit *u, sd_device *dev) {
+        _cleanup_strv_free_ char **added = NULL;
+        const char *wants, *property;
+        Device *d = DEVICE(u);
+        int r;
+
+        assert(d);
+        assert(dev);
+
+        property = MANAGER_IS_USER(u->manager) ? "SYSTEMD_USER_WANTS" : "SYSTEMD_WANTS";
+
+        r = sd_device_get_property_value(dev, property, &wants);
+        if (r < 0)
+                return 0;
+
+        /* Every change uevent brings the same property again, and during coldplug many devices are
+         * processed repeatedly. Reuse the unit names from last time if the value didn't change. */
+        if (d->wants_property_raw && streq(d->wants_property_raw, wants)) {
+                added = strv_copy(d->wants_property);
+                if (!added)
                         return log_oom();
+        } else {
+                r = device_parse_udev_wants(u, property, wants, &added);
+                if (r < 0)
+                        return r;
+        }
+
+        STRV_FOREACH(i, added) {
+                r = unit_add_dependency_by_name(u, UNIT_WANTS, *i, true, UNIT_DEPENDENCY_UDEV);
+                if (r < 0)
+                        return log_unit_error_errno(u, r, "Failed to add Wants= dependency: %m");
         }
 
         if (d->state != DEVICE_DEAD)
@@ -615,7 +647,13 @@ static int device_add_udev_wants(Unit *u, sd_device *dev) {
                                 log_unit_warning_errno(u, r, "Failed to enqueue SYSTEMD_WANTS= job, ignoring: %s", bus_error_message(&error, r));
                 }
 
-        return strv_free_and_replace(d->wants_property, added);
+        strv_free_and_replace(d->wants_property, added);
+
+        r = free_and_strdup(&d->wants_property_raw, wants);
+        if (r < 0)
+                return log_oom();
+
+        return 0;
 }
 
 static bool device_is_bound_by_mounts(Device *d, sd_device *dev) {
@@ -1009,6 +1047,7 @@ static void device_shutdown(Manager *m) {
 
 static void device_enumerate(Manager *m) {
         _cleanup_(sd_device_enumerator_unrefp) sd_device_enumerator *e = NULL;
+        _cleanup_set_free_ Set *ready_units = NULL, *not_ready_units = NULL;
         sd_device *dev;
         int r;
 
@@ -1058,9 +1097,12 @@ static void device_enumerate(Manager *m) {
         }
 
         FOREACH_DEVICE(e, dev) {
-                _cleanup_set_free_ Set *ready_units = NULL, *not_ready_units = NULL;
                 Device *d;
 
+                /* Reuse the sets for all devices, there may be thousands of them */
+                set_clear(ready_units);
+                set_clear(not_ready_units);
+
                 if (device_setup_units(m, dev, &ready_units, &not_ready_units) < 0)
                         continue;
 
@@ -34,6 +34,8 @@ struct Device {
 
         /* The SYSTEMD_WANTS udev property for this device the last time we saw it */
         char **wants_property;
+        /* The unparsed property value wants_property was generated from */
+        char *wants_property_raw;
 };
 
 extern const UnitVTable device_vtable;
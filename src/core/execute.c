@@ -3,6 +3,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <sched.h>
 #include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
@@ -319,6 +320,41 @@ static int connect_journal_socket(
         return r;
 }
 
+static int logger_header(
+                const Unit *unit,
+                const ExecContext *context,
+                const ExecParameters *params,
+                ExecOutput output,
+                const char *ident,
+                char **ret) {
+
+        assert(context);
+        assert(params);
+        assert(ident);
+        assert(ret);
+
+        /* The header journald expects on a stdout stream before the actual log data */
+
+        if (asprintf(ret,
+                     "%s\n"
+                     "%s\n"
+                     "%i\n"
+                     "%i\n"
+                     "%i\n"
+                     "%i\n"
+                     "%i\n",
+                     context->syslog_identifier ?: ident,
+                     params->flags & EXEC_PASS_LOG_UNIT ? unit->id : "",
+                     context->syslog_priority,
+                     !!context->syslog_level_prefix,
+                     false,
+                     is_kmsg_output(output),
+                     is_terminal_output(output)) < 0)
+                return -ENOMEM;
+
+        return 0;
+}
+
 static int connect_logger_as(
                 const Unit *unit,
                 const ExecContext *context,
@@ -330,6 +366,7 @@ static int connect_logger_as(
                 gid_t gid) {
 
         _cleanup_close_ int fd = -EBADF;
+        _cleanup_free_ char *header = NULL;
         int r;
 
         assert(context);
@@ -338,6 +375,10 @@ static int connect_logger_as(
         assert(ident);
         assert(nfd >= 0);
 
+        r = logger_header(unit, context, params, output, ident, &header);
+        if (r < 0)
+                return r;
+
         fd = socket(AF_UNIX, SOCK_STREAM, 0);
         if (fd < 0)
                 return -errno;
@@ -351,22 +392,9 @@ static int connect_logger_as(
 
         (void) fd_inc_sndbuf(fd, SNDBUF_SIZE);
 
-        if (dprintf(fd,
-                "%s\n"
-                "%s\n"
-                "%i\n"
-                "%i\n"
-                "%i\n"
-                "%i\n"
-                "%i\n",
-                context->syslog_identifier ?: ident,
-                params->flags & EXEC_PASS_LOG_UNIT ? unit->id : "",
-                context->syslog_priority,
-                !!context->syslog_level_prefix,
-                false,
-                is_kmsg_output(output),
-                is_terminal_output(output)) < 0)
-                return -errno;
+        r = loop_write(fd, header, strlen(header), false);
+        if (r < 0)
+                return r;
 
         return move_fd(TAKE_FD(fd), nfd, false);
 }
@@ -1428,16 +1456,9 @@ static bool context_has_syscall_logs(const ExecContext *c) {
                 !hashmap_isempty(c->syscall_log);
 }
 
-static bool context_has_no_new_privileges(const ExecContext *c) {
+static bool context_has_seccomp(const ExecContext *c) {
         assert(c);
 
-        if (c->no_new_privileges)
-                return true;
-
-        if (have_effective_cap(CAP_SYS_ADMIN) > 0) /* if we are privileged, we don't need NNP */
-                return false;
-
-        /* We need NNP if we have any form of seccomp and are unprivileged */
         return c->lock_personality ||
                 c->memory_deny_write_execute ||
                 c->private_devices ||
@@ -1455,6 +1476,19 @@ static bool context_has_no_new_privileges(const ExecContext *c) {
                 context_has_syscall_logs(c);
 }
 
+static bool context_has_no_new_privileges(const ExecContext *c) {
+        assert(c);
+
+        if (c->no_new_privileges)
+                return true;
+
+        if (have_effective_cap(CAP_SYS_ADMIN) > 0) /* if we are privileged, we don't need NNP */
+                return false;
+
+        /* We need NNP if we have any form of seccomp and are unprivileged */
+        return context_has_seccomp(c);
+}
+
 static bool exec_context_has_credentials(const ExecContext *context) {
 
         assert(context);
@@ -1474,8 +1508,52 @@ static bool skip_seccomp_unavailable(const Unit* u, const char* msg) {
         return true;
 }
 
+static void syscall_filter_actions(const ExecContext *c, uint32_t *ret_default_action, uint32_t *ret_action) {
+        uint32_t negative_action;
+
+        assert(c);
+        assert(ret_default_action);
+        assert(ret_action);
+
+        negative_action = c->syscall_errno == SECCOMP_ERROR_NUMBER_KILL ? scmp_act_kill_process() : SCMP_ACT_ERRNO(c->syscall_errno);
+
+        if (c->syscall_allow_list) {
+                *ret_default_action = negative_action;
+                *ret_action = SCMP_ACT_ALLOW;
+        } else {
+                *ret_default_action = SCMP_ACT_ALLOW;
+                *ret_action = negative_action;
+        }
+}
+
+static void exec_context_update_syscall_filter_cache(const Unit *u, ExecContext *c) {
+        uint32_t default_action, action;
+        int r;
+
+        assert(u);
+        assert(c);
+
+        /* Compile the system call filter once in the manager, instead of in every forked child. The cached
+         * programs are dropped whenever the filter changes. Not used when seccomp logging is requested,
+         * since that requires flags that can only be passed to seccomp() while loading. */
+
+        if (!context_has_syscall_filters(c) || !is_seccomp_available() ||
+            getenv_bool("SYSTEMD_LOG_SECCOMP") > 0) {
+                c->syscall_filter_cache = seccomp_filter_cache_free(c->syscall_filter_cache);
+                return;
+        }
+
+        syscall_filter_actions(c, &default_action, &action);
+
+        r = seccomp_filter_cache_update(&c->syscall_filter_cache, default_action, c->syscall_filter, action);
+        if (r < 0)
+                log_unit_debug_errno(u, r, "Failed to precompile system call filter, compiling it in the child instead: %m");
+        else if (r > 0)
+                log_unit_debug(u, "Precompiled system call filter.");
+}
+
 static int apply_syscall_filter(const Unit* u, const ExecContext *c, bool needs_ambient_hack) {
-        uint32_t negative_action, default_action, action;
+        uint32_t default_action, action;
         int r;
 
         assert(u);
@@ -1487,15 +1565,11 @@ static int apply_syscall_filter(const Unit* u, const ExecContext *c, bool needs_
         if (skip_seccomp_unavailable(u, "SystemCallFilter="))
                 return 0;
 
-        negative_action = c->syscall_errno == SECCOMP_ERROR_NUMBER_KILL ? scmp_act_kill_process() : SCMP_ACT_ERRNO(c->syscall_errno);
+        /* The ambient hack extends the filter, so the precompiled programs don't match it anymore. */
+        if (c->syscall_filter_cache && !needs_ambient_hack)
+                return seccomp_filter_cache_load(c->syscall_filter_cache);
 
-        if (c->syscall_allow_list) {
-                default_action = negative_action;
-                action = SCMP_ACT_ALLOW;
-        } else {
-                default_action = SCMP_ACT_ALLOW;
-                action = negative_action;
-        }
+        syscall_filter_actions(c, &default_action, &action);
 
         if (needs_ambient_hack) {
                 r = seccomp_filter_set_add(c->syscall_filter, c->syscall_allow_list, syscall_filter_sets + SYSCALL_FILTER_SET_SETUID);
@@ -5177,10 +5251,707 @@ static int exec_child(
 
 static int exec_context_load_environment(const Unit *unit, const ExecContext *c, char ***l);
 static int exec_context_named_iofds(const ExecContext *c, const ExecParameters *p, int named_iofds[static 3]);
+static bool exec_context_may_touch_tty(const ExecContext *ec);
+
+/* The child of exec_spawn_vfork() shares our address space and runs on a stack of its own until it calls
+ * execve() or exits, while we are suspended. Hence it may only make system calls: no memory allocation, no
+ * logging, no changes to global state. Everything else is prepared by the parent beforehand, and only
+ * commands that need nothing beyond that take this path, see exec_spawn_may_vfork(). */
+
+#define EXEC_VFORK_STACK_SIZE (256U * 1024U)
+
+/* Stands in for the values only known in the child. Long enough for any PID and for "dev:ino". */
+#define EXEC_VFORK_PLACEHOLDER "################################################"
+assert_cc(STRLEN(EXEC_VFORK_PLACEHOLDER) >= 2 * DECIMAL_STR_MAX(uint64_t));
+
+typedef enum ExecVforkOutput {
+        EXEC_VFORK_OUTPUT_KEEP,
+        EXEC_VFORK_OUTPUT_NULL,
+        EXEC_VFORK_OUTPUT_JOURNAL,
+        EXEC_VFORK_OUTPUT_STDOUT,
+} ExecVforkOutput;
+
+typedef struct ExecVforkChild {
+        const Unit *unit;
+        const ExecContext *context;
+        const ExecParameters *params;
+        bool needs_sandboxing;
+
+        const int *fds;
+        size_t n_socket_fds;
+        size_t n_storage_fds;
+        int cgroup_fd;
+
+        ExecVforkOutput output[3];
+        char *logger_header[3];
+
+        int executable_fd;
+        const char *executable;
+        char **argv;
+        char **env;
+        char *env_pid[3];             /* values of $LISTEN_PID, $WATCHDOG_PID, $SYSTEMD_EXEC_PID */
+        char *env_journal_stream;     /* the whole "JOURNAL_STREAM=…" entry */
+
+        /* Set by the child */
+        bool env_journal_stream_dropped;
+        int journal_error;
+        int exit_status;
+        int error;
+} ExecVforkChild;
+
+static char *exec_vfork_format_u64(char *p, uint64_t u) {
+        char buf[DECIMAL_STR_MAX(uint64_t)];
+        size_t n = 0;
+
+        /* snprintf() is not safe to call in the child, hence format by hand. Returns the end of the string. */
+
+        do {
+                buf[n++] = '0' + u % 10;
+                u /= 10;
+        } while (u > 0);
+
+        while (n > 0)
+                *(p++) = buf[--n];
+        *p = 0;
+
+        return p;
+}
+
+static int exec_vfork_connect_logger(const ExecVforkChild *c, int fileno) {
+        _cleanup_close_ int fd = -EBADF;
+        int r;
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+                return -errno;
+
+        r = connect_journal_socket(fd, /* log_namespace= */ NULL, UID_INVALID, GID_INVALID);
+        if (r < 0)
+                return r;
+
+        if (shutdown(fd, SHUT_RD) < 0)
+                return -errno;
+
+        (void) fd_inc_sndbuf(fd, SNDBUF_SIZE);
+
+        r = loop_write(fd, c->logger_header[fileno], strlen(c->logger_header[fileno]), false);
+        if (r < 0)
+                return r;
+
+        return move_fd(TAKE_FD(fd), fileno, false);
+}
+
+static int exec_vfork_setup_output(ExecVforkChild *c, int fileno, struct stat *journal_stream) {
+        int r;
+
+        switch (c->output[fileno]) {
+
+        case EXEC_VFORK_OUTPUT_KEEP:
+                return 0;
+
+        case EXEC_VFORK_OUTPUT_NULL:
+                return open_null_as(O_WRONLY, fileno);
+
+        case EXEC_VFORK_OUTPUT_STDOUT:
+                return RET_NERRNO(dup2(STDOUT_FILENO, fileno));
+
+        case EXEC_VFORK_OUTPUT_JOURNAL:
+                r = exec_vfork_connect_logger(c, fileno);
+                if (r < 0) {
+                        /* Like setup_output() continue without, the parent logs about this */
+                        c->journal_error = r;
+                        return open_null_as(O_WRONLY, fileno);
+                }
+
+                /* Like setup_output(), stderr wins if both are connected */
+                (void) fstat(fileno, journal_stream);
+                return 0;
+
+        default:
+                assert_not_reached();
+        }
+}
+
+static void exec_vfork_patch_environment(ExecVforkChild *c, const struct stat *journal_stream) {
+        pid_t pid;
+
+        /* getpid_cached() would return the parent's PID here */
+        pid = raw_getpid();
+
+        for (size_t i = 0; i < ELEMENTSOF(c->env_pid); i++)
+                if (c->env_pid[i])
+                        exec_vfork_format_u64(c->env_pid[i], pid);
+
+        if (!c->env_journal_stream)
+                return;
+
+        if (journal_stream->st_ino != 0) {
+                char *p;
+
+                p = exec_vfork_format_u64(c->env_journal_stream + STRLEN("JOURNAL_STREAM="), journal_stream->st_dev);
+                *(p++) = ':';
+                exec_vfork_format_u64(p, journal_stream->st_ino);
+                return;
+        }
+
+        /* Not connected to the journal after all, drop the entry again. The parent frees it. */
+        for (char **e = c->env; *e; e++)
+                if (*e == c->env_journal_stream) {
+                        for (; *e; e++)
+                                e[0] = e[1];
+
+                        c->env_journal_stream_dropped = true;
+                        break;
+                }
+}
+
+static int exec_vfork_setup_keyring(const ExecVforkChild *c) {
+        const sd_id128_t *invocation_id = &c->unit->invocation_id;
+        key_serial_t key;
+
+        /* Same as setup_keyring(), minus the identity changes and the logging */
+
+        if (c->context->keyring_mode == EXEC_KEYRING_INHERIT)
+                return 0;
+
+        if (keyctl(KEYCTL_JOIN_SESSION_KEYRING, 0, 0, 0, 0) == -1) {
+                if (errno == ENOSYS || ERRNO_IS_PRIVILEGE(errno) || errno == EDQUOT)
+                        return 0;
+
+                return -errno;
+        }
+
+        if (c->context->keyring_mode == EXEC_KEYRING_SHARED &&
+            keyctl(KEYCTL_LINK, KEY_SPEC_USER_KEYRING, KEY_SPEC_SESSION_KEYRING, 0, 0) < 0)
+                return -errno;
+
+        if (sd_id128_is_null(*invocation_id))
+                return 0;
+
+        key = add_key("user", "invocation_id", invocation_id, sizeof(*invocation_id), KEY_SPEC_SESSION_KEYRING);
+        if (key == -1)
+                return 0;
+
+        if (keyctl(KEYCTL_SETPERM, key,
+                   KEY_POS_VIEW|KEY_POS_READ|KEY_POS_SEARCH|
+                   KEY_USR_VIEW|KEY_USR_READ|KEY_USR_SEARCH, 0, 0) < 0)
+                return -errno;
+
+        return 0;
+}
+
+static int exec_vfork_close_fds(int keep[], size_t n) {
+        int from = 3;
+
+        /* close_all_fds() may allocate memory, hence sort the (short) list by hand and close the gaps
+         * between the fds to keep. */
+
+        for (size_t i = 1; i < n; i++)
+                for (size_t j = i; j > 0 && keep[j - 1] > keep[j]; j--)
+                        SWAP_TWO(keep[j - 1], keep[j]);
+
+        for (size_t i = 0; i < n; i++) {
+                if (keep[i] > from && close_range(from, keep[i] - 1, 0) < 0)
+                        goto fallback;
+
+                from = MAX(from, keep[i] + 1);
+        }
+
+        if (close_range(from, -1, 0) < 0)
+                goto fallback;
+
+        return 0;
+
+fallback:
+        if (!ERRNO_IS_NOT_SUPPORTED(errno) && !ERRNO_IS_PRIVILEGE(errno))
+                return -errno;
+
+        return close_all_fds_without_malloc(keep, n);
+}
+
+static int exec_vfork_child_run(ExecVforkChild *c) {
+        size_t n_fds = c->n_socket_fds + c->n_storage_fds, n_keep_fds;
+        int fds[n_fds + 1], keep_fds[n_fds + 2], exec_fd, executable_fd, r;
+        struct stat journal_stream = {};
+
+        /* All signals are blocked, and our handlers must never run in here since they'd operate on the
+         * parent's state, hence reset them before unblocking. */
+        for (int sig = 1; sig < _NSIG; sig++) {
+                static const struct sigaction sa_default = {
+                        .sa_handler = SIG_DFL,
+                        .sa_flags = SA_RESTART,
+                };
+                struct sigaction sa;
+
+                if (IN_SET(sig, SIGKILL, SIGSTOP))
+                        continue;
+
+                if (sigaction(sig, NULL, &sa) < 0 || sa.sa_handler == SIG_DFL || sa.sa_handler == SIG_IGN)
+                        continue;
+
+                (void) sigaction(sig, &sa_default, NULL);
+        }
+
+        (void) default_signals(SIGNALS_CRASH_HANDLER,
+                               SIGNALS_IGNORE);
+
+        if (c->context->ignore_sigpipe)
+                (void) ignore_signals(SIGPIPE);
+
+        r = reset_signal_mask();
+        if (r < 0) {
+                c->exit_status = EXIT_SIGNAL_MASK;
+                return r;
+        }
+
+        /* shift_fds() modifies the array, work on a copy of the parent's */
+        memcpy_safe(fds, c->fds, n_fds * sizeof(int));
+        memcpy_safe(keep_fds, fds, n_fds * sizeof(int));
+        n_keep_fds = n_fds;
+
+        r = add_shifted_fd(keep_fds, ELEMENTSOF(keep_fds), &n_keep_fds, c->params->exec_fd, &exec_fd);
+        if (r >= 0)
+                r = add_shifted_fd(keep_fds, ELEMENTSOF(keep_fds), &n_keep_fds, c->executable_fd, &executable_fd);
+        if (r < 0) {
+                c->exit_status = EXIT_FDS;
+                return r;
+        }
+
+        if (!c->context->same_pgrp && setsid() < 0) {
+                c->exit_status = EXIT_SETSID;
+                return -errno;
+        }
+
+        /* Journald looks at the cgroup of its peer, hence move there before connecting */
+        if (c->cgroup_fd >= 0 && write(c->cgroup_fd, "0", 1) < 0) {
+                c->exit_status = EXIT_CGROUP;
+                return -errno;
+        }
+
+        r = open_null_as(O_RDONLY, STDIN_FILENO);
+        if (r < 0) {
+                c->exit_status = EXIT_STDIN;
+                return r;
+        }
+
+        r = exec_vfork_setup_output(c, STDOUT_FILENO, &journal_stream);
+        if (r < 0) {
+                c->exit_status = EXIT_STDOUT;
+                return r;
+        }
+
+        r = exec_vfork_setup_output(c, STDERR_FILENO, &journal_stream);
+        if (r < 0) {
+                c->exit_status = EXIT_STDERR;
+                return r;
+        }
+
+        exec_vfork_patch_environment(c, &journal_stream);
+
+        (void) umask(c->context->umask);
+
+        r = exec_vfork_setup_keyring(c);
+        if (r < 0) {
+                c->exit_status = EXIT_KEYRING;
+                return r;
+        }
+
+        if (c->needs_sandboxing) {
+                int which_failed;
+
+                r = setrlimit_closest_all((const struct rlimit* const *) c->context->rlimit, &which_failed);
+                if (r < 0) {
+                        c->exit_status = EXIT_LIMITS;
+                        return r;
+                }
+        }
+
+        r = exec_vfork_close_fds(keep_fds, n_keep_fds);
+        if (r >= 0)
+                r = shift_fds(fds, n_fds);
+        if (r >= 0)
+                r = flags_fds(fds, c->n_socket_fds, c->n_storage_fds, c->context->non_blocking);
+        if (r < 0) {
+                c->exit_status = EXIT_FDS;
+                return r;
+        }
+
+        r = apply_working_directory(c->context, c->params, /* home= */ NULL, &c->exit_status);
+        if (r < 0)
+                return r;
+
+        if (exec_fd >= 0) {
+                uint8_t hot = 1;
+
+                if (write(exec_fd, &hot, sizeof(hot)) < 0) {
+                        c->exit_status = EXIT_EXEC;
+                        return -errno;
+                }
+        }
+
+        r = fexecve_or_execve(executable_fd, c->executable, c->argv, c->env);
+
+        if (exec_fd >= 0) {
+                uint8_t hot = 0;
+
+                if (write(exec_fd, &hot, sizeof(hot)) < 0) {
+                        c->exit_status = EXIT_EXEC;
+                        return -errno;
+                }
+        }
+
+        c->exit_status = EXIT_EXEC;
+        return r;
+}
+
+static int exec_vfork_child(void *userdata) {
+        ExecVforkChild *c = ASSERT_PTR(userdata);
+
+        c->error = exec_vfork_child_run(c);
+        _exit(c->exit_status);
+}
+
+static bool have_inherited_capabilities(void) {
+        _cleanup_cap_free_ cap_t caps = NULL;
+
+        /* exec_child() clears the inheritable and ambient sets, which the vfork() child doesn't do */
+
+        caps = cap_get_proc();
+        if (!caps)
+                return true;
+
+        for (unsigned i = 0; i <= cap_last_cap(); i++) {
+                cap_flag_value_t v;
+
+                if (cap_get_flag(caps, (cap_value_t) i, CAP_INHERITABLE, &v) < 0 || v == CAP_SET)
+                        return true;
+
+                if (ambient_capabilities_supported() &&
+                    prctl(PR_CAP_AMBIENT, PR_CAP_AMBIENT_IS_SET, i, 0, 0) > 0)
+                        return true;
+        }
+
+        return false;
+}
+
+static bool exec_spawn_may_vfork(
+                Unit *unit,
+                const ExecCommand *command,
+                const ExecContext *context,
+                const ExecParameters *params,
+                ExecRuntime *runtime,
+                int socket_fd) {
+
+        int r;
+
+        /* Returns true if exec_child() would do nothing for this command that the child of
+         * exec_spawn_vfork() can't do as well. */
+
+        r = getenv_bool("SYSTEMD_EXEC_VFORK");
+        if (r == 0)
+                return false;
+        if (r < 0 && r != -ENXIO)
+                log_debug_errno(r, "Failed to parse $SYSTEMD_EXEC_VFORK, ignoring: %m");
+
+        if (socket_fd >= 0 ||
+            params->stdin_fd >= 0 || params->stdout_fd >= 0 || params->stderr_fd >= 0 ||
+            params->idle_pipe ||
+            unit_shall_confirm_spawn(unit))
+                return false;
+
+        if (context->user || context->group || context->dynamic_user ||
+            !strv_isempty(context->supplementary_groups) || context->pam_name)
+                return false;
+
+        if (context->working_directory_home || context->root_directory || context->root_image ||
+            !strv_isempty(context->exec_search_path))
+                return false;
+
+        if (context->std_input != EXEC_INPUT_NULL ||
+            !IN_SET(context->std_output, EXEC_OUTPUT_INHERIT, EXEC_OUTPUT_NULL, EXEC_OUTPUT_JOURNAL, EXEC_OUTPUT_KMSG) ||
+            !IN_SET(context->std_error, EXEC_OUTPUT_INHERIT, EXEC_OUTPUT_NULL, EXEC_OUTPUT_JOURNAL, EXEC_OUTPUT_KMSG) ||
+            exec_context_may_touch_tty(context) ||
+            context->utmp_id)
+                return false;
+
+        if (context->oom_score_adjust_set || context->coredump_filter_set || context->nice_set ||
+            context->cpu_sched_set || context->cpu_affinity_from_numa || context->cpu_set.set ||
+            mpol_is_valid(numa_policy_get_type(&context->numa_policy)) ||
+            context->ioprio_set || context->timer_slack_nsec != NSEC_INFINITY ||
+            context->personality != PERSONALITY_INVALID)
+                return false;
+
+        if (context->private_network || context->network_namespace_path ||
+            context->private_ipc || context->ipc_namespace_path ||
+            context->private_users ||
+            exec_needs_mount_namespace(context, params, runtime) ||
+            exec_context_has_credentials(context))
+                return false;
+
+        for (ExecDirectoryType t = 0; t < _EXEC_DIRECTORY_TYPE_MAX; t++)
+                if (context->directories[t].n_items > 0)
+                        return false;
+
+        /* On the legacy hierarchies cg_attach_everywhere() does more than writing cgroup.procs */
+        if (params->cgroup_path && cg_all_unified() <= 0)
+                return false;
+
+#if HAVE_LIBBPF
+        if (unit->manager->restrict_fs)
+                return false;
+#endif
+
+        if (!(params->flags & EXEC_APPLY_SANDBOXING) || (command->flags & EXEC_COMMAND_FULLY_PRIVILEGED))
+                return true;
+
+        if ((command->flags & EXEC_COMMAND_AMBIENT_MAGIC) && !ambient_capabilities_supported())
+                return false;
+
+#if HAVE_SELINUX
+        if (mac_selinux_use())
+                return false;
+#endif
+#if ENABLE_SMACK
+        if (mac_smack_use())
+                return false;
+#endif
+#if HAVE_APPARMOR
+        if (mac_apparmor_use())
+                return false;
+#endif
+
+        /* Sandboxing that would be a no-op given our own credentials is fine */
+        return cap_test_all(context->capability_bounding_set) &&
+                context->capability_ambient_set == 0 &&
+                !have_inherited_capabilities() &&
+                prctl(PR_GET_SECUREBITS) == context->secure_bits &&
+                !context_has_no_new_privileges(context) &&
+                !context_has_seccomp(context) &&
+                !exec_context_restrict_filesystems_set(context);
+}
+
+static void log_spawn_failure(const Unit *unit, const ExecCommand *command, int exit_status, int error) {
+        const char *status;
+
+        status = exit_status_to_string(exit_status, EXIT_STATUS_LIBC | EXIT_STATUS_SYSTEMD);
+
+        log_unit_struct_errno(unit, LOG_ERR, error,
+                              "MESSAGE_ID=" SD_MESSAGE_SPAWN_FAILED_STR,
+                              LOG_UNIT_INVOCATION_ID(unit),
+                              LOG_UNIT_MESSAGE(unit, "Failed at step %s spawning %s: %m",
+                                               status, command->path),
+                              "EXECUTABLE=%s", command->path);
+}
+
+static int exec_spawn_vfork(
+                const Unit *unit,
+                const ExecCommand *command,
+                const ExecContext *context,
+                const ExecParameters *params,
+                const int *fds,
+                size_t n_socket_fds,
+                size_t n_storage_fds,
+                char **files_env,
+                pid_t *ret) {
+
+        static const char *const pid_env[] = { "LISTEN_PID", "WATCHDOG_PID", "SYSTEMD_EXEC_PID" };
+        _cleanup_strv_free_ char **our_env = NULL, **pass_env = NULL, **accum_env = NULL, **replaced_argv = NULL;
+        _cleanup_free_ char *executable = NULL, *stdout_header = NULL, *stderr_header = NULL;
+        _cleanup_close_ int executable_fd = -EBADF, cgroup_fd = -EBADF;
+        ExecOutput o = context->std_output, e = context->std_error;
+        ExecVforkChild c = {
+                .unit = unit,
+                .context = context,
+                .params = params,
+                .needs_sandboxing = (params->flags & EXEC_APPLY_SANDBOXING) && !(command->flags & EXEC_COMMAND_FULLY_PRIVILEGED),
+                .fds = fds,
+                .n_socket_fds = n_socket_fds,
+                .n_storage_fds = n_storage_fds,
+                .cgroup_fd = -EBADF,
+                .exit_status = EXIT_SUCCESS,
+        };
+        sigset_t all, saved;
+        void *stack;
+        pid_t pid;
+        int r;
+
+        /* Returns 0 if the command shall be forked off the usual way after all, > 0 if spawned */
+
+        /* Let exec_child() report a missing executable, with all the usual details */
+        r = find_executable_full(command->path, /* root= */ NULL, /* exec_search_path= */ NULL, false, &executable, &executable_fd);
+        if (r < 0)
+                return 0;
+
+        /* stdin is /dev/null, hence exec_child() would inherit our stdout and stderr, except in PID 1 */
+        if (o == EXEC_OUTPUT_INHERIT)
+                c.output[STDOUT_FILENO] = getpid_cached() == 1 ? EXEC_VFORK_OUTPUT_NULL : EXEC_VFORK_OUTPUT_KEEP;
+        else
+                c.output[STDOUT_FILENO] = o == EXEC_OUTPUT_NULL ? EXEC_VFORK_OUTPUT_NULL : EXEC_VFORK_OUTPUT_JOURNAL;
+
+        if (e == EXEC_OUTPUT_INHERIT && o == EXEC_OUTPUT_INHERIT && getpid_cached() != 1)
+                c.output[STDERR_FILENO] = EXEC_VFORK_OUTPUT_KEEP;
+        else if (can_inherit_stderr_from_stdout(context, o, e))
+                c.output[STDERR_FILENO] = EXEC_VFORK_OUTPUT_STDOUT;
+        else
+                c.output[STDERR_FILENO] = e == EXEC_OUTPUT_NULL ? EXEC_VFORK_OUTPUT_NULL : EXEC_VFORK_OUTPUT_JOURNAL;
+
+        if (c.output[STDOUT_FILENO] == EXEC_VFORK_OUTPUT_JOURNAL) {
+                r = logger_header(unit, context, params, o, basename(command->path), &stdout_header);
+                if (r < 0)
+                        return r;
+                c.logger_header[STDOUT_FILENO] = stdout_header;
+        }
+
+        if (c.output[STDERR_FILENO] == EXEC_VFORK_OUTPUT_JOURNAL) {
+                r = logger_header(unit, context, params, e, basename(command->path), &stderr_header);
+                if (r < 0)
+                        return r;
+                c.logger_header[STDERR_FILENO] = stderr_header;
+        }
+
+        r = build_environment(unit, context, params, n_socket_fds + n_storage_fds,
+                              /* home= */ NULL, /* username= */ NULL, /* shell= */ NULL,
+                              /* journal_stream_dev= */ 0, /* journal_stream_ino= */ 0,
+                              &our_env);
+        if (r < 0)
+                return r;
+
+        for (size_t i = 0; i < ELEMENTSOF(pid_env); i++)
+                if (strv_env_get(our_env, pid_env[i])) {
+                        r = strv_env_assign(&our_env, pid_env[i], EXEC_VFORK_PLACEHOLDER);
+                        if (r < 0)
+                                return r;
+                }
+
+        if (c.output[STDOUT_FILENO] == EXEC_VFORK_OUTPUT_JOURNAL ||
+            c.output[STDERR_FILENO] == EXEC_VFORK_OUTPUT_JOURNAL) {
+                r = strv_env_assign(&our_env, "JOURNAL_STREAM", EXEC_VFORK_PLACEHOLDER);
+                if (r < 0)
+                        return r;
+        }
+
+        r = build_pass_environment(context, &pass_env);
+        if (r < 0)
+                return r;
+
+        accum_env = strv_env_merge(params->environment,
+                                   our_env,
+                                   pass_env,
+                                   context->environment,
+                                   files_env);
+        if (!accum_env)
+                return -ENOMEM;
+        accum_env = strv_env_clean(accum_env);
+
+        if (!strv_isempty(context->unset_environment)) {
+                char **ee;
+
+                ee = strv_env_delete(accum_env, 1, context->unset_environment);
+                if (!ee)
+                        return -ENOMEM;
+
+                strv_free_and_replace(accum_env, ee);
+        }
+
+        if (!FLAGS_SET(command->flags, EXEC_COMMAND_NO_ENV_EXPAND)) {
+                replaced_argv = replace_env_argv(command->argv, accum_env);
+                if (!replaced_argv)
+                        return -ENOMEM;
+                c.argv = replaced_argv;
+        } else
+                c.argv = command->argv;
+
+        /* The placeholders are filled in by the child, only in the environment block */
+        STRV_FOREACH(a, c.argv)
+                if (strstr(*a, EXEC_VFORK_PLACEHOLDER))
+                        return 0;
+
+        for (size_t i = 0; i < ELEMENTSOF(pid_env); i++) {
+                char *v = strv_env_get(accum_env, pid_env[i]);
+
+                if (streq_ptr(v, EXEC_VFORK_PLACEHOLDER))
+                        c.env_pid[i] = v;
+        }
+
+        c.env_journal_stream = strv_env_get(accum_env, "JOURNAL_STREAM");
+        if (streq_ptr(c.env_journal_stream, EXEC_VFORK_PLACEHOLDER))
+                c.env_journal_stream -= STRLEN("JOURNAL_STREAM=");
+        else
+                c.env_journal_stream = NULL;
+
+        c.env = accum_env;
+        c.executable = executable;
+        c.executable_fd = executable_fd;
+
+        if (params->cgroup_path) {
+                _cleanup_free_ char *p = NULL, *procs = NULL;
+
+                r = exec_parameters_get_cgroup_path(params, &p);
+                if (r < 0)
+                        return r;
+
+                r = cg_get_path(SYSTEMD_CGROUP_CONTROLLER, p, "cgroup.procs", &procs);
+                if (r < 0)
+                        return r;
+
+                cgroup_fd = open(procs, O_WRONLY|O_CLOEXEC|O_NOCTTY);
+                if (cgroup_fd < 0)
+                        return 0;
+
+                c.cgroup_fd = cgroup_fd;
+        }
+
+        if (DEBUG_LOGGING) {
+                _cleanup_free_ char *line = NULL;
+
+                line = quote_command_line(c.argv, SHELL_ESCAPE_EMPTY);
+                if (!line)
+                        return -ENOMEM;
+
+                log_unit_struct(unit, LOG_DEBUG,
+                                "EXECUTABLE=%s", executable,
+                                LOG_UNIT_MESSAGE(unit, "Executing: %s", line));
+        }
+
+        stack = mmap(NULL, EXEC_VFORK_STACK_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_STACK, -1, 0);
+        if (stack == MAP_FAILED)
+                return -errno;
+
+        /* Our signal handlers must not run in the child, it resets them before unblocking signals again */
+        assert_se(sigfillset(&all) >= 0);
+        assert_se(sigprocmask(SIG_SETMASK, &all, &saved) >= 0);
+
+        pid = clone(exec_vfork_child,
+#ifdef __hppa__
+                    stack,
+#else
+                    (uint8_t*) stack + EXEC_VFORK_STACK_SIZE,
+#endif
+                    CLONE_VM|CLONE_VFORK|SIGCHLD, &c);
+        r = pid < 0 ? -errno : 0;
+
+        assert_se(sigprocmask(SIG_SETMASK, &saved, NULL) >= 0);
+        (void) munmap(stack, EXEC_VFORK_STACK_SIZE);
+
+        if (c.env_journal_stream_dropped)
+                free(c.env_journal_stream);
+
+        if (r < 0)
+                return r;
+
+        if (c.journal_error < 0)
+                log_unit_warning_errno(unit, c.journal_error, "Failed to connect stdout or stderr to the journal socket, ignoring: %m");
+
+        if (c.error < 0)
+                log_spawn_failure(unit, command, c.exit_status, c.error);
+
+        *ret = pid;
+        return 1;
+}
 
 int exec_spawn(Unit *unit,
                ExecCommand *command,
-               const ExecContext *context,
+               ExecContext *context,
                const ExecParameters *params,
                ExecRuntime *runtime,
                DynamicCreds *dcreds,
@@ -5226,21 +5997,29 @@ int exec_spawn(Unit *unit,
         if (r < 0)
                 return log_unit_error_errno(unit, r, "Failed to load environment files: %m");
 
-        line = quote_command_line(command->argv, SHELL_ESCAPE_EMPTY);
-        if (!line)
-                return log_oom();
-
         /* Fork with up-to-date SELinux label database, so the child inherits the up-to-date db
            and, until the next SELinux policy changes, we save further reloads in future children. */
         mac_selinux_maybe_reload();
 
-        log_unit_struct(unit, LOG_DEBUG,
-                        LOG_UNIT_MESSAGE(unit, "About to execute %s", line),
-                        "EXECUTABLE=%s", command->path, /* We won't know the real executable path until we create
-                                                           the mount namespace in the child, but we want to log
-                                                           from the parent, so we need to use the (possibly
-                                                           inaccurate) path here. */
-                        LOG_UNIT_INVOCATION_ID(unit));
+#if HAVE_SECCOMP
+        exec_context_update_syscall_filter_cache(unit, context);
+#endif
+
+        /* Quoting the command line is not free, and we only need it for a debug message, hence skip it
+         * when starting many services with debug logging off. */
+        if (log_get_max_level() >= LOG_DEBUG && unit_log_level_test(unit, LOG_DEBUG)) {
+                line = quote_command_line(command->argv, SHELL_ESCAPE_EMPTY);
+                if (!line)
+                        return log_oom();
+
+                log_unit_struct(unit, LOG_DEBUG,
+                                LOG_UNIT_MESSAGE(unit, "About to execute %s", line),
+                                "EXECUTABLE=%s", command->path, /* We won't know the real executable path until we create
+                                                                   the mount namespace in the child, but we want to log
+                                                                   from the parent, so we need to use the (possibly
+                                                                   inaccurate) path here. */
+                                LOG_UNIT_INVOCATION_ID(unit));
+        }
 
         if (params->cgroup_path) {
                 r = exec_parameters_get_cgroup_path(params, &subcgroup_path);
@@ -5258,7 +6037,14 @@ int exec_spawn(Unit *unit,
                 }
         }
 
-        pid = fork();
+        /* Most commands need none of the sandboxing and credential changes of exec_child(), spawn those
+         * with vfork() semantics, which doesn't copy our page tables. */
+        r = exec_spawn_may_vfork(unit, command, context, params, runtime, socket_fd) ?
+                exec_spawn_vfork(unit, command, context, params, fds, n_socket_fds, n_storage_fds, files_env, &pid) : 0;
+        if (r < 0)
+                return log_unit_error_errno(unit, r, "Failed to spawn %s: %m", command->path);
+        if (r == 0)
+                pid = fork();
         if (pid < 0)
                 return log_unit_error_errno(unit, errno, "Failed to fork: %m");
 
@@ -5280,18 +6066,8 @@ int exec_spawn(Unit *unit,
                                unit->manager->user_lookup_fds[1],
                                &exit_status);
 
-                if (r < 0) {
-                        const char *status =
-                                exit_status_to_string(exit_status,
-                                                      EXIT_STATUS_LIBC | EXIT_STATUS_SYSTEMD);
-
-                        log_unit_struct_errno(unit, LOG_ERR, r,
-                                              "MESSAGE_ID=" SD_MESSAGE_SPAWN_FAILED_STR,
-                                              LOG_UNIT_INVOCATION_ID(unit),
-                                              LOG_UNIT_MESSAGE(unit, "Failed at step %s spawning %s: %m",
-                                                               status, command->path),
-                                              "EXECUTABLE=%s", command->path);
-                }
+                if (r < 0)
+                        log_spawn_failure(unit, command, exit_status, r);
 
                 _exit(exit_status);
         }
@@ -5399,6 +6175,9 @@ void exec_context_done(ExecContext *c) {
         c->restrict_filesystems = set_free(c->restrict_filesystems);
 
         c->syscall_filter = hashmap_free(c->syscall_filter);
+#if HAVE_SECCOMP
+        c->syscall_filter_cache = seccomp_filter_cache_free(c->syscall_filter_cache);
+#endif
         c->syscall_archs = set_free(c->syscall_archs);
         c->address_families = set_free(c->address_families);
 
@@ -335,6 +335,7 @@ struct ExecContext {
         Set *syscall_archs;
         int syscall_errno;
         bool syscall_allow_list:1;
+        struct SeccompFilterCache *syscall_filter_cache; /* BPF compiled from syscall_filter, shared by all children */
 
         Hashmap *syscall_log;
         bool syscall_log_allow_list:1; /* Log listed system calls */
@@ -434,7 +435,7 @@ struct ExecParameters {
 
 int exec_spawn(Unit *unit,
                ExecCommand *command,
-               const ExecContext *context,
+               ExecContext *context,
                const ExecParameters *exec_params,
                ExecRuntime *runtime,
                DynamicCreds *dynamic_creds,
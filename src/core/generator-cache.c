@@ -0,0 +1,480 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "copy.h"
+#include "env-util.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "fs-util.h"
+#include "generator-cache.h"
+#include "hexdecoct.h"
+#include "log.h"
+#include "mkdir.h"
+#include "path-util.h"
+#include "process-util.h"
+#include "recurse-dir.h"
+#include "rm-rf.h"
+#include "sha256.h"
+#include "string-util.h"
+#include "strv.h"
+
+static const char* const output_subdirs[] = {
+        "normal",
+        "early",
+        "late",
+};
+
+static void hash_string(struct sha256_ctx *ctx, const char *s) {
+        /* Include the NUL byte, so that "ab" "c" and "a" "bc" differ */
+        sha256_process_bytes(s, strlen(s) + 1, ctx);
+}
+
+static int hash_file(struct sha256_ctx *ctx, int dir_fd, const char *path) {
+        _cleanup_free_ char *contents = NULL;
+        size_t size;
+        int r;
+
+        /* This works for files in /proc/ and /sys/ that report a size of zero too */
+        r = read_full_file_full(dir_fd, path, UINT64_MAX, SIZE_MAX, 0, NULL, &contents, &size);
+        if (r < 0)
+                return r;
+
+        hash_string(ctx, "f");
+        sha256_process_bytes(&size, sizeof(size), ctx);
+        sha256_process_bytes(contents, size, ctx);
+        return 0;
+}
+
+static int hash_dir_entry(
+                RecurseDirEvent event,
+                const char *path,
+                int dir_fd,
+                int inode_fd,
+                const struct dirent *de,
+                const struct statx *sx,
+                void *userdata) {
+
+        struct sha256_ctx *ctx = ASSERT_PTR(userdata);
+        _cleanup_free_ char *target = NULL;
+        int r;
+
+        /* We can't tell whether an entry we can't read changed, hence don't use the cache then */
+        if (event >= RECURSE_DIR_SKIP_OPEN_DIR_ERROR_BASE)
+                return -EIO;
+
+        if (!IN_SET(event, RECURSE_DIR_ENTER, RECURSE_DIR_ENTRY))
+                return RECURSE_DIR_CONTINUE;
+
+        hash_string(ctx, path);
+
+        switch (de->d_type) {
+
+        case DT_DIR:
+                hash_string(ctx, "d");
+                break;
+
+        case DT_REG:
+                r = hash_file(ctx, dir_fd, de->d_name);
+                if (r < 0)
+                        return r;
+                break;
+
+        case DT_LNK:
+                r = readlinkat_malloc(dir_fd, de->d_name, &target);
+                if (r < 0)
+                        return r;
+
+                hash_string(ctx, "l");
+                hash_string(ctx, target);
+                break;
+
+        default:
+                hash_string(ctx, "o");
+        }
+
+        return RECURSE_DIR_CONTINUE;
+}
+
+static int hash_input(struct sha256_ctx *ctx, const char *path) {
+        struct stat st;
+
+        assert(ctx);
+        assert(path);
+
+        hash_string(ctx, path);
+
+        if (stat(path, &st) < 0) {
+                if (errno != ENOENT)
+                        return -errno;
+
+                /* That an input doesn't exist is information too */
+                hash_string(ctx, "m");
+                return 0;
+        }
+
+        if (S_ISDIR(st.st_mode))
+                return recurse_dir_at(AT_FDCWD, path, 0, 16, RECURSE_DIR_SORT|RECURSE_DIR_ENSURE_TYPE,
+                                      hash_dir_entry, ctx);
+
+        return hash_file(ctx, AT_FDCWD, path);
+}
+
+static int hash_environment(struct sha256_ctx *ctx, char* const* envp) {
+        _cleanup_strv_free_ char **l = NULL;
+
+        /* Generators see the manager's environment with envp applied on top */
+        l = strv_env_merge(environ, envp);
+        if (!l)
+                return -ENOMEM;
+
+        strv_sort(l);
+
+        STRV_FOREACH(i, l)
+                hash_string(ctx, *i);
+
+        return 0;
+}
+
+int generator_cache_key(const char *executable, char* const* envp, char **ret) {
+        _cleanup_free_ char *inputs_path = NULL, *inputs = NULL;
+        _cleanup_strv_free_ char **lines = NULL;
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        struct sha256_ctx ctx;
+        char *key;
+        int r;
+
+        assert(executable);
+        assert(ret);
+
+        inputs_path = strjoin(executable, GENERATOR_INPUTS_SUFFIX);
+        if (!inputs_path)
+                return -ENOMEM;
+
+        r = read_full_file(inputs_path, &inputs, NULL);
+        if (r == -ENOENT) {
+                *ret = NULL;
+                return 0;
+        }
+        if (r < 0)
+                return r;
+
+        sha256_init_ctx(&ctx);
+
+        /* A new version of the generator might generate something else from the same inputs */
+        r = hash_file(&ctx, AT_FDCWD, executable);
+        if (r < 0)
+                return r;
+
+        r = hash_environment(&ctx, envp);
+        if (r < 0)
+                return r;
+
+        r = strv_split_newlines_full(&lines, inputs, 0);
+        if (r < 0)
+                return r;
+
+        /* One absolute path per line, empty lines and comments are ignored */
+        STRV_FOREACH(line, lines) {
+                const char *l;
+
+                l = strstrip(*line);
+                if (isempty(l) || strchr(COMMENTS, *l))
+                        continue;
+
+                if (!path_is_absolute(l) || !path_is_normalized(l))
+                        return log_debug_errno(SYNTHETIC_ERRNO(EINVAL),
+                                               "Input path '%s' in %s is not absolute and normalized.", l, inputs_path);
+
+                r = hash_input(&ctx, l);
+                if (r < 0)
+                        return log_debug_errno(r, "Failed to hash input '%s' of %s: %m", l, executable);
+        }
+
+        sha256_finish_ctx(&ctx, digest);
+
+        key = hexmem(digest, sizeof(digest));
+        if (!key)
+                return -ENOMEM;
+
+        *ret = key;
+        return 1;
+}
+
+static int generator_cache_restore(const char *dir, char *argv[]) {
+        int r;
+
+        assert(dir);
+        assert(argv);
+
+        for (size_t i = 0; i < ELEMENTSOF(output_subdirs); i++) {
+                _cleanup_free_ char *from = NULL;
+
+                from = path_join(dir, output_subdirs[i]);
+                if (!from)
+                        return -ENOMEM;
+
+                r = copy_tree(from, argv[1 + i], UID_INVALID, GID_INVALID,
+                              COPY_MERGE|COPY_REPLACE|COPY_MAC_CREATE, NULL);
+                if (r < 0)
+                        return r;
+        }
+
+        return 0;
+}
+
+static int generator_cache_check(const char *dir, const char *key) {
+        _cleanup_free_ char *p = NULL, *cached = NULL;
+        int r;
+
+        p = path_join(dir, "key");
+        if (!p)
+                return -ENOMEM;
+
+        r = read_one_line_file(p, &cached);
+        if (r == -ENOENT)
+                return false;
+        if (r < 0)
+                return r;
+
+        return streq(cached, key);
+}
+
+static int generator_cache_prepare(const char *dir, char ***ret_argv) {
+        _cleanup_strv_free_ char **l = NULL;
+        int r;
+
+        assert(dir);
+        assert(ret_argv);
+
+        r = rm_rf(dir, REMOVE_ROOT|REMOVE_PHYSICAL|REMOVE_MISSING_OK);
+        if (r < 0)
+                return r;
+
+        /* The first entry is filled in by the executor */
+        l = strv_new("");
+        if (!l)
+                return -ENOMEM;
+
+        for (size_t i = 0; i < ELEMENTSOF(output_subdirs); i++) {
+                _cleanup_free_ char *p = NULL;
+
+                p = path_join(dir, output_subdirs[i]);
+                if (!p)
+                        return -ENOMEM;
+
+                r = mkdir_p(p, 0755);
+                if (r < 0)
+                        return r;
+
+                r = strv_consume(&l, TAKE_PTR(p));
+                if (r < 0)
+                        return r;
+        }
+
+        *ret_argv = TAKE_PTR(l);
+        return 0;
+}
+
+typedef struct GeneratorRun {
+        char *executable;   /* Not owned */
+        char *dir;
+        char *key;
+        pid_t pid;
+} GeneratorRun;
+
+static void generator_run_done(GeneratorRun *g) {
+        assert(g);
+
+        free(g->dir);
+        free(g->key);
+
+        /* Only if we failed in between, reap the child nonetheless */
+        if (g->pid > 0)
+                sigkill_wait(g->pid);
+}
+
+static void generator_run_free_many(GeneratorRun *runs, size_t n) {
+        for (size_t i = 0; i < n; i++)
+                generator_run_done(runs + i);
+
+        free(runs);
+}
+
+static int generator_run_start(
+                GeneratorRun *g,
+                usec_t timeout,
+                char *envp[],
+                ExecDirFlags flags,
+                int runtimes_fd) {
+
+        _cleanup_strv_free_ char **argv = NULL;
+        _cleanup_free_ char *name = NULL;
+        int r;
+
+        assert(g);
+
+        r = path_extract_filename(g->executable, &name);
+        if (r < 0)
+                return r;
+
+        r = generator_cache_prepare(g->dir, &argv);
+        if (r < 0)
+                return r;
+
+        /* Run this one in its own executor, so that it writes into its own output directories. It's a
+         * separate executor, hence it doesn't count towards $SYSTEMD_EXEC_DIR_MAX_PARALLEL. */
+        r = safe_fork("(sd-gencache)", FORK_RESET_SIGNALS|FORK_DEATHSIG|FORK_LOG, &g->pid);
+        if (r < 0)
+                return r;
+        if (r == 0) {
+                r = execute_strv(name, STRV_MAKE(g->executable), timeout, NULL, NULL, argv, envp,
+                                 flags & ~EXEC_DIR_IGNORE_ERRORS, runtimes_fd);
+                _exit(r < 0 ? EXIT_FAILURE : r);
+        }
+
+        return 0;
+}
+
+static int generator_run_finish(GeneratorRun *g, char *argv[]) {
+        _cleanup_free_ char *p = NULL;
+        int r, k;
+
+        assert(g);
+        assert(g->pid > 0);
+
+        r = wait_for_terminate_and_check(g->executable, TAKE_PID(g->pid), WAIT_LOG);
+
+        /* Use what the generator produced even if it failed, as we would without the cache, but only
+         * remember the output for the next time if it succeeded. */
+        k = generator_cache_restore(g->dir, argv);
+        if (k < 0)
+                log_warning_errno(k, "Failed to copy output of %s: %m", g->executable);
+        else if (r == 0) {
+                p = path_join(g->dir, "key");
+                if (!p)
+                        return log_oom();
+
+                k = write_string_file(p, g->key, WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_ATOMIC);
+                if (k < 0)
+                        log_warning_errno(k, "Failed to save cache key of %s, ignoring: %m", g->executable);
+        }
+
+        return r;
+}
+
+/* Returns > 0 if the cached output was used or the generator was started to fill the cache, and 0 if the
+ * generator shall be run without the cache. */
+static int generator_cache_try(
+                const char *cache_dir,
+                char *executable,
+                usec_t timeout,
+                char *argv[],
+                char *envp[],
+                ExecDirFlags flags,
+                int runtimes_fd,
+                GeneratorRun **runs,
+                size_t *n_runs) {
+
+        _cleanup_free_ char *key = NULL, *name = NULL, *dir = NULL;
+        GeneratorRun *g;
+        int r;
+
+        assert(cache_dir);
+        assert(executable);
+        assert(runs);
+        assert(n_runs);
+
+        r = generator_cache_key(executable, envp, &key);
+        if (r < 0)
+                log_warning_errno(r, "Failed to determine inputs of %s, not using cached output: %m", executable);
+        if (r <= 0)
+                return 0;
+
+        r = path_extract_filename(executable, &name);
+        if (r < 0)
+                return 0;
+
+        dir = path_join(cache_dir, name);
+        if (!dir)
+                return -ENOMEM;
+
+        r = generator_cache_check(dir, key);
+        if (r > 0) {
+                r = generator_cache_restore(dir, argv);
+                if (r >= 0) {
+                        log_debug("Inputs of %s didn't change, reusing its output.", executable);
+                        return 1;
+                }
+
+                log_warning_errno(r, "Failed to copy cached output of %s, running it: %m", executable);
+        }
+
+        if (!GREEDY_REALLOC(*runs, *n_runs + 1))
+                return -ENOMEM;
+
+        g = *runs + *n_runs;
+        *g = (GeneratorRun) {
+                .executable = executable,
+                .dir = TAKE_PTR(dir),
+                .key = TAKE_PTR(key),
+        };
+
+        r = generator_run_start(g, timeout, envp, flags, runtimes_fd);
+        if (r < 0) {
+                log_warning_errno(r, "Failed to set up cache for %s, running it directly: %m", executable);
+                generator_run_done(g);
+                return 0;
+        }
+
+        (*n_runs)++;
+        return 1;
+}
+
+int generator_cache_execute(
+                const char *cache_dir,
+                char* const* executables,
+                usec_t timeout,
+                char *argv[],
+                char *envp[],
+                ExecDirFlags flags,
+                int runtimes_fd) {
+
+        _cleanup_strv_free_ char **uncached = NULL;
+        GeneratorRun *runs = NULL;
+        size_t n_runs = 0;
+        int r;
+
+        assert(cache_dir);
+        assert(argv);
+        assert(argv[1] && argv[2] && argv[3]);
+
+        STRV_FOREACH(e, executables) {
+                r = generator_cache_try(cache_dir, *e, timeout, argv, envp, flags, runtimes_fd, &runs, &n_runs);
+                if (r > 0)
+                        continue;
+                if (r == 0)
+                        r = strv_extend(&uncached, *e);
+                if (r < 0) {
+                        log_oom();
+                        goto finish;
+                }
+        }
+
+        /* The generators that fill the cache run concurrently with these */
+        r = execute_strv("generators", uncached, timeout, NULL, NULL, argv, envp, flags, runtimes_fd);
+
+        for (size_t i = 0; i < n_runs; i++) {
+                int k;
+
+                k = generator_run_finish(runs + i, argv);
+                if (k != 0 && r == 0 && !FLAGS_SET(flags, EXEC_DIR_IGNORE_ERRORS))
+                        r = k;
+        }
+
+finish:
+        generator_run_free_many(runs, n_runs);
+        return r;
+}
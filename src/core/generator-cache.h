@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include "exec-util.h"
+#include "time-util.h"
+
+/* Suffix of the file next to a generator binary that lists the paths the generator's output depends on */
+#define GENERATOR_INPUTS_SUFFIX ".inputs"
+
+/* Calculates a hash over the generator binary, its environment and the contents of the paths listed in its
+ * input declaration. Returns 0 and sets *ret to NULL if the generator has no input declaration. */
+int generator_cache_key(const char *executable, char* const* envp, char **ret);
+
+/* Executes the generators like execute_strv() does. The output of generators that declare their inputs is
+ * kept below cache_dir and copied into the output directories passed in argv[1], argv[2] and argv[3] on
+ * subsequent invocations, without running the generator again, as long as none of the inputs changed. */
+int generator_cache_execute(
+                const char *cache_dir,
+                char* const* executables,
+                usec_t timeout,
+                char *argv[],
+                char *envp[],
+                ExecDirFlags flags,
+                int runtimes_fd);
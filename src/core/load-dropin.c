@@ -1,10 +1,14 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
 #include "conf-parser.h"
+#include "fileio.h"
 #include "fs-util.h"
+#include "hash-funcs.h"
 #include "load-dropin.h"
 #include "load-fragment.h"
 #include "log.h"
+#include "path-util.h"
+#include "siphash24.h"
 #include "stat-util.h"
 #include "string-util.h"
 #include "strv.h"
@@ -124,3 +128,92 @@ int unit_load_dropin(Unit *u) {
 
         return 0;
 }
+
+#define FINGERPRINT_HASH_KEY SD_ID128_MAKE(ca,f2,c1,bf,f5,e0,86,c1,8f,7d,cc,77,2c,0d,22,fb)
+
+static void fingerprint_file(const LookupPaths *lp, const char *path, struct siphash *state) {
+        struct stat st;
+
+        assert(lp);
+        assert(path);
+        assert(state);
+
+        path_hash_func(path, state);
+
+        /* Generators write their output anew on every run, hence compare the contents there, not the
+         * inode and timestamps. */
+        if (PATH_STARTSWITH_SET(path, lp->generator, lp->generator_early, lp->generator_late)) {
+                _cleanup_free_ char *contents = NULL;
+                size_t size;
+
+                if (read_full_file(path, &contents, &size) >= 0)
+                        siphash24_compress_safe(contents, size, state);
+                return;
+        }
+
+        if (stat(path, &st) < 0)
+                return;
+
+        siphash24_compress(&st.st_dev, sizeof(st.st_dev), state);
+        siphash24_compress(&st.st_ino, sizeof(st.st_ino), state);
+        siphash24_compress(&st.st_size, sizeof(st.st_size), state);
+        siphash24_compress_usec_t(timespec_load(&st.st_mtim), state);
+}
+
+int unit_files_fingerprint(Manager *m, const char *name, const char *fragment, Set *names, uint64_t *ret) {
+        _cleanup_strv_free_ char **dropins = NULL;
+        _cleanup_free_ char **sorted = NULL;
+        struct siphash state;
+        int r;
+
+        assert(m);
+        assert(name);
+        assert(ret);
+
+        /* Hashes everything unit_load_fragment() and unit_load_dropin() read for a unit with these names:
+         * the fragment, the names, the .conf drop-ins and the .wants/ and .requires/ symlinks. */
+
+        siphash24_init(&state, FINGERPRINT_HASH_KEY.bytes);
+
+        if (fragment)
+                fingerprint_file(&m->lookup_paths, fragment, &state);
+        siphash24_compress_byte(0, &state);
+
+        sorted = set_get_strv(names);
+        if (!sorted)
+                return -ENOMEM;
+        strv_sort(sorted);
+
+        STRV_FOREACH(n, sorted)
+                string_hash_func(*n, &state);
+        siphash24_compress_byte(0, &state);
+
+        FOREACH_STRING(suffix, ".wants", ".requires") {
+                _cleanup_strv_free_ char **paths = NULL;
+
+                r = unit_file_find_dropin_paths(NULL, m->lookup_paths.search_path, m->unit_path_cache,
+                                                suffix, NULL, name, names, &paths);
+                if (r < 0)
+                        return r;
+
+                STRV_FOREACH(p, paths) {
+                        _cleanup_free_ char *target = NULL;
+
+                        path_hash_func(*p, &state);
+                        if (readlink_malloc(*p, &target) >= 0)
+                                path_hash_func(target, &state);
+                }
+                siphash24_compress_byte(0, &state);
+        }
+
+        r = unit_file_find_dropin_paths(NULL, m->lookup_paths.search_path, m->unit_path_cache,
+                                        ".d", ".conf", name, names, &dropins);
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(p, dropins)
+                fingerprint_file(&m->lookup_paths, *p, &state);
+
+        *ret = siphash24_finalize(&state);
+        return 0;
+}
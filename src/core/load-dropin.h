@@ -18,3 +18,5 @@ static inline int unit_find_dropin_paths(Unit *u, char ***paths) {
 }
 
 int unit_load_dropin(Unit *u);
+
+int unit_files_fingerprint(Manager *m, const char *name, const char *fragment, Set *names, uint64_t *ret);
@@ -44,6 +44,7 @@
 #include "ip-protocol-list.h"
 #include "journal-file.h"
 #include "limits-util.h"
+#include "load-dropin.h"
 #include "load-fragment.h"
 #include "log.h"
 #include "missing_ioprio.h"
@@ -906,7 +907,8 @@ int config_parse_exec(
                          * it's prefixed with '!' we apply sandboxing, but do not change user/group credentials; if
                          * it's prefixed with '!!', then we apply user/group credentials if the kernel supports ambient
                          * capabilities -- if it doesn't we don't apply the credentials themselves, but do apply most
-                         * other sandboxing, with some special exceptions for changing UID.
+                         * other sandboxing, with some special exceptions for changing UID; if it's prefixed with '&',
+                         * it is run concurrently with the directly following and preceding commands prefixed so.
                          *
                          * The idea is that '!!' may be used to write services that can take benefit of systemd's
                          * UID/GID dropping if the kernel supports ambient creds, but provide an automatic fallback to
@@ -919,6 +921,8 @@ int config_parse_exec(
                                 separate_argv0 = true;
                         else if (*f == ':' && !(flags & EXEC_COMMAND_NO_ENV_EXPAND))
                                 flags |= EXEC_COMMAND_NO_ENV_EXPAND;
+                        else if (*f == '&' && !(flags & EXEC_COMMAND_PARALLEL))
+                                flags |= EXEC_COMMAND_PARALLEL;
                         else if (*f == '+' && !(flags & (EXEC_COMMAND_FULLY_PRIVILEGED|EXEC_COMMAND_NO_SETUID|EXEC_COMMAND_AMBIENT_MAGIC)))
                                 flags |= EXEC_COMMAND_FULLY_PRIVILEGED;
                         else if (*f == '!' && !(flags & (EXEC_COMMAND_FULLY_PRIVILEGED|EXEC_COMMAND_NO_SETUID|EXEC_COMMAND_AMBIENT_MAGIC)))
@@ -931,6 +935,13 @@ int config_parse_exec(
                         f++;
                 }
 
+                if ((flags & EXEC_COMMAND_PARALLEL) &&
+                    !(u && u->type == UNIT_SERVICE && STR_IN_SET(lvalue, "ExecStartPre", "ExecStartPost", "ExecStopPost"))) {
+                        log_syntax(unit, LOG_WARNING, filename, line, 0,
+                                   "The '&' prefix is only supported in ExecStartPre=, ExecStartPost= and ExecStopPost= of service units, ignoring.");
+                        flags &= ~EXEC_COMMAND_PARALLEL;
+                }
+
                 r = unit_path_printf(u, f, &path);
                 if (r < 0) {
                         log_syntax(unit, ignore ? LOG_WARNING : LOG_ERR, filename, line, r,
@@ -6024,14 +6035,21 @@ int unit_load_fragment(Unit *u) {
                 return 0;
         }
 
-        /* Possibly rebuild the fragment map to catch new units */
-        r = unit_file_build_name_map(&u->manager->lookup_paths,
-                                     &u->manager->unit_cache_timestamp_hash,
-                                     &u->manager->unit_id_map,
-                                     &u->manager->unit_name_map,
-                                     &u->manager->unit_path_cache);
-        if (r < 0)
-                return log_error_errno(r, "Failed to rebuild name map: %m");
+        /* Possibly rebuild the fragment map to catch new units. Checking whether that's necessary means
+         * stat()ing all lookup paths, hence do it only once for all units loaded in one go, or during one
+         * reload. */
+        if (!u->manager->unit_cache_validated) {
+                r = unit_file_build_name_map(&u->manager->lookup_paths,
+                                             &u->manager->unit_cache_timestamp_hash,
+                                             &u->manager->unit_id_map,
+                                             &u->manager->unit_name_map,
+                                             &u->manager->unit_path_cache);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to rebuild name map: %m");
+
+                u->manager->unit_cache_validated =
+                        u->manager->dispatching_load_queue || MANAGER_IS_RELOADING(u->manager);
+        }
 
         r = unit_file_find_fragment(u->manager->unit_id_map,
                                     u->manager->unit_name_map,
@@ -6041,6 +6059,10 @@ int unit_load_fragment(Unit *u) {
         if (r < 0 && r != -ENOENT)
                 return r;
 
+        r = unit_files_fingerprint(u->manager, u->id, fragment, names, &u->files_fingerprint);
+        if (r < 0)
+                return r;
+
         if (fragment) {
                 /* Open the file, check if this is a mask, otherwise read. */
                 _cleanup_fclose_ FILE *f = NULL;
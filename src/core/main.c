@@ -179,6 +179,9 @@ static unsigned arg_reload_limit_burst;
 /* A copy of the original environment block */
 static char **saved_env = NULL;
 
+/* The configuration files last parsed, to tell whether reloading can skip unchanged units */
+static Hashmap *config_stats_by_path = NULL;
+
 static int parse_configuration(const struct rlimit *saved_rlimit_nofile,
                                const struct rlimit *saved_rlimit_memlock);
 
@@ -617,6 +620,7 @@ static int config_parse_oom_score_adjust(
 }
 
 static int parse_config_file(void) {
+        _cleanup_hashmap_free_ Hashmap *stats_by_path = NULL;
         const ConfigTableItem items[] = {
                 { "Manager", "LogLevel",                     config_parse_level2,                0,                        NULL                              },
                 { "Manager", "LogTarget",                    config_parse_target,                0,                        NULL                              },
@@ -718,9 +722,11 @@ static int parse_config_file(void) {
                         config_item_table_lookup, items,
                         CONFIG_PARSE_WARN,
                         NULL,
-                        NULL,
+                        &stats_by_path,
                         NULL);
 
+        hashmap_free_and_replace(config_stats_by_path, stats_by_path);
+
         /* Traditionally "0" was used to turn off the default unit timeouts. Fix this up so that we use
          * USEC_INFINITY like everywhere else. */
         if (arg_default_timeout_start_usec <= 0)
@@ -1049,9 +1055,9 @@ static int parse_argv(int argc, char *argv[]) {
 
                         (void) fd_cloexec(fd, true);
 
-                        f = fdopen(fd, "r");
-                        if (!f)
-                                return log_error_errno(errno, "Failed to open serialization fd %d: %m", fd);
+                        r = fdopen_unlocked(fd, "r", &f);
+                        if (r < 0)
+                                return log_error_errno(r, "Failed to open serialization fd %d: %m", fd);
 
                         safe_fclose(arg_serialization);
                         arg_serialization = f;
@@ -1953,6 +1959,7 @@ static int invoke_main_loop(
                 switch (objective) {
 
                 case MANAGER_RELOAD: {
+                        _cleanup_hashmap_free_ Hashmap *old_config_stats_by_path = NULL;
                         LogTarget saved_log_target;
                         int saved_log_level;
 
@@ -1964,6 +1971,7 @@ static int invoke_main_loop(
                         saved_log_level = m->log_level_overridden ? log_get_max_level() : -1;
                         saved_log_target = m->log_target_overridden ? log_get_target() : _LOG_TARGET_INVALID;
 
+                        old_config_stats_by_path = TAKE_PTR(config_stats_by_path);
                         (void) parse_configuration(saved_rlimit_nofile, saved_rlimit_memlock);
 
                         set_manager_defaults(m);
@@ -1977,7 +1985,9 @@ static int invoke_main_loop(
                         if (saved_log_target >= 0)
                                 manager_override_log_target(m, saved_log_target);
 
-                        if (manager_reload(m) < 0)
+                        /* Only reload the units whose unit files changed, unless the manager configuration,
+                         * which the unit defaults come from, changed too. */
+                        if (manager_reload(m, !stats_by_path_equal(old_config_stats_by_path, config_stats_by_path)) < 0)
                                 /* Reloading failed before the point of no return.
                                  * Let's continue running as if nothing happened. */
                                 m->objective = MANAGER_OK;
@@ -3075,6 +3085,7 @@ finish:
         fds = fdset_free(fds);
 
         saved_env = strv_free(saved_env);
+        config_stats_by_path = hashmap_free(config_stats_by_path);
 
 #if HAVE_VALGRIND_VALGRIND_H
         /* If we are PID 1 and running under valgrind, then let's exit
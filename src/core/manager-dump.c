@@ -1,10 +1,13 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include "alloc-util.h"
 #include "build.h"
 #include "fd-util.h"
 #include "fileio.h"
+#include "format-util.h"
 #include "hashmap.h"
 #include "manager-dump.h"
+#include "set.h"
 #include "unit-serialize.h"
 
 void manager_dump_jobs(Manager *s, FILE *f, char **patterns, const char *prefix) {
@@ -40,6 +43,58 @@ void manager_dump_units(Manager *s, FILE *f, char **patterns, const char *prefix
         }
 }
 
+static void manager_dump_unit_memory(Manager *m, FILE *f, const char *prefix) {
+        size_t total = 0;
+
+        assert(m);
+        assert(f);
+
+        /* Where the memory for units goes, by unit type, as reported by the allocator. This covers the unit
+         * objects, their names and the tables holding aliases and dependencies, but not the various other
+         * strings and lists the units reference. */
+
+        for (UnitType t = 0; t < _UNIT_TYPE_MAX; t++) {
+                size_t n_units = 0, n_aliases = 0, n_dependencies = 0, objects_size = 0, names_size = 0, dependencies_size = 0;
+
+                LIST_FOREACH(units_by_type, u, m->units_by_type[t]) {
+                        Hashmap *deps;
+                        const char *a;
+
+                        n_units++;
+                        objects_size += MALLOC_SIZEOF_SAFE(u);
+                        names_size += MALLOC_SIZEOF_SAFE(u->id) + set_memory_usage(u->aliases);
+
+                        SET_FOREACH(a, u->aliases) {
+                                n_aliases++;
+                                names_size += MALLOC_SIZEOF_SAFE(a);
+                        }
+
+                        dependencies_size += hashmap_memory_usage(u->dependencies);
+                        HASHMAP_FOREACH(deps, u->dependencies) {
+                                n_dependencies += hashmap_size(deps);
+                                dependencies_size += hashmap_memory_usage(deps);
+                        }
+                }
+
+                if (n_units == 0)
+                        continue;
+
+                fprintf(f, "%sUnit type %s: %zu units, %s objects, %s names (%zu aliases), %s dependencies (%zu entries)\n",
+                        strempty(prefix), unit_type_to_string(t), n_units,
+                        FORMAT_BYTES(objects_size), FORMAT_BYTES(names_size), n_aliases,
+                        FORMAT_BYTES(dependencies_size), n_dependencies);
+
+                total += objects_size + names_size + dependencies_size;
+        }
+
+        total += hashmap_memory_usage(m->units);
+
+        fprintf(f, "%sUnit name table: %s (%u entries)\n"
+                "%sUnit memory total: %s\n",
+                strempty(prefix), FORMAT_BYTES(hashmap_memory_usage(m->units)), hashmap_size(m->units),
+                strempty(prefix), FORMAT_BYTES(total));
+}
+
 static void manager_dump_header(Manager *m, FILE *f, const char *prefix) {
 
         /* NB: this is a debug interface for developers. It's not supposed to be machine readable or be
@@ -59,6 +114,15 @@ static void manager_dump_header(Manager *m, FILE *f, const char *prefix) {
                                 timestamp_is_set(t->realtime) ? FORMAT_TIMESTAMP(t->realtime) :
                                                                 FORMAT_TIMESPAN(t->monotonic, 1));
         }
+
+        fprintf(f, "%sCGroup attribute writes: %" PRIu64 " (%" PRIu64 " skipped)\n",
+                strempty(prefix), m->n_cgroup_attribute_writes, m->n_cgroup_attribute_writes_skipped);
+        fprintf(f, "%sUnit change signals: %" PRIu64 " (%" PRIu64 " coalesced, %" PRIu64 " suppressed)\n",
+                strempty(prefix), m->n_dbus_unit_signals_sent, m->n_dbus_unit_changes_coalesced, m->n_dbus_unit_changes_suppressed);
+        fprintf(f, "%sCGroup empty queue: %u (max %u, %" PRIu64 " batches)\n",
+                strempty(prefix), m->n_cgroup_empty_queued, m->n_cgroup_empty_queued_max, m->n_cgroup_empty_batches);
+
+        manager_dump_unit_memory(m, f, prefix);
 }
 
 void manager_dump(Manager *m, FILE *f, char **patterns, const char *prefix) {
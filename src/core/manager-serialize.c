@@ -1,8 +1,12 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "clean-ipc.h"
 #include "core-varlink.h"
 #include "dbus.h"
+#include "env-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "format-util.h"
@@ -17,9 +21,36 @@
 #include "user-util.h"
 #include "varlink-internal.h"
 
+/* After the unit records an index is appended, listing the name of each serialized unit and where its
+ * record is. This allows mapping the serialization and deserializing each unit from its own record,
+ * instead of reading through the whole file line by line. The text before the index is the same as
+ * without it, hence it can still be read as such. */
+
+#define UNIT_INDEX_SIGNATURE ((const uint8_t[]) { 'S', 'D', 'U', 'N', 'I', 'D', 'X', '\0' })
+#define UNIT_INDEX_VERSION UINT64_C(1)
+
+typedef struct UnitIndexEntry {
+        uint64_t name_offset; /* into the string table */
+        uint64_t offset;      /* of the record, i.e. the lines following the unit name */
+        uint64_t size;
+} UnitIndexEntry;
+
+/* The index is laid out as the entries, followed by the string table with the unit names, followed by
+ * this trailer, at the very end of the file. All parts are 8 byte aligned. */
+typedef struct UnitIndexTrailer {
+        uint64_t n_entries;
+        uint64_t strings_size;
+        uint64_t version;
+        uint8_t signature[8];
+} UnitIndexTrailer;
+
+assert_cc(sizeof(UnitIndexEntry) % 8 == 0);
+assert_cc(sizeof(UnitIndexTrailer) % 8 == 0);
+
 int manager_open_serialization(Manager *m, FILE **ret_f) {
         _cleanup_close_ int fd = -EBADF;
         FILE *f;
+        int r;
 
         assert(ret_f);
 
@@ -27,9 +58,11 @@ int manager_open_serialization(Manager *m, FILE **ret_f) {
         if (fd < 0)
                 return fd;
 
-        f = take_fdopen(&fd, "w+");
-        if (!f)
-                return -errno;
+        /* The serialization is only ever accessed from our single thread, and consists of lots of small
+         * writes and single character reads, hence don't bother with stdio's locking. */
+        r = take_fdopen_unlocked(&fd, "w+", &f);
+        if (r < 0)
+                return r;
 
         *ret_f = f;
         return 0;
@@ -82,14 +115,122 @@ static void manager_serialize_gid_refs(Manager *m, FILE *f) {
         manager_serialize_uid_refs_internal(f, m->gid_refs, "destroy-ipc-gid");
 }
 
+static bool manager_serialize_unit_index(bool switching_root) {
+        int r;
+
+        /* The systemd binary in the new root might be older and not know about the index, hence stick to
+         * plain text then. */
+        if (switching_root)
+                return false;
+
+        r = getenv_bool("SYSTEMD_SERIALIZATION_INDEX");
+        if (r < 0 && r != -ENXIO)
+                log_debug_errno(r, "Failed to parse $SYSTEMD_SERIALIZATION_INDEX, ignoring: %m");
+
+        return r != 0;
+}
+
+static int manager_write_unit_index(FILE *f, const UnitIndexEntry *entries, size_t n_entries, const char *strings, size_t strings_size) {
+        UnitIndexTrailer trailer = {
+                .n_entries = n_entries,
+                .strings_size = ALIGN8(strings_size),
+                .version = UNIT_INDEX_VERSION,
+        };
+        off_t p;
+
+        assert(f);
+
+        memcpy(trailer.signature, UNIT_INDEX_SIGNATURE, sizeof(trailer.signature));
+
+        p = ftello(f);
+        if (p < 0)
+                return -errno;
+
+        /* Pad, so that the index can be accessed in place once the file is mapped */
+        for (; p % 8 != 0; p++)
+                (void) fputc(0, f);
+
+        (void) fwrite(entries, sizeof(UnitIndexEntry), n_entries, f);
+        (void) fwrite(strings, 1, strings_size, f);
+
+        for (size_t i = strings_size; i < trailer.strings_size; i++)
+                (void) fputc(0, f);
+
+        (void) fwrite(&trailer, sizeof(trailer), 1, f);
+        return 0;
+}
+
+static int manager_serialize_units(Manager *m, FILE *f, FDSet *fds, bool switching_root) {
+        _cleanup_free_ UnitIndexEntry *entries = NULL;
+        _cleanup_free_ char *strings = NULL;
+        size_t n_entries = 0, strings_size = 0;
+        bool with_index;
+        const char *t;
+        Unit *u;
+        int r;
+
+        assert(m);
+        assert(f);
+
+        with_index = manager_serialize_unit_index(switching_root);
+
+        HASHMAP_FOREACH_KEY(u, t, m->units) {
+                off_t start, end;
+                size_t l;
+
+                if (u->id != t)
+                        continue;
+
+                start = ftello(f);
+                if (start < 0)
+                        return log_error_errno(errno, "Failed to determine serialization offset: %m");
+
+                r = unit_serialize(u, f, fds, switching_root);
+                if (r < 0)
+                        return r;
+
+                if (!with_index)
+                        continue;
+
+                end = ftello(f);
+                if (end < 0)
+                        return log_error_errno(errno, "Failed to determine serialization offset: %m");
+                if (end == start) /* Not serialized */
+                        continue;
+
+                l = strlen(u->id);
+
+                if (!GREEDY_REALLOC(entries, n_entries + 1) ||
+                    !GREEDY_REALLOC(strings, strings_size + l + 1))
+                        return log_oom();
+
+                /* The record starts after the start marker, i.e. the unit name */
+                entries[n_entries++] = (UnitIndexEntry) {
+                        .name_offset = strings_size,
+                        .offset = start + l + 1,
+                        .size = end - start - l - 1,
+                };
+
+                memcpy(strings + strings_size, u->id, l + 1);
+                strings_size += l + 1;
+        }
+
+        if (!with_index)
+                return 0;
+
+        r = manager_write_unit_index(f, entries, n_entries, strings, strings_size);
+        if (r < 0)
+                return log_error_errno(r, "Failed to write serialization index: %m");
+
+        return 0;
+}
+
 int manager_serialize(
                 Manager *m,
                 FILE *f,
                 FDSet *fds,
                 bool switching_root) {
 
-        const char *t;
-        Unit *u;
         int r;
 
         assert(m);
@@ -184,14 +325,9 @@ int manager_serialize(
 
         (void) fputc('\n', f);
 
-        HASHMAP_FOREACH_KEY(u, t, m->units) {
-                if (u->id != t)
-                        continue;
-
-                r = unit_serialize(u, f, fds, switching_root);
-                if (r < 0)
-                        return r;
-        }
+        r = manager_serialize_units(m, f, fds, switching_root);
+        if (r < 0)
+                return r;
 
         r = fflush_and_check(f);
         if (r < 0)
@@ -225,10 +361,111 @@ static int manager_deserialize_one_unit(Manager *m, const char *name, FILE *f, F
         return 0;
 }
 
+static int manager_deserialize_units_mapped(Manager *m, const uint8_t *p, size_t size, FDSet *fds) {
+        const UnitIndexTrailer *trailer;
+        const UnitIndexEntry *entries;
+        const char *strings;
+        uint64_t records_size;
+        int r;
+
+        assert(m);
+        assert(p);
+
+        if (size < sizeof(UnitIndexTrailer) || size % 8 != 0)
+                return 0;
+
+        trailer = (const UnitIndexTrailer*) (p + size - sizeof(UnitIndexTrailer));
+        if (memcmp(trailer->signature, UNIT_INDEX_SIGNATURE, sizeof(trailer->signature)) != 0)
+                return 0;
+
+        if (trailer->version != UNIT_INDEX_VERSION) {
+                log_notice("Serialization index has unsupported version %" PRIu64 ", reading units as text.",
+                           trailer->version);
+                return 0;
+        }
+
+        records_size = size - sizeof(UnitIndexTrailer);
+        if (trailer->strings_size % 8 != 0 ||
+            trailer->strings_size > records_size ||
+            trailer->n_entries > (records_size - trailer->strings_size) / sizeof(UnitIndexEntry)) {
+                log_notice("Serialization index is corrupted, reading units as text.");
+                return 0;
+        }
+
+        strings = (const char*) trailer - trailer->strings_size;
+        entries = (const UnitIndexEntry*) strings - trailer->n_entries;
+        records_size = (const uint8_t*) entries - p;
+
+        log_debug("Deserializing %" PRIu64 " units using the serialization index.", trailer->n_entries);
+
+        for (uint64_t i = 0; i < trailer->n_entries; i++) {
+                const UnitIndexEntry *e = entries + i;
+                _cleanup_fclose_ FILE *record = NULL;
+
+                if (e->name_offset >= trailer->strings_size ||
+                    !memchr(strings + e->name_offset, 0, trailer->strings_size - e->name_offset) ||
+                    e->size == 0 ||
+                    e->offset > records_size ||
+                    e->size > records_size - e->offset) {
+                        log_notice("Serialization index entry %" PRIu64 " is corrupted, skipping.", i);
+                        continue;
+                }
+
+                /* Each unit only reads its own record, units that can't be loaded anymore are skipped
+                 * without looking at it at all. */
+                record = fmemopen_unlocked((void*) (p + e->offset), e->size, "r");
+                if (!record)
+                        return log_oom();
+
+                r = manager_deserialize_one_unit(m, strings + e->name_offset, record, fds);
+                if (r == -ENOMEM)
+                        return r;
+        }
+
+        return 1;
+}
+
+static int manager_deserialize_units_indexed(Manager *m, FILE *f, FDSet *fds) {
+        struct stat st;
+        void *p;
+        int fd, r;
+
+        assert(m);
+        assert(f);
+
+        /* Returns 0 if the serialization has no usable index, in which case the units shall be read as
+         * text, and 1 if they have been deserialized. */
+
+        fd = fileno(f);
+        if (fd < 0)
+                return 0;
+
+        if (fstat(fd, &st) < 0) {
+                log_debug_errno(errno, "Failed to stat serialization, reading units as text: %m");
+                return 0;
+        }
+        if (!S_ISREG(st.st_mode) || st.st_size <= 0 || (uint64_t) st.st_size > SIZE_MAX)
+                return 0;
+
+        p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+                log_debug_errno(errno, "Failed to map serialization, reading units as text: %m");
+                return 0;
+        }
+
+        r = manager_deserialize_units_mapped(m, p, st.st_size, fds);
+        (void) munmap(p, st.st_size);
+        return r;
+}
+
 static int manager_deserialize_units(Manager *m, FILE *f, FDSet *fds) {
         const char *unit_name;
         int r;
 
+        r = manager_deserialize_units_indexed(m, f, fds);
+        if (r != 0)
+                return r < 0 ? r : 0;
+
         for (;;) {
                 _cleanup_free_ char *line = NULL;
                 /* Start marker */
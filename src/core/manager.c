@@ -31,6 +31,7 @@
 #include "bus-util.h"
 #include "clean-ipc.h"
 #include "clock-util.h"
+#include "conf-files.h"
 #include "constants.h"
 #include "core-varlink.h"
 #include "creds-util.h"
@@ -47,6 +48,7 @@
 #include "exit-status.h"
 #include "fd-util.h"
 #include "fileio.h"
+#include "generator-cache.h"
 #include "generator-setup.h"
 #include "hashmap.h"
 #include "initrd-util.h"
@@ -54,6 +56,7 @@
 #include "install.h"
 #include "io-util.h"
 #include "label.h"
+#include "load-dropin.h"
 #include "load-fragment.h"
 #include "locale-setup.h"
 #include "log.h"
@@ -73,6 +76,7 @@
 #include "rlimit-util.h"
 #include "rm-rf.h"
 #include "selinux-util.h"
+#include "serialize.h"
 #include "signal-util.h"
 #include "socket-util.h"
 #include "special.h"
@@ -89,6 +93,7 @@
 #include "uid-range.h"
 #include "umask-util.h"
 #include "unit-name.h"
+#include "unit-serialize.h"
 #include "user-util.h"
 #include "virt.h"
 #include "watchdog.h"
@@ -731,6 +736,7 @@ static void manager_free_unit_name_maps(Manager *m) {
         m->unit_name_map = hashmap_free(m->unit_name_map);
         m->unit_path_cache = set_free(m->unit_path_cache);
         m->unit_cache_timestamp_hash = 0;
+        m->unit_cache_validated = false;
 }
 
 static int manager_setup_run_queue(Manager *m) {
@@ -1546,6 +1552,7 @@ Manager* manager_free(Manager *m) {
         free(m->notify_socket);
 
         lookup_paths_free(&m->lookup_paths);
+        exec_dir_runtime_free_many(m->generator_runtimes, m->n_generator_runtimes);
         strv_free(m->transient_environment);
         strv_free(m->client_environment);
 
@@ -1778,6 +1785,9 @@ void manager_reloading_stopp(Manager **m) {
         if (*m) {
                 assert((*m)->n_reloading > 0);
                 (*m)->n_reloading--;
+
+                if ((*m)->n_reloading == 0)
+                        (*m)->unit_cache_validated = false;
         }
 }
 
@@ -2089,6 +2099,11 @@ unsigned manager_dispatch_load_queue(Manager *m) {
 
         m->dispatching_load_queue = false;
 
+        /* While reloading, units are loaded one by one as they are deserialized. Keep the validated unit
+         * file cache around until the reload is complete, it was built from scratch at its beginning. */
+        if (!MANAGER_IS_RELOADING(m))
+                m->unit_cache_validated = false;
+
         /* Dispatch the units waiting for their target dependencies to be added now, as all targets that we know about
          * should be loaded and have aliases resolved */
         (void) manager_dispatch_target_deps_queue(m);
@@ -2110,6 +2125,10 @@ bool manager_unit_cache_should_retry_load(Unit *u) {
         if (u->manager->unit_cache_timestamp_hash != u->fragment_not_found_timestamp_hash)
                 return true;
 
+        /* We already checked the cache against the disk during this load queue run. */
+        if (u->manager->unit_cache_validated)
+                return false;
+
         /* The cache needs to be updated because there are modifications on disk. */
         return !lookup_paths_timestamp_hash_same(&u->manager->lookup_paths, u->manager->unit_cache_timestamp_hash, NULL);
 }
@@ -3329,14 +3348,379 @@ int manager_override_watchdog_pretimeout_governor(Manager *m, const char *govern
         return free_and_replace(m->watchdog_pretimeout_governor_overridden, p);
 }
 
-int manager_reload(Manager *m) {
+static bool manager_reload_incremental(void) {
+        int r;
+
+        r = getenv_bool("SYSTEMD_RELOAD_INCREMENTAL");
+        if (r < 0 && r != -ENXIO)
+                log_debug_errno(r, "Failed to parse $SYSTEMD_RELOAD_INCREMENTAL, ignoring: %m");
+
+        return r != 0;
+}
+
+static int manager_copy_search_path(Manager *m, char ***ret) {
+        _cleanup_strv_free_ char **l = NULL;
+
+        assert(m);
+        assert(ret);
+
+        l = strv_copy(m->lookup_paths.search_path);
+        if (!l)
+                return -ENOMEM;
+
+        /* The generator directories are temporary ones in test runs. Their contents are compared unit by
+         * unit anyway. */
+        strv_remove(l, m->lookup_paths.generator);
+        strv_remove(l, m->lookup_paths.generator_early);
+        strv_remove(l, m->lookup_paths.generator_late);
+
+        *ret = TAKE_PTR(l);
+        return 0;
+}
+
+static int manager_regenerate(Manager *m) {
+        int r;
+
+        assert(m);
+
+        lookup_paths_flush_generator(&m->lookup_paths);
+        lookup_paths_free(&m->lookup_paths);
+
+        r = lookup_paths_init_or_warn(&m->lookup_paths, m->unit_file_scope, 0, NULL);
+        if (r < 0)
+                return r;
+
+        (void) manager_run_environment_generators(m);
+        (void) manager_run_generators(m);
+
+        lookup_paths_log(&m->lookup_paths);
+
+        /* We flushed out generated files, for which we don't watch mtime, so we should flush the old map. */
+        manager_free_unit_name_maps(m);
+
+        return 0;
+}
+
+typedef struct InboundDependency {
+        Unit *other;
+        UnitDependency dependency;
+        UnitDependencyMask mask;
+} InboundDependency;
+
+typedef struct InboundRef {
+        UnitRef *ref;
+        Unit *source;
+} InboundRef;
+
+static int manager_reload_one_unit(Manager *m, Unit *u, Unit **ret) {
+        _cleanup_free_ InboundDependency *deps = NULL;
+        _cleanup_free_ InboundRef *refs = NULL;
+        _cleanup_fdset_free_ FDSet *fds = NULL;
+        _cleanup_set_free_ Set *seen = NULL;
+        _cleanup_free_ char *id = NULL, *buf = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        size_t n_deps = 0, n_refs = 0, size = 0;
+        ExecRuntime *rt = NULL;
+        Hashmap *by_type;
+        Unit *other, *n;
+        int r;
+
+        assert(m);
+        assert(u);
+        assert(ret);
+
+        /* Replaces a unit by a freshly loaded one. The state is carried over through the serialization,
+         * like on a full reload. What other units configured on this one doesn't go through loading it,
+         * hence remember that and add it back to the new unit. */
+
+        id = strdup(u->id);
+        if (!id)
+                return -ENOMEM;
+
+        fds = fdset_new();
+        if (!fds)
+                return -ENOMEM;
+
+        f = open_memstream_unlocked(&buf, &size);
+        if (!f)
+                return -ENOMEM;
+
+        r = unit_serialize(u, f, fds, /* switching_root= */ false);
+        if (r < 0)
+                return r;
+
+        r = fflush_and_check(f);
+        if (r < 0)
+                return r;
+
+        f = safe_fclose(f);
+
+        HASHMAP_FOREACH(by_type, u->dependencies) {
+                void *v;
+
+                HASHMAP_FOREACH_KEY(v, other, by_type) {
+                        Hashmap *other_deps;
+                        void *d;
+
+                        r = set_ensure_put(&seen, NULL, other);
+                        if (r < 0)
+                                return r;
+                        if (r == 0)
+                                continue;
+
+                        HASHMAP_FOREACH_KEY(other_deps, d, other->dependencies) {
+                                UnitDependency t = UNIT_DEPENDENCY_FROM_PTR(d);
+                                UnitDependencyInfo di;
+
+                                di.data = hashmap_get(other_deps, u);
+
+                                /* Targets are ordered after the units they pull in depending on both units'
+                                 * DefaultDependencies=, the target dependency queue adds that back. */
+                                if (other->type == UNIT_TARGET && t == UNIT_AFTER)
+                                        di.origin_mask &= ~UNIT_DEPENDENCY_DEFAULT;
+
+                                if (di.origin_mask == 0)
+                                        continue;
+
+                                if (!GREEDY_REALLOC(deps, n_deps + 1))
+                                        return -ENOMEM;
+
+                                deps[n_deps++] = (InboundDependency) {
+                                        .other = other,
+                                        .dependency = t,
+                                        .mask = di.origin_mask,
+                                };
+                        }
+                }
+        }
+
+        LIST_FOREACH(refs_by_target, ref, u->refs_by_target) {
+                if (!GREEDY_REALLOC(refs, n_refs + 1))
+                        return -ENOMEM;
+
+                refs[n_refs++] = (InboundRef) {
+                        .ref = ref,
+                        .source = ref->source,
+                };
+        }
+
+        /* Runtime directories and namespaces are looked up by name when the new unit is coldplugged, keep
+         * them around until then. */
+        if (unit_get_exec_runtime(u))
+                (void) exec_runtime_acquire(m, NULL, unit_get_exec_runtime(u)->id, /* create= */ false, &rt);
+
+        log_unit_debug(u, "Unit files changed, reloading unit.");
+
+        unit_free(u);
+
+        r = manager_load_unit(m, id, NULL, NULL, &n);
+        if (r < 0) {
+                exec_runtime_unref(rt, /* destroy= */ false);
+                log_error_errno(r, "Failed to load unit %s again: %m", id);
+                *ret = NULL;
+                return 0;
+        }
+
+        for (size_t i = 0; i < n_deps; i++) {
+                r = unit_add_dependency(deps[i].other, deps[i].dependency, n, /* add_reference= */ false, deps[i].mask);
+                if (r < 0)
+                        log_unit_warning_errno(deps[i].other, r, "Failed to add back %s= dependency on %s, ignoring: %m",
+                                               unit_dependency_to_string(deps[i].dependency), n->id);
+        }
+
+        for (size_t i = 0; i < n_refs; i++)
+                unit_ref_set(refs[i].ref, refs[i].source, n);
+
+        f = fmemopen_unlocked(buf, size, "r");
+        if (!f)
+                r = -ENOMEM;
+        else {
+                /* Skip the start marker, we know which unit this is */
+                r = read_line(f, LONG_LINE_MAX, NULL);
+                if (r >= 0)
+                        r = unit_deserialize(n, f, fds);
+        }
+        if (r < 0)
+                log_unit_notice_errno(n, r, "Failed to deserialize unit, skipping: %m");
+
+        r = unit_coldplug(n);
+        if (r < 0)
+                log_unit_warning_errno(n, r, "We couldn't coldplug unit, proceeding anyway: %m");
+
+        exec_runtime_unref(rt, /* destroy= */ false);
+
+        *ret = n;
+        return 0;
+}
+
+static bool unit_can_reload_alone(Unit *u, Set *names) {
+        assert(u);
+
+        if (u->perpetual)
+                return false;
+
+        /* Names might have to be merged */
+        if (!set_isempty(u->aliases) || set_size(names) > 1)
+                return false;
+
+        /* Parts of the state of these are only read from the kernel when enumerating */
+        if (UNIT_VTABLE(u)->enumerate)
+                return false;
+
+        /* Connection services count towards their socket's connections when deserialized */
+        if (u->type == UNIT_SERVICE && UNIT_ISSET(SERVICE(u)->accept_socket))
+                return false;
+        if (u->type == UNIT_SOCKET && SOCKET(u)->n_connections > 0)
+                return false;
+
+        return true;
+}
+
+static int manager_reload_changed_units(Manager *m, char **search_path) {
+        _cleanup_strv_free_ char **new_search_path = NULL;
+        _cleanup_free_ Unit **changed = NULL;
+        size_t n_changed = 0;
+        Unit *u;
+        char *k;
+        int r;
+
+        assert(m);
+
+        /* Returns > 0 if only the units whose files changed were reloaded, 0 or negative if everything needs
+         * to be reloaded. No unit is touched in the latter case. */
+
+        r = manager_copy_search_path(m, &new_search_path);
+        if (r < 0)
+                return r;
+
+        if (!strv_equal(search_path, new_search_path)) {
+                log_debug("Unit search path changed, reloading all units.");
+                return 0;
+        }
+
+        r = unit_file_build_name_map(&m->lookup_paths,
+                                     &m->unit_cache_timestamp_hash,
+                                     &m->unit_id_map,
+                                     &m->unit_name_map,
+                                     &m->unit_path_cache);
+        if (r < 0)
+                return r;
+
+        m->unit_cache_validated = true;
+
+        HASHMAP_FOREACH_KEY(u, k, m->units) {
+                _cleanup_set_free_free_ Set *names = NULL;
+                const char *fragment = NULL;
+                uint64_t fingerprint;
+
+                /* ignore aliases */
+                if (u->id != k)
+                        continue;
+
+                /* Not loaded yet, this will pick up the current files anyway */
+                if (u->load_state == UNIT_STUB)
+                        continue;
+
+                /* The files of transient units are only written by us, and applied right away */
+                if (u->transient)
+                        continue;
+
+                r = unit_file_find_fragment(m->unit_id_map, m->unit_name_map, u->id, &fragment, &names);
+                if (r < 0 && r != -ENOENT)
+                        return r;
+
+                r = unit_files_fingerprint(m, u->id, fragment, names, &fingerprint);
+                if (r < 0)
+                        return r;
+
+                if (fingerprint == u->files_fingerprint)
+                        continue;
+
+                if (!unit_can_reload_alone(u, names)) {
+                        log_unit_debug(u, "Unit files changed and unit cannot be reloaded on its own, reloading all units.");
+                        return 0;
+                }
+
+                if (!GREEDY_REALLOC(changed, n_changed + 1))
+                        return -ENOMEM;
+
+                changed[n_changed++] = u;
+        }
+
+        log_debug("Reloading %zu unit(s) with changed unit files.", n_changed);
+
+        bus_manager_send_reloading(m, true);
+
+        for (size_t i = 0; i < n_changed; i++) {
+                Unit *n;
+
+                r = manager_reload_one_unit(m, changed[i], &n);
+                if (r < 0) {
+                        log_unit_warning_errno(changed[i], r, "Failed to reload unit, keeping previous configuration: %m");
+                        n = NULL;
+                }
+
+                changed[i] = n;
+        }
+
+        /* Targets are ordered after the units they pull in, unless either side has DefaultDependencies=no,
+         * make sure to add that for all new dependencies. */
+        for (size_t i = 0; i < n_changed; i++) {
+                Hashmap *by_type;
+                Unit *other;
+                void *v;
+
+                if (!changed[i])
+                        continue;
+
+                unit_add_to_target_deps_queue(changed[i]);
+
+                HASHMAP_FOREACH(by_type, changed[i]->dependencies)
+                        HASHMAP_FOREACH_KEY(v, other, by_type)
+                                unit_add_to_target_deps_queue(other);
+        }
+
+        (void) manager_dispatch_target_deps_queue(m);
+
+        return 1;
+}
+
+int manager_reload(Manager *m, bool full) {
         _unused_ _cleanup_(manager_reloading_stopp) Manager *reloading = NULL;
         _cleanup_fdset_free_ FDSet *fds = NULL;
         _cleanup_fclose_ FILE *f = NULL;
+        bool regenerated = false;
         int r;
 
         assert(m);
 
+        /* We are officially in reload mode from here on. */
+        reloading = manager_reloading_start(m);
+
+        /* Unless the manager configuration changed, only reload the units whose unit files changed. This
+         * needs the generators to run first, as their output may have changed. */
+        if (!full && manager_reload_incremental()) {
+                _cleanup_strv_free_ char **search_path = NULL;
+
+                r = manager_copy_search_path(m, &search_path);
+                if (r < 0)
+                        return log_oom();
+
+                r = manager_regenerate(m);
+                if (r < 0)
+                        return r;
+
+                regenerated = true;
+
+                r = manager_reload_changed_units(m, search_path);
+                if (r < 0)
+                        log_warning_errno(r, "Failed to determine units with changed unit files, reloading all units: %m");
+                if (r > 0) {
+                        reloading = NULL;
+                        goto finish;
+                }
+        }
+
         r = manager_open_serialization(m, &f);
         if (r < 0)
                 return log_error_errno(r, "Failed to create serialization file: %m");
@@ -3345,9 +3729,6 @@ int manager_reload(Manager *m) {
         if (!fds)
                 return log_oom();
 
-        /* We are officially in reload mode from here on. */
-        reloading = manager_reloading_start(m);
-
         r = manager_serialize(m, f, fds, false);
         if (r < 0)
                 return r;
@@ -3365,24 +3746,17 @@ int manager_reload(Manager *m) {
          * it. */
 
         manager_clear_jobs_and_units(m);
-        lookup_paths_flush_generator(&m->lookup_paths);
-        lookup_paths_free(&m->lookup_paths);
         exec_runtime_vacuum(m);
         dynamic_user_vacuum(m, false);
         m->uid_refs = hashmap_free(m->uid_refs);
         m->gid_refs = hashmap_free(m->gid_refs);
 
-        r = lookup_paths_init_or_warn(&m->lookup_paths, m->unit_file_scope, 0, NULL);
-        if (r < 0)
-                return r;
-
-        (void) manager_run_environment_generators(m);
-        (void) manager_run_generators(m);
-
-        lookup_paths_log(&m->lookup_paths);
-
-        /* We flushed out generated files, for which we don't watch mtime, so we should flush the old map. */
-        manager_free_unit_name_maps(m);
+        if (!regenerated) {
+                r = manager_regenerate(m);
+                if (r < 0)
+                        return r;
+        } else
+                manager_free_unit_name_maps(m);
 
         /* First, enumerate what we can from kernel and suchlike */
         manager_enumerate_perpetual(m);
@@ -3404,6 +3778,7 @@ int manager_reload(Manager *m) {
         /* Third, fire things up! */
         manager_coldplug(m);
 
+finish:
         /* Clean up runtime objects no longer referenced */
         manager_vacuum(m);
 
@@ -3413,6 +3788,7 @@ int manager_reload(Manager *m) {
         /* Consider the reload process complete now. */
         assert(m->n_reloading > 0);
         m->n_reloading--;
+        m->unit_cache_validated = false;
 
         manager_ready(m);
 
@@ -3746,8 +4122,9 @@ static int build_generator_environment(Manager *m, char ***ret) {
         return 0;
 }
 
-static int manager_execute_generators(Manager *m, char **paths, bool remount_ro) {
-        _cleanup_strv_free_ char **ge = NULL;
+static int manager_execute_generators(Manager *m, char **paths, bool remount_ro, int runtimes_fd) {
+        _cleanup_strv_free_ char **ge = NULL, **executables = NULL;
+        _cleanup_free_ char *cache_dir = NULL;
         const char *argv[] = {
                 NULL, /* Leave this empty, execute_directory() will fill something in */
                 m->lookup_paths.generator,
@@ -3773,18 +4150,50 @@ static int manager_execute_generators(Manager *m, char **paths, bool remount_ro)
                         log_warning_errno(r, "Read-only bind remount failed, ignoring: %m");
         }
 
+        r = conf_files_list_strv(&executables, NULL, NULL,
+                                 CONF_FILES_EXECUTABLE|CONF_FILES_REGULAR|CONF_FILES_FILTER_MASKED,
+                                 (const char* const*) paths);
+        if (r < 0)
+                return log_error_errno(r, "Failed to enumerate generators: %m");
+
+        /* Next to the generator output, i.e. /run/systemd/generator-cache/ for the system manager */
+        r = path_extract_directory(m->lookup_paths.generator, &cache_dir);
+        if (r < 0)
+                return log_error_errno(r, "Failed to determine generator cache directory: %m");
+        if (!path_extend(&cache_dir, "generator-cache"))
+                return log_oom();
+
         BLOCK_WITH_UMASK(0022);
-        return execute_directories(
-                        (const char* const*) paths,
+        return generator_cache_execute(
+                        cache_dir,
+                        executables,
                         DEFAULT_TIMEOUT_USEC,
-                        /* callbacks= */ NULL, /* callback_args= */ NULL,
                         (char**) argv,
                         ge,
-                        EXEC_DIR_PARALLEL | EXEC_DIR_IGNORE_ERRORS | EXEC_DIR_SET_SYSTEMD_EXEC_PID);
+                        EXEC_DIR_PARALLEL | EXEC_DIR_IGNORE_ERRORS | EXEC_DIR_SET_SYSTEMD_EXEC_PID,
+                        runtimes_fd);
+}
+
+static void manager_read_generator_runtimes(Manager *m, int fd) {
+        ExecDirRuntime *runtimes;
+        size_t n;
+        int r;
+
+        assert(m);
+        assert(fd >= 0);
+
+        r = exec_dir_runtimes_read(fd, &runtimes, &n);
+        if (r < 0)
+                return (void) log_warning_errno(r, "Failed to read generator runtimes, ignoring: %m");
+
+        exec_dir_runtime_free_many(m->generator_runtimes, m->n_generator_runtimes);
+        m->generator_runtimes = runtimes;
+        m->n_generator_runtimes = n;
 }
 
 static int manager_run_generators(Manager *m) {
         _cleanup_strv_free_ char **paths = NULL;
+        _cleanup_close_ int runtimes_fd = -EBADF;
         int r;
 
         assert(m);
@@ -3805,12 +4214,17 @@ static int manager_run_generators(Manager *m) {
                 goto finish;
         }
 
+        /* The executor reports how long each generator took here, so that 'systemd-analyze blame' can show it */
+        runtimes_fd = open_serialization_fd("generator-runtimes");
+        if (runtimes_fd < 0)
+                log_warning_errno(runtimes_fd, "Failed to open file for generator runtimes, ignoring: %m");
+
         /* If we are the system manager, we fork and invoke the generators in a sanitized mount namespace. If
          * we are the user manager, let's just execute the generators directly. We might not have the
          * necessary privileges, and the system manager has already mounted /tmp/ and everything else for us.
          */
         if (MANAGER_IS_USER(m)) {
-                r = manager_execute_generators(m, paths, /* remount_ro= */ false);
+                r = manager_execute_generators(m, paths, /* remount_ro= */ false, runtimes_fd);
                 goto finish;
         }
 
@@ -3818,11 +4232,14 @@ static int manager_run_generators(Manager *m) {
                       FORK_RESET_SIGNALS | FORK_LOG | FORK_WAIT | FORK_NEW_MOUNTNS | FORK_MOUNTNS_SLAVE | FORK_PRIVATE_TMP,
                       NULL);
         if (r == 0) {
-                r = manager_execute_generators(m, paths, /* remount_ro= */ true);
+                r = manager_execute_generators(m, paths, /* remount_ro= */ true, runtimes_fd);
                 _exit(r >= 0 ? EXIT_SUCCESS : EXIT_FAILURE);
         }
 
 finish:
+        if (runtimes_fd >= 0)
+                manager_read_generator_runtimes(m, runtimes_fd);
+
         lookup_paths_trim_generator(&m->lookup_paths);
         return r;
 }
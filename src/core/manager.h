@@ -10,6 +10,7 @@
 
 #include "cgroup-util.h"
 #include "cgroup.h"
+#include "exec-util.h"
 #include "fdset.h"
 #include "hashmap.h"
 #include "list.h"
@@ -241,6 +242,7 @@ struct Manager {
         Hashmap *unit_name_map;
         Set *unit_path_cache;
         uint64_t unit_cache_timestamp_hash;
+        bool unit_cache_validated; /* The cache was checked against the disk during this load queue run */
 
         char **transient_environment;  /* The environment, as determined from config files, kernel cmdline and environment generators */
         char **client_environment;     /* Environment variables created by clients through the bus API */
@@ -252,6 +254,10 @@ struct Manager {
 
         dual_timestamp timestamps[_MANAGER_TIMESTAMP_MAX];
 
+        /* How long each generator took during the last run */
+        ExecDirRuntime *generator_runtimes;
+        size_t n_generator_runtimes;
+
         /* Data specific to the device subsystem */
         sd_device_monitor *device_monitor;
         Hashmap *devices_by_sysfs;
@@ -306,8 +312,26 @@ struct Manager {
         Hashmap *cgroup_control_inotify_wd_unit;
         Hashmap *cgroup_memory_inotify_wd_unit;
 
+        /* Statistics about cgroup attribute writes, and how many of them we could skip since the value
+         * was already in place */
+        uint64_t n_cgroup_attribute_writes;
+        uint64_t n_cgroup_attribute_writes_skipped;
+
+        /* Statistics about unit change notifications: how many change signals we generated, how many
+         * changes were folded into an already queued signal, and how many we dropped since nobody was
+         * listening */
+        uint64_t n_dbus_unit_signals_sent;
+        uint64_t n_dbus_unit_changes_coalesced;
+        uint64_t n_dbus_unit_changes_suppressed;
+
         /* A defer event for handling cgroup empty events and processing them after SIGCHLD in all cases. */
         sd_event_source *cgroup_empty_event_source;
+
+        /* Statistics about the cgroup empty queue: its current and maximum length, and in how many
+         * batches it was processed */
+        unsigned n_cgroup_empty_queued;
+        unsigned n_cgroup_empty_queued_max;
+        uint64_t n_cgroup_empty_batches;
         sd_event_source *cgroup_oom_event_source;
 
         /* Make sure the user cannot accidentally unmount our cgroup
@@ -456,6 +480,9 @@ struct Manager {
          * we're a user manager, this object manages the client connection from the user manager to
          * systemd-oomd to report changes in ManagedOOM settings (systemd client - oomd server). */
         Varlink *managed_oom_varlink;
+        /* io.systemd.Manager.ListUnits() calls whose remaining replies are generated as their connection's
+         * output buffer drains. Varlink* → ListUnitsOperation* */
+        Hashmap *varlink_list_units;
 
         /* Reference to RestrictFileSystems= BPF program */
         struct restrict_fs_bpf *restrict_fs;
@@ -526,7 +553,7 @@ void manager_trigger_run_queue(Manager *m);
 
 int manager_loop(Manager *m);
 
-int manager_reload(Manager *m);
+int manager_reload(Manager *m, bool full);
 Manager* manager_reloading_start(Manager *m);
 void manager_reloading_stopp(Manager **m);
 
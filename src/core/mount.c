@@ -1787,6 +1787,7 @@ static int mount_setup_unit(
 static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
         _cleanup_(mnt_free_tablep) struct libmnt_table *table = NULL;
         _cleanup_(mnt_free_iterp) struct libmnt_iter *iter = NULL;
+        _cleanup_set_free_ Set *devices = NULL;
         int r;
 
         assert(m);
@@ -1813,7 +1814,10 @@ static int mount_load_proc_self_mountinfo(Manager *m, bool set_flags) {
                 if (!device || !path)
                         continue;
 
-                device_found_node(m, device, DEVICE_FOUND_MOUNT, DEVICE_FOUND_MOUNT);
+                /* The same device typically shows up many times, e.g. for each bind mount of a directory
+                 * on it. Looking it up once per iteration is enough. */
+                if (set_put_strdup_full(&devices, &path_hash_ops_free, device) != 0)
+                        device_found_node(m, device, DEVICE_FOUND_MOUNT, DEVICE_FOUND_MOUNT);
 
                 (void) mount_setup_unit(m, device, path, options, fstype, set_flags);
         }
@@ -2096,15 +2100,25 @@ static int mount_process_proc_self_mountinfo(Manager *m) {
                         }
                 }
 
-                if (mount_is_mounted(mount) &&
-                    mount->from_proc_self_mountinfo &&
+                /* Reset the flags for later calls */
+                mount->proc_flags = 0;
+        }
+
+        /* Most of the time nothing got unmounted, hence only collect the devices still in use when we
+         * need them, rather than copying the source of every mount on each change. */
+        if (set_isempty(gone))
+                return 0;
+
+        LIST_FOREACH(units_by_type, u, m->units_by_type[UNIT_MOUNT]) {
+                Mount *mount = MOUNT(u);
+
+                /* The flags are reset by now, but from_proc_self_mountinfo was turned off above for
+                 * everything that is not mounted anymore. */
+                if (mount->from_proc_self_mountinfo &&
                     mount->parameters_proc_self_mountinfo.what)
                         /* Track devices currently used */
                         if (set_put_strdup_full(&around, &path_hash_ops_free, mount->parameters_proc_self_mountinfo.what) < 0)
                                 log_oom();
-
-                /* Reset the flags for later calls */
-                mount->proc_flags = 0;
         }
 
         SET_FOREACH(what, gone) {
@@ -126,14 +126,80 @@ static void service_init(Unit *u) {
 }
 
 static void service_unwatch_control_pid(Service *s) {
+        ExecCommand *c;
+        void *p;
+
         assert(s);
 
+        /* The other processes of a group of parallel control commands go together with the control process */
+        HASHMAP_FOREACH_KEY(c, p, s->parallel_control_pids)
+                if (PTR_TO_PID(p) != s->control_pid)
+                        unit_unwatch_pid(UNIT(s), PTR_TO_PID(p));
+
+        s->parallel_control_pids = hashmap_free(s->parallel_control_pids);
+        s->parallel_control_result = SERVICE_SUCCESS;
+
         if (s->control_pid <= 0)
                 return;
 
         unit_unwatch_pid(UNIT(s), TAKE_PID(s->control_pid));
 }
 
+static bool service_kill_parallel_control_pids(Service *s, int sig) {
+        bool killed = false;
+        ExecCommand *c;
+        void *p;
+        int r;
+
+        assert(s);
+
+        /* Sends a signal to the processes of a group of parallel control commands, except the control process
+         * itself, which is taken care of by the caller. Returns true if any of them was signalled. */
+
+        HASHMAP_FOREACH_KEY(c, p, s->parallel_control_pids) {
+                pid_t pid = PTR_TO_PID(p);
+
+                if (pid == s->control_pid)
+                        continue;
+
+                r = kill_and_sigcont(pid, sig);
+                if (r < 0) {
+                        _cleanup_free_ char *comm = NULL;
+
+                        if (r == -ESRCH)
+                                continue;
+
+                        (void) get_process_comm(pid, &comm);
+                        log_unit_debug_errno(UNIT(s), r, "Failed to kill control process " PID_FMT " (%s), ignoring: %m",
+                                             pid, strna(comm));
+                } else
+                        killed = true;
+        }
+
+        return killed;
+}
+
+static void service_kill_control_process(Service *s) {
+        int r;
+
+        assert(s);
+
+        (void) service_kill_parallel_control_pids(s, SIGKILL);
+
+        if (s->control_pid <= 0)
+                return;
+
+        r = kill_and_sigcont(s->control_pid, SIGKILL);
+        if (r < 0) {
+                _cleanup_free_ char *comm = NULL;
+
+                (void) get_process_comm(s->control_pid, &comm);
+
+                log_unit_debug_errno(UNIT(s), r, "Failed to kill control process " PID_FMT " (%s), ignoring: %m",
+                                     s->control_pid, strna(comm));
+        }
+}
+
 static void service_unwatch_main_pid(Service *s) {
         assert(s);
 
@@ -810,6 +876,8 @@ static void service_dump(Unit *u, FILE *f, const char *prefix) {
         ServiceExecCommand c;
         Service *s = SERVICE(u);
         const char *prefix2;
+        ExecCommand *cmd;
+        void *p;
 
         assert(s);
 
@@ -849,6 +917,12 @@ static void service_dump(Unit *u, FILE *f, const char *prefix) {
                         "%sControl PID: "PID_FMT"\n",
                         prefix, s->control_pid);
 
+        HASHMAP_FOREACH_KEY(cmd, p, s->parallel_control_pids)
+                if (PTR_TO_PID(p) != s->control_pid)
+                        fprintf(f,
+                                "%sParallel Control PID: "PID_FMT"\n",
+                                prefix, PTR_TO_PID(p));
+
         if (s->main_pid > 0)
                 fprintf(f,
                         "%sMain PID: "PID_FMT"\n"
@@ -1186,6 +1260,8 @@ static usec_t service_coldplug_timeout(Service *s) {
 
 static int service_coldplug(Unit *u) {
         Service *s = SERVICE(u);
+        ExecCommand *c;
+        void *p;
         int r;
 
         assert(s);
@@ -1223,6 +1299,23 @@ static int service_coldplug(Unit *u) {
                         return r;
         }
 
+        HASHMAP_FOREACH_KEY(c, p, s->parallel_control_pids) {
+                pid_t pid = PTR_TO_PID(p);
+
+                if (pid == s->control_pid)
+                        continue;
+
+                /* A parallel control process that went away while we were reloading is not waited for anymore */
+                if (!pid_is_unwaited(pid)) {
+                        (void) hashmap_remove(s->parallel_control_pids, p);
+                        continue;
+                }
+
+                r = unit_watch_pid(UNIT(s), pid, false);
+                if (r < 0)
+                        return r;
+        }
+
         if (!IN_SET(s->deserialized_state, SERVICE_DEAD, SERVICE_FAILED, SERVICE_AUTO_RESTART, SERVICE_CLEANING)) {
                 (void) unit_enqueue_rewatch_pids(u);
                 (void) unit_setup_dynamic_creds(u);
@@ -1692,6 +1785,65 @@ static int service_spawn_internal(
         return 0;
 }
 
+static bool service_control_command_is_parallel(Service *s, ExecCommand *c) {
+        assert(s);
+
+        return c &&
+                FLAGS_SET(c->flags, EXEC_COMMAND_PARALLEL) &&
+                IN_SET(s->control_command_id, SERVICE_EXEC_START_PRE, SERVICE_EXEC_START_POST, SERVICE_EXEC_STOP_POST);
+}
+
+static int service_spawn_control(Service *s, usec_t timeout, ExecFlags flags) {
+        int r;
+
+        assert(s);
+        assert(s->control_command);
+        assert(hashmap_isempty(s->parallel_control_pids));
+
+        /* Spawns s->control_command as the control process. If it starts a group of consecutive commands
+         * prefixed with "&", all of them are spawned at once, and s->control_command is advanced to the last
+         * one, so that the next group is started once the whole group has finished. */
+
+        r = service_spawn(s, s->control_command, timeout, flags, &s->control_pid);
+        if (r < 0)
+                return r;
+
+        if (!service_control_command_is_parallel(s, s->control_command) ||
+            !service_control_command_is_parallel(s, s->control_command->command_next))
+                return 0;
+
+        r = hashmap_ensure_put(&s->parallel_control_pids, NULL, PID_TO_PTR(s->control_pid), s->control_command);
+        if (r < 0)
+                goto fail;
+
+        while (service_control_command_is_parallel(s, s->control_command->command_next)) {
+                pid_t pid;
+
+                s->control_command = s->control_command->command_next;
+
+                /* Credentials are written once, by the first command */
+                r = service_spawn(s, s->control_command, timeout, flags & ~EXEC_WRITE_CREDENTIALS, &pid);
+                if (r < 0)
+                        goto fail;
+
+                r = hashmap_put(s->parallel_control_pids, PID_TO_PTR(pid), s->control_command);
+                if (r < 0) {
+                        (void) kill_and_sigcont(pid, SIGKILL);
+                        unit_unwatch_pid(UNIT(s), pid);
+                        goto fail;
+                }
+        }
+
+        log_unit_debug(UNIT(s), "Started %u control processes in parallel.", hashmap_size(s->parallel_control_pids));
+        return 0;
+
+fail:
+        /* Don't leave the part of the group behind that was already started */
+        service_kill_control_process(s);
+        service_unwatch_control_pid(s);
+        return r;
+}
+
 static int main_pid_good(Service *s) {
         assert(s);
 
@@ -1918,11 +2070,9 @@ static void service_enter_stop_post(Service *s, ServiceResult f) {
         if (s->control_command) {
                 s->control_command_id = SERVICE_EXEC_STOP_POST;
 
-                r = service_spawn(s,
-                                  s->control_command,
-                                  s->timeout_stop_usec,
-                                  EXEC_APPLY_SANDBOXING|EXEC_APPLY_CHROOT|EXEC_APPLY_TTY_STDIN|EXEC_IS_CONTROL|EXEC_SETENV_RESULT|EXEC_CONTROL_CGROUP,
-                                  &s->control_pid);
+                r = service_spawn_control(s,
+                                          s->timeout_stop_usec,
+                                          EXEC_APPLY_SANDBOXING|EXEC_APPLY_CHROOT|EXEC_APPLY_TTY_STDIN|EXEC_IS_CONTROL|EXEC_SETENV_RESULT|EXEC_CONTROL_CGROUP);
                 if (r < 0)
                         goto fail;
 
@@ -1987,6 +2137,19 @@ static void service_enter_signal(Service *s, ServiceState state, ServiceResult f
         if (r < 0)
                 goto fail;
 
+        /* unit_kill_context() only knows about a single control process. Signal the rest of a group of
+         * parallel control commands the same way, unless they are covered by killing the cgroup already. */
+        if (!hashmap_isempty(s->parallel_control_pids) &&
+            s->kill_context.kill_mode != KILL_NONE &&
+            !(UNIT(s)->cgroup_path &&
+              (s->kill_context.kill_mode == KILL_CONTROL_GROUP ||
+               (s->kill_context.kill_mode == KILL_MIXED && kill_operation == KILL_KILL)))) {
+                bool noteworthy;
+
+                if (service_kill_parallel_control_pids(s, operation_to_signal(&s->kill_context, kill_operation, &noteworthy)))
+                        r = 1;
+        }
+
         if (r > 0) {
                 r = service_arm_timer(s, usec_add(now(CLOCK_MONOTONIC),
                                       kill_operation == KILL_WATCHDOG ? service_timeout_abort_usec(s) : s->timeout_stop_usec));
@@ -2118,11 +2281,9 @@ static void service_enter_start_post(Service *s) {
         if (s->control_command) {
                 s->control_command_id = SERVICE_EXEC_START_POST;
 
-                r = service_spawn(s,
-                                  s->control_command,
-                                  s->timeout_start_usec,
-                                  EXEC_APPLY_SANDBOXING|EXEC_APPLY_CHROOT|EXEC_IS_CONTROL|EXEC_CONTROL_CGROUP,
-                                  &s->control_pid);
+                r = service_spawn_control(s,
+                                          s->timeout_start_usec,
+                                          EXEC_APPLY_SANDBOXING|EXEC_APPLY_CHROOT|EXEC_IS_CONTROL|EXEC_CONTROL_CGROUP);
                 if (r < 0)
                         goto fail;
 
@@ -2137,25 +2298,6 @@ fail:
         service_enter_stop(s, SERVICE_FAILURE_RESOURCES);
 }
 
-static void service_kill_control_process(Service *s) {
-        int r;
-
-        assert(s);
-
-        if (s->control_pid <= 0)
-                return;
-
-        r = kill_and_sigcont(s->control_pid, SIGKILL);
-        if (r < 0) {
-                _cleanup_free_ char *comm = NULL;
-
-                (void) get_process_comm(s->control_pid, &comm);
-
-                log_unit_debug_errno(UNIT(s), r, "Failed to kill control process " PID_FMT " (%s), ignoring: %m",
-                                     s->control_pid, strna(comm));
-        }
-}
-
 static int service_adverse_to_leftover_processes(Service *s) {
         assert(s);
 
@@ -2289,11 +2431,9 @@ static void service_enter_start_pre(Service *s) {
 
                 s->control_command_id = SERVICE_EXEC_START_PRE;
 
-                r = service_spawn(s,
-                                  s->control_command,
-                                  s->timeout_start_usec,
-                                  EXEC_APPLY_SANDBOXING|EXEC_APPLY_CHROOT|EXEC_IS_CONTROL|EXEC_APPLY_TTY_STDIN|EXEC_SETENV_MONITOR_RESULT|EXEC_WRITE_CREDENTIALS,
-                                  &s->control_pid);
+                r = service_spawn_control(s,
+                                          s->timeout_start_usec,
+                                          EXEC_APPLY_SANDBOXING|EXEC_APPLY_CHROOT|EXEC_IS_CONTROL|EXEC_APPLY_TTY_STDIN|EXEC_SETENV_MONITOR_RESULT|EXEC_WRITE_CREDENTIALS);
                 if (r < 0)
                         goto fail;
 
@@ -2456,15 +2596,13 @@ static void service_run_next_control(Service *s) {
         else
                 timeout = s->timeout_stop_usec;
 
-        r = service_spawn(s,
-                          s->control_command,
-                          timeout,
-                          EXEC_APPLY_SANDBOXING|EXEC_APPLY_CHROOT|EXEC_IS_CONTROL|
-                          (IN_SET(s->control_command_id, SERVICE_EXEC_CONDITION, SERVICE_EXEC_START_PRE, SERVICE_EXEC_STOP_POST) ? EXEC_APPLY_TTY_STDIN : 0)|
-                          (IN_SET(s->control_command_id, SERVICE_EXEC_STOP, SERVICE_EXEC_STOP_POST) ? EXEC_SETENV_RESULT : 0)|
-                          (IN_SET(s->control_command_id, SERVICE_EXEC_START_PRE, SERVICE_EXEC_START) ? EXEC_SETENV_MONITOR_RESULT : 0)|
-                          (IN_SET(s->control_command_id, SERVICE_EXEC_START_POST, SERVICE_EXEC_RELOAD, SERVICE_EXEC_STOP, SERVICE_EXEC_STOP_POST) ? EXEC_CONTROL_CGROUP : 0),
-                          &s->control_pid);
+        r = service_spawn_control(s,
+                                  timeout,
+                                  EXEC_APPLY_SANDBOXING|EXEC_APPLY_CHROOT|EXEC_IS_CONTROL|
+                                  (IN_SET(s->control_command_id, SERVICE_EXEC_CONDITION, SERVICE_EXEC_START_PRE, SERVICE_EXEC_STOP_POST) ? EXEC_APPLY_TTY_STDIN : 0)|
+                                  (IN_SET(s->control_command_id, SERVICE_EXEC_STOP, SERVICE_EXEC_STOP_POST) ? EXEC_SETENV_RESULT : 0)|
+                                  (IN_SET(s->control_command_id, SERVICE_EXEC_START_PRE, SERVICE_EXEC_START) ? EXEC_SETENV_MONITOR_RESULT : 0)|
+                                  (IN_SET(s->control_command_id, SERVICE_EXEC_START_POST, SERVICE_EXEC_RELOAD, SERVICE_EXEC_STOP, SERVICE_EXEC_STOP_POST) ? EXEC_CONTROL_CGROUP : 0));
         if (r < 0)
                 goto fail;
 
@@ -2714,6 +2852,8 @@ static int service_serialize_exec_command(Unit *u, FILE *f, ExecCommand *command
 
 static int service_serialize(Unit *u, FILE *f, FDSet *fds) {
         Service *s = SERVICE(u);
+        ExecCommand *c;
+        void *p;
         int r;
 
         assert(u);
@@ -2732,7 +2872,7 @@ static int service_serialize(Unit *u, FILE *f, FDSet *fds) {
 
         (void) serialize_bool(f, "main-pid-known", s->main_pid_known);
         (void) serialize_bool(f, "bus-name-good", s->bus_name_good);
-        (void) serialize_bool(f, "bus-name-owner", s->bus_name_owner);
+        (void) serialize_item(f, "bus-name-owner", s->bus_name_owner);
 
         (void) serialize_item_format(f, "n-restarts", "%u", s->n_restarts);
         (void) serialize_bool(f, "flush-n-restarts", s->flush_n_restarts);
@@ -2744,6 +2884,17 @@ static int service_serialize(Unit *u, FILE *f, FDSet *fds) {
         service_serialize_exec_command(u, f, s->control_command);
         service_serialize_exec_command(u, f, s->main_command);
 
+        /* Must come after the control command, so that we know which command list the indexes refer to */
+        HASHMAP_FOREACH_KEY(c, p, s->parallel_control_pids)
+                if (c && s->control_command_id >= 0)
+                        (void) serialize_item_format(f, "parallel-control-pid", PID_FMT " %u",
+                                                     PTR_TO_PID(p), service_exec_command_index(u, s->control_command_id, c));
+                else
+                        (void) serialize_item_format(f, "parallel-control-pid", PID_FMT, PTR_TO_PID(p));
+
+        if (s->parallel_control_result != SERVICE_SUCCESS)
+                (void) serialize_item(f, "parallel-control-result", service_result_to_string(s->parallel_control_result));
+
         r = serialize_fd(f, fds, "stdin-fd", s->stdin_fd);
         if (r < 0)
                 return r;
@@ -2954,6 +3105,38 @@ static int service_deserialize_item(Unit *u, const char *key, const char *value,
                         log_unit_debug(u, "Failed to parse control-pid value: %s", value);
                 else
                         s->control_pid = pid;
+        } else if (streq(key, "parallel-control-pid")) {
+                _cleanup_free_ char *word = NULL;
+                const char *v = value;
+                ExecCommand *c = NULL;
+                pid_t pid;
+
+                /* "PID [INDEX]", the index of the command in the list of the control command */
+                r = extract_first_word(&v, &word, NULL, 0);
+                if (r <= 0 || parse_pid(word, &pid) < 0)
+                        log_unit_debug(u, "Failed to parse parallel-control-pid value: %s", value);
+                else {
+                        unsigned idx;
+
+                        if (!isempty(v) &&
+                            s->control_command_id >= 0 &&
+                            safe_atou(v, &idx) >= 0)
+                                for (c = s->exec_command[s->control_command_id]; c && idx > 0; c = c->command_next)
+                                        idx--;
+
+                        r = hashmap_ensure_put(&s->parallel_control_pids, NULL, PID_TO_PTR(pid), c);
+                        if (r < 0)
+                                log_unit_debug_errno(u, r, "Failed to store parallel control PID " PID_FMT ", ignoring: %m", pid);
+                }
+        } else if (streq(key, "parallel-control-result")) {
+                ServiceResult f;
+
+                f = service_result_from_string(value);
+                if (f < 0)
+                        log_unit_debug(u, "Failed to parse parallel control result value: %s", value);
+                else
+                        s->parallel_control_result = f;
+
         } else if (streq(key, "main-pid")) {
                 pid_t pid;
 
@@ -3629,16 +3812,22 @@ static void service_sigchld_event(Unit *u, pid_t pid, int code, int status) {
                         }
                 }
 
-        } else if (s->control_pid == pid) {
+        } else if (s->control_pid == pid || hashmap_contains(s->parallel_control_pids, PID_TO_PTR(pid))) {
+                ExecCommand *c;
                 const char *kind;
                 bool success;
 
-                s->control_pid = 0;
+                /* In a group of parallel control commands, each process has its own command */
+                c = hashmap_isempty(s->parallel_control_pids) ? s->control_command :
+                        hashmap_remove(s->parallel_control_pids, PID_TO_PTR(pid));
 
-                if (s->control_command) {
-                        exec_status_exit(&s->control_command->exec_status, &s->exec_context, pid, code, status);
+                if (s->control_pid == pid)
+                        s->control_pid = 0;
 
-                        if (s->control_command->flags & EXEC_COMMAND_IGNORE_FAILURE)
+                if (c) {
+                        exec_status_exit(&c->exec_status, &s->exec_context, pid, code, status);
+
+                        if (c->flags & EXEC_COMMAND_IGNORE_FAILURE)
                                 f = SERVICE_SUCCESS;
                 }
 
@@ -3667,6 +3856,28 @@ static void service_sigchld_event(Unit *u, pid_t pid, int code, int status) {
                                 success,
                                 code, status);
 
+                if (s->parallel_control_pids) {
+                        /* The first failure of the group counts, but only once all of the group is gone */
+                        if (s->parallel_control_result == SERVICE_SUCCESS)
+                                s->parallel_control_result = f;
+
+                        if (!hashmap_isempty(s->parallel_control_pids)) {
+                                if (s->control_pid == 0)
+                                        s->control_pid = PTR_TO_PID(hashmap_first_key(s->parallel_control_pids));
+
+                                log_unit_debug(u, "Waiting for %u further control processes for state %s.",
+                                               hashmap_size(s->parallel_control_pids), service_state_to_string(s->state));
+
+                                /* Notify clients about changed exit status */
+                                unit_add_to_dbus_queue(u);
+                                return;
+                        }
+
+                        f = s->parallel_control_result;
+                        s->parallel_control_result = SERVICE_SUCCESS;
+                        s->parallel_control_pids = hashmap_free(s->parallel_control_pids);
+                }
+
                 if (s->state != SERVICE_RELOAD && s->result == SERVICE_SUCCESS)
                         s->result = f;
 
@@ -4473,9 +4684,32 @@ static void service_reset_failed(Unit *u) {
 
 static int service_kill(Unit *u, KillWho who, int signo, sd_bus_error *error) {
         Service *s = SERVICE(u);
+        ExecCommand *c;
+        void *p;
 
         assert(s);
 
+        /* The control processes of a parallel group other than control_pid are signalled too when the
+         * control process is targeted. The whole cgroup is signalled anyway for KILL_ALL. */
+        if (IN_SET(who, KILL_CONTROL, KILL_CONTROL_FAIL))
+                HASHMAP_FOREACH_KEY(c, p, s->parallel_control_pids) {
+                        _cleanup_free_ char *comm = NULL;
+                        pid_t pid = PTR_TO_PID(p);
+
+                        if (pid == s->control_pid)
+                                continue;
+
+                        (void) get_process_comm(pid, &comm);
+
+                        if (kill(pid, signo) < 0)
+                                log_unit_warning_errno(u, errno,
+                                                       "Failed to send signal SIG%s to control process " PID_FMT " (%s) on client request, ignoring: %m",
+                                                       signal_to_string(signo), pid, strna(comm));
+                        else
+                                log_unit_info(u, "Sent signal SIG%s to control process " PID_FMT " (%s) on client request.",
+                                              signal_to_string(signo), pid, strna(comm));
+                }
+
         return unit_kill_common(u, who, signo, s->main_pid, s->control_pid, error);
 }
 
@@ -158,6 +158,11 @@ struct Service {
 
         pid_t main_pid, control_pid;
 
+        /* While a group of consecutive "&" control commands runs: all their PIDs, mapped to their
+         * ExecCommand. control_pid is one of them, control_command the last command of the group. */
+        Hashmap *parallel_control_pids;
+        ServiceResult parallel_control_result;
+
         /* if we are a socket activated service instance, store information of the connection/peer/socket */
         int socket_fd;
         SocketPeer *socket_peer;
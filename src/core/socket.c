@@ -47,6 +47,9 @@
 #include "unit.h"
 #include "user-util.h"
 
+/* How many pending connections to accept per wakeup of a listening Accept=yes socket */
+#define SOCKET_ACCEPT_BATCH_MAX 16
+
 struct SocketPeer {
         unsigned n_ref;
 
@@ -2898,17 +2901,51 @@ static int socket_accept_do(Socket *s, int fd) {
         return cfd;
 }
 
-static int socket_accept_in_cgroup(Socket *s, SocketPort *p, int fd) {
+static int socket_accept_many(Socket *s, int fd, int *ret_fds, size_t max) {
+        size_t n = 0;
+        int cfd;
+
+        assert(s);
+        assert(fd >= 0);
+        assert(ret_fds);
+        assert(max > 0);
+
+        /* Accepts up to max pending connections. Returns the number of connection sockets, or -EAGAIN if
+         * there was nothing to accept. Errors after the first connection end the batch early, they'll be
+         * seen again on the next accept(). */
+
+        while (n < max) {
+                cfd = socket_accept_do(s, fd);
+                if (cfd == -EAGAIN)
+                        break;
+                if (cfd < 0) {
+                        if (n > 0)
+                                break;
+                        return cfd;
+                }
+
+                ret_fds[n++] = cfd;
+        }
+
+        return n > 0 ? (int) n : -EAGAIN;
+}
+
+static int socket_accept_in_cgroup(Socket *s, SocketPort *p, int fd, int *ret_fds, size_t max) {
         _cleanup_close_pair_ int pair[2] = PIPE_EBADF;
-        int cfd, r;
+        int cfd = -EBADF, r;
+        size_t n = 0;
         pid_t pid;
 
         assert(s);
         assert(p);
         assert(fd >= 0);
+        assert(ret_fds);
+        assert(max > 0);
 
         /* Similar to socket_address_listen_in_cgroup(), but for accept() rather than socket(): make sure that any
-         * connection socket is also properly associated with the cgroup. */
+         * connection socket is also properly associated with the cgroup. Since this requires forking off a
+         * helper, let it accept everything that is pending (up to max), instead of one fork per connection.
+         * Returns the number of connection sockets stored in ret_fds. */
 
         if (!IN_SET(p->address.sockaddr.sa.sa_family, AF_INET, AF_INET6))
                 goto shortcut;
@@ -2930,55 +2967,71 @@ static int socket_accept_in_cgroup(Socket *s, SocketPort *p, int fd) {
 
                 pair[0] = safe_close(pair[0]);
 
-                cfd = socket_accept_do(s, fd);
-                if (cfd == -EAGAIN) /* spurious accept() */
-                        _exit(EXIT_SUCCESS);
-                if (cfd < 0) {
-                        log_unit_error_errno(UNIT(s), cfd, "Failed to accept connection socket: %m");
-                        _exit(EXIT_FAILURE);
-                }
+                for (size_t i = 0; i < max; i++) {
+                        cfd = socket_accept_do(s, fd);
+                        if (cfd == -EAGAIN) /* spurious accept(), or no more connections pending */
+                                _exit(EXIT_SUCCESS);
+                        if (cfd < 0) {
+                                if (i > 0) /* Let the parent handle what we got so far */
+                                        _exit(EXIT_SUCCESS);
 
-                r = send_one_fd(pair[1], cfd, 0);
-                if (r < 0) {
-                        log_unit_error_errno(UNIT(s), r, "Failed to send connection socket to parent: %m");
-                        _exit(EXIT_FAILURE);
+                                log_unit_error_errno(UNIT(s), cfd, "Failed to accept connection socket: %m");
+                                _exit(EXIT_FAILURE);
+                        }
+
+                        r = send_one_fd(pair[1], cfd, 0);
+                        if (r < 0) {
+                                log_unit_error_errno(UNIT(s), r, "Failed to send connection socket to parent: %m");
+                                _exit(EXIT_FAILURE);
+                        }
+
+                        cfd = safe_close(cfd);
                 }
 
                 _exit(EXIT_SUCCESS);
         }
 
         pair[1] = safe_close(pair[1]);
-        cfd = receive_one_fd(pair[0], 0);
+
+        /* Read until the helper closes its end of the channel, which makes receive_one_fd() fail with EIO */
+        while (n < max) {
+                cfd = receive_one_fd(pair[0], 0);
+                if (cfd < 0)
+                        break;
+
+                ret_fds[n++] = cfd;
+        }
 
         /* We synchronously wait for the helper, as it shouldn't be slow */
         r = wait_for_terminate_and_check("(sd-accept)", pid, WAIT_LOG_ABNORMAL);
         if (r < 0) {
-                safe_close(cfd);
+                close_many(ret_fds, n);
                 return r;
         }
 
         /* If we received no fd, we got EIO here. If this happens with a process exit code of EXIT_SUCCESS
          * this is a spurious accept(), let's convert that back to EAGAIN here. */
-        if (cfd == -EIO)
+        if (n == 0 && cfd == -EIO)
                 return -EAGAIN;
-        if (cfd < 0)
+        if (n == 0)
                 return log_unit_error_errno(UNIT(s), cfd, "Failed to receive connection socket: %m");
 
-        return cfd;
+        return (int) n;
 
 shortcut:
-        cfd = socket_accept_do(s, fd);
-        if (cfd == -EAGAIN) /* spurious accept(), skip it silently */
+        r = socket_accept_many(s, fd, ret_fds, max);
+        if (r == -EAGAIN) /* spurious accept(), skip it silently */
                 return -EAGAIN;
-        if (cfd < 0)
-                return log_unit_error_errno(UNIT(s), cfd, "Failed to accept connection socket: %m");
+        if (r < 0)
+                return log_unit_error_errno(UNIT(s), r, "Failed to accept connection socket: %m");
 
-        return cfd;
+        return r;
 }
 
 static int socket_dispatch_io(sd_event_source *source, int fd, uint32_t revents, void *userdata) {
         SocketPort *p = ASSERT_PTR(userdata);
-        int cfd = -EBADF;
+        int cfds[SOCKET_ACCEPT_BATCH_MAX];
+        int n;
 
         assert(fd >= 0);
 
@@ -2995,20 +3048,35 @@ static int socket_dispatch_io(sd_event_source *source, int fd, uint32_t revents,
                 goto fail;
         }
 
-        if (p->socket->accept &&
-            p->type == SOCKET_SOCKET &&
-            socket_address_can_accept(&p->address)) {
+        if (!p->socket->accept ||
+            p->type != SOCKET_SOCKET ||
+            !socket_address_can_accept(&p->address)) {
+                socket_enter_running(p->socket, -EBADF);
+                return 0;
+        }
 
-                cfd = socket_accept_in_cgroup(p->socket, p, fd);
-                if (cfd == -EAGAIN) /* Spurious accept() */
-                        return 0;
-                if (cfd < 0)
-                        goto fail;
+        /* Take everything that queued up since the last wakeup in one go, so that a burst of connections
+         * doesn't cost one event loop iteration (and possibly one accept helper process) each. */
+        n = socket_accept_in_cgroup(p->socket, p, fd, cfds, ELEMENTSOF(cfds));
+        if (n == -EAGAIN) /* Spurious accept() */
+                return 0;
+        if (n < 0)
+                goto fail;
+
+        for (int i = 0; i < n; i++) {
+                /* Starting a connection service might have failed, and put the socket into a stopping
+                 * state. The listening socket is closed then anyway, hence drop the remaining connections
+                 * the same way. */
+                if (p->socket->state != SOCKET_LISTENING) {
+                        log_unit_debug(UNIT(p->socket), "Socket is not listening anymore, dropping %i connection(s).", n - i);
+                        close_many(cfds + i, n - i);
+                        break;
+                }
 
-                socket_apply_socket_options(p->socket, p, cfd);
+                socket_apply_socket_options(p->socket, p, cfds[i]);
+                socket_enter_running(p->socket, cfds[i]);
         }
 
-        socket_enter_running(p->socket, cfd);
         return 0;
 
 fail:
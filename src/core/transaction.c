@@ -286,6 +286,10 @@ static void transaction_drop_redundant(Transaction *tr) {
 
                 again = false;
 
+                /* Whether a job is redundant only depends on its own unit, and deleting it without its
+                 * dependencies doesn't touch any other entry of the hashmap. Hence there is no need to
+                 * restart the iteration after each deletion, which would make this quadratic in the number
+                 * of jobs, e.g. for the many redundant stop jobs an isolate request adds. */
                 HASHMAP_FOREACH(j, tr->jobs) {
                         bool keep = false;
 
@@ -300,9 +304,13 @@ static void transaction_drop_redundant(Transaction *tr) {
                         if (!keep) {
                                 log_trace("Found redundant job %s/%s, dropping from transaction.",
                                           j->unit->id, job_type_to_string(j->type));
+
+                                /* If the unit has more jobs, the next one took this one's place in the
+                                 * hashmap, look at it in the next round. */
+                                if (j->transaction_next)
+                                        again = true;
+
                                 transaction_delete_job(tr, j, false);
-                                again = true;
-                                break;
                         }
                 }
         } while (again);
@@ -507,6 +515,9 @@ static void transaction_collect_garbage(Transaction *tr) {
 
                 again = false;
 
+                /* A job without an object list has nothing that would be deleted along with it, hence we
+                 * can keep iterating after deleting it. Its subjects might have become garbage now though,
+                 * so go round again until nothing changes anymore. */
                 HASHMAP_FOREACH(j, tr->jobs) {
                         if (tr->anchor_job == j)
                                 continue;
@@ -515,7 +526,7 @@ static void transaction_collect_garbage(Transaction *tr) {
                                 log_trace("Garbage collecting job %s/%s", j->unit->id, job_type_to_string(j->type));
                                 transaction_delete_job(tr, j, true);
                                 again = true;
-                                break;
+                                continue;
                         }
 
                         log_trace("Keeping job %s/%s because of %s/%s",
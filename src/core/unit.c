@@ -499,13 +499,20 @@ void unit_add_to_dbus_queue(Unit *u) {
         assert(u);
         assert(u->type != _UNIT_TYPE_INVALID);
 
-        if (u->load_state == UNIT_STUB || u->in_dbus_queue)
+        if (u->load_state == UNIT_STUB)
                 return;
 
+        /* Already queued? Then the signal we'll send covers this change too */
+        if (u->in_dbus_queue) {
+                u->manager->n_dbus_unit_changes_coalesced++;
+                return;
+        }
+
         /* Shortcut things if nobody cares */
         if (sd_bus_track_count(u->manager->subscribed) <= 0 &&
             sd_bus_track_count(u->bus_track) <= 0 &&
             set_isempty(u->manager->private_buses)) {
+                u->manager->n_dbus_unit_changes_suppressed++;
                 u->sent_dbus_new_signal = true;
                 return;
         }
@@ -760,8 +767,10 @@ Unit* unit_free(Unit *u) {
         if (u->in_cgroup_realize_queue)
                 LIST_REMOVE(cgroup_realize_queue, u->manager->cgroup_realize_queue, u);
 
-        if (u->in_cgroup_empty_queue)
+        if (u->in_cgroup_empty_queue) {
                 LIST_REMOVE(cgroup_empty_queue, u->manager->cgroup_empty_queue, u);
+                u->manager->n_cgroup_empty_queued--;
+        }
 
         if (u->in_cgroup_oom_queue)
                 LIST_REMOVE(cgroup_oom_queue, u->manager->cgroup_oom_queue, u);
@@ -4511,7 +4520,7 @@ static int log_kill(pid_t pid, int sig, void *userdata) {
         return 1;
 }
 
-static int operation_to_signal(const KillContext *c, KillOperation k, bool *noteworthy) {
+int operation_to_signal(const KillContext *c, KillOperation k, bool *noteworthy) {
         assert(c);
 
         switch (k) {
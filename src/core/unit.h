@@ -235,6 +235,9 @@ typedef struct Unit {
         usec_t source_mtime;
         usec_t dropin_mtime;
 
+        /* Hash over the unit files this unit was loaded from, used to skip unchanged units on reload */
+        uint64_t files_fingerprint;
+
         /* If this is a transient unit we are currently writing, this is where we are writing it to */
         FILE *transient_file;
 
@@ -369,6 +372,7 @@ typedef struct Unit {
         /* Where the io.stat data was at the time the unit was started */
         uint64_t io_accounting_base[_CGROUP_IO_ACCOUNTING_METRIC_MAX];
         uint64_t io_accounting_last[_CGROUP_IO_ACCOUNTING_METRIC_MAX]; /* the most recently read value */
+        usec_t io_accounting_timestamp; /* event loop iteration io_accounting_last[] was read in */
 
         /* Counterparts in the cgroup filesystem */
         char *cgroup_path;
@@ -378,6 +382,11 @@ typedef struct Unit {
         CGroupMask cgroup_invalidated_mask;        /* A mask specifying controllers which shall be considered invalidated, and require re-realization */
         CGroupMask cgroup_members_mask;            /* A cache for the controllers required by all children of this cgroup (only relevant for slice units) */
 
+        /* The values we last successfully wrote to the cgroup attributes, so that we can skip writes that
+         * wouldn't change anything. Flushed whenever the cgroup or its set of controllers changes, and when
+         * the cgroup is invalidated. Not serialized, hence empty again after daemon-reload. */
+        Hashmap *cgroup_attribute_cache;
+
         /* Inotify watch descriptors for watching cgroup.events and memory.events on cgroupv2 */
         int cgroup_control_inotify_wd;
         int cgroup_memory_inotify_wd;
@@ -976,6 +985,7 @@ int unit_write_setting(Unit *u, UnitWriteFlags flags, const char *name, const ch
 int unit_write_settingf(Unit *u, UnitWriteFlags mode, const char *name, const char *format, ...) _printf_(4,5);
 
 int unit_kill_context(Unit *u, KillContext *c, KillOperation k, pid_t main_pid, pid_t control_pid, bool main_pid_alien);
+int operation_to_signal(const KillContext *c, KillOperation k, bool *noteworthy);
 
 int unit_make_transient(Unit *u);
 
@@ -190,6 +190,16 @@ static uint64_t storage_size_max(void) {
         return 0;
 }
 
+#if HAVE_COMPRESSION
+static uint64_t uncompressed_size_max(void) {
+        /* When compressing, the uncompressed copy of the core is only used for generating the backtrace, or
+         * for storing it in the journal. */
+        if (arg_storage == COREDUMP_STORAGE_JOURNAL)
+                return MAX(arg_process_size_max, arg_journal_size_max);
+        return arg_process_size_max;
+}
+#endif
+
 static int fix_acl(int fd, uid_t uid, bool allow_user) {
         assert(fd >= 0);
         assert(uid_is_valid(uid));
@@ -487,6 +497,20 @@ static int grant_user_access(int core_fd, const Context *context) {
         return ret;
 }
 
+#if HAVE_COMPRESSION
+static int input_has_more(int input_fd) {
+        char c;
+        ssize_t n;
+
+        /* We consumed all we were allowed to, check if anything is left over. */
+        n = loop_read(input_fd, &c, 1, true);
+        if (n < 0)
+                return (int) n;
+
+        return n > 0;
+}
+#endif
+
 static int save_external_coredump(
                 const Context *context,
                 int input_fd,
@@ -500,8 +524,8 @@ static int save_external_coredump(
         _cleanup_(unlink_and_freep) char *tmp = NULL;
         _cleanup_free_ char *fn = NULL;
         _cleanup_close_ int fd = -EBADF;
-        uint64_t rlimit, process_limit, max_size;
-        bool truncated, storage_on_tmpfs;
+        uint64_t rlimit, process_limit, max_size, copy_size;
+        bool truncated, storage_on_tmpfs, partial = false;
         struct stat st;
         uid_t uid;
         int r;
@@ -603,11 +627,23 @@ static int save_external_coredump(
                 log_debug("Limiting core file size to %" PRIu64 " bytes due to cgroup memory limits.", max_size);
         }
 
-        r = copy_bytes(input_fd, fd, max_size, 0);
+        /* If we are going to compress the core anyway, there's no point in writing out more of it uncompressed
+         * than we are going to look at (but always keep the beginning, the ELF header is checked below). If
+         * the core turns out to be larger than that, the rest is compressed straight from the pipe below,
+         * rather than from a full uncompressed copy. */
+        copy_size = max_size;
+#if HAVE_COMPRESSION
+        if (arg_compress)
+                copy_size = MIN(copy_size, MAX(uncompressed_size_max(), (uint64_t) PROCESS_SIZE_MIN));
+#endif
+
+        r = copy_bytes(input_fd, fd, copy_size, 0);
         if (r < 0)
                 return log_error_errno(r, "Cannot store coredump of %s (%s): %m",
                                 context->meta[META_ARGV_PID], context->meta[META_COMM]);
-        truncated = r == 1;
+        if (r == 1 && copy_size < max_size)
+                partial = true;
+        truncated = r == 1 && !partial;
 
         bool allow_user = grant_user_access(fd, context) > 0;
 
@@ -629,20 +665,32 @@ static int save_external_coredump(
                 if (fd_compressed < 0)
                         return log_error_errno(fd_compressed, "Failed to create temporary file for coredump %s: %m", fn_compressed);
 
-                r = compress_stream(fd, fd_compressed, max_size, &uncompressed_size);
+                r = compress_stream(fd, fd_compressed, max_size, UINT64_MAX, &uncompressed_size);
                 if (r < 0)
                         return log_error_errno(r, "Failed to compress %s: %m", coredump_tmpfile_name(tmp_compressed));
 
-                if (truncated && storage_on_tmpfs) {
+                if (partial || (truncated && storage_on_tmpfs)) {
                         uint64_t partial_uncompressed_size = 0;
 
-                        /* Uncompressed write was truncated and we are writing to tmpfs: delete
-                         * the uncompressed core, and compress the remaining part from STDIN. */
+                        /* Uncompressed write was truncated and we are writing to tmpfs, or the core is too
+                         * large to be processed anyway: delete the uncompressed core, and compress the
+                         * remaining part from STDIN. */
 
                         tmp = unlink_and_free(tmp);
                         fd = safe_close(fd);
 
-                        r = compress_stream(input_fd, fd_compressed, max_size, &partial_uncompressed_size);
+                        if (partial) {
+                                /* The size limits apply to the uncompressed core, hence only feed as much
+                                 * of the remaining input to the compressor as the limit leaves room for. */
+                                r = compress_stream(input_fd, fd_compressed, UINT64_MAX, max_size - copy_size,
+                                                    &partial_uncompressed_size);
+                                if (r >= 0 && partial_uncompressed_size >= max_size - copy_size) {
+                                        r = input_has_more(input_fd);
+                                        if (r >= 0)
+                                                truncated = r;
+                                }
+                        } else
+                                r = compress_stream(input_fd, fd_compressed, max_size, UINT64_MAX, &partial_uncompressed_size);
                         if (r < 0)
                                 return log_error_errno(r, "Failed to compress %s: %m", coredump_tmpfile_name(tmp_compressed));
                         uncompressed_size += partial_uncompressed_size;
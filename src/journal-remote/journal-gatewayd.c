@@ -21,6 +21,7 @@
 #include "fileio.h"
 #include "glob-util.h"
 #include "hostname-util.h"
+#include "journal-columnar.h"
 #include "log.h"
 #include "logs-show.h"
 #include "main-func.h"
@@ -59,6 +60,8 @@ typedef struct RequestMeta {
         FILE *tmp;
         uint64_t delta, size;
 
+        JournalColumnarWriter *columnar;
+
         int argument_parse_error;
 
         bool follow;
@@ -71,6 +74,7 @@ static const char* const mime_types[_OUTPUT_MODE_MAX] = {
         [OUTPUT_JSON_SSE] = "text/event-stream",
         [OUTPUT_JSON_SEQ] = "application/json-seq",
         [OUTPUT_EXPORT] = "application/vnd.fdo.journal",
+        [OUTPUT_COLUMNAR] = "application/vnd.fdo.journal-columnar",
 };
 
 static RequestMeta *request_meta(void **connection_cls) {
@@ -102,6 +106,7 @@ static void request_meta_free(
         sd_journal_close(m->journal);
 
         safe_fclose(m->tmp);
+        journal_columnar_writer_free(m->columnar);
 
         free(m->cursor);
         free(m);
@@ -141,6 +146,38 @@ static int request_meta_ensure_tmp(RequestMeta *m) {
         return 0;
 }
 
+static int request_meta_flush_columnar(RequestMeta *m, uint64_t *pos) {
+        off_t sz;
+        int r;
+
+        assert(m);
+        assert(pos);
+
+        /* Writes out the rows buffered so far as a (possibly incomplete) row group. Returns > 0 if there
+         * is new data to serve. */
+
+        if (!m->columnar || journal_columnar_writer_pending(m->columnar) == 0)
+                return 0;
+
+        *pos -= m->size;
+        m->delta += m->size;
+
+        r = request_meta_ensure_tmp(m);
+        if (r < 0)
+                return log_error_errno(r, "Failed to create temporary file: %m");
+
+        r = journal_columnar_writer_flush(m->columnar, m->tmp);
+        if (r < 0)
+                return log_error_errno(r, "Failed to write row group: %m");
+
+        sz = ftello(m->tmp);
+        if (sz == (off_t) -1)
+                return log_error_errno(errno, "Failed to retrieve file position: %m");
+
+        m->size = (uint64_t) sz;
+        return 1;
+}
+
 static ssize_t request_reader_entries(
                 void *cls,
                 uint64_t pos,
@@ -166,8 +203,15 @@ static ssize_t request_reader_entries(
                  * one */
 
                 if (m->n_entries_set &&
-                    m->n_entries <= 0)
+                    m->n_entries <= 0) {
+                        r = request_meta_flush_columnar(m, &pos);
+                        if (r < 0)
+                                return MHD_CONTENT_READER_END_WITH_ERROR;
+                        if (r > 0)
+                                break;
+
                         return MHD_CONTENT_READER_END_OF_STREAM;
+                }
 
                 if (m->n_skip < 0)
                         r = sd_journal_previous_skip(m->journal, (uint64_t) -m->n_skip + 1);
@@ -181,6 +225,13 @@ static ssize_t request_reader_entries(
                         return MHD_CONTENT_READER_END_WITH_ERROR;
                 } else if (r == 0) {
 
+                        /* Serve what we have buffered so far before waiting or finishing */
+                        r = request_meta_flush_columnar(m, &pos);
+                        if (r < 0)
+                                return MHD_CONTENT_READER_END_WITH_ERROR;
+                        if (r > 0)
+                                break;
+
                         if (m->follow) {
                                 r = sd_journal_wait(m->journal, (uint64_t) JOURNAL_WAIT_TIMEOUT);
                                 if (r < 0) {
@@ -223,11 +274,23 @@ static ssize_t request_reader_entries(
                         return MHD_CONTENT_READER_END_WITH_ERROR;
                 }
 
-                r = show_journal_entry(m->tmp, m->journal, m->mode, 0, OUTPUT_FULL_WIDTH,
-                                   NULL, NULL, NULL, &previous_ts, &previous_boot_id);
-                if (r < 0) {
-                        log_error_errno(r, "Failed to serialize item: %m");
-                        return MHD_CONTENT_READER_END_WITH_ERROR;
+                if (m->columnar) {
+                        /* Entries are collected into row groups, only full row groups are written out
+                         * here, the rest is flushed once we run out of entries. */
+                        r = journal_columnar_writer_add_entry(m->columnar, m->journal, m->tmp);
+                        if (r < 0)
+                                return MHD_CONTENT_READER_END_WITH_ERROR;
+                        if (r == 0) {
+                                m->size = 0;
+                                continue;
+                        }
+                } else {
+                        r = show_journal_entry(m->tmp, m->journal, m->mode, 0, OUTPUT_FULL_WIDTH,
+                                               NULL, NULL, NULL, &previous_ts, &previous_boot_id);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to serialize item: %m");
+                                return MHD_CONTENT_READER_END_WITH_ERROR;
+                        }
                 }
 
                 sz = ftello(m->tmp);
@@ -284,6 +347,8 @@ static int request_parse_accept(
                 m->mode = OUTPUT_JSON_SEQ;
         else if (streq(header, mime_types[OUTPUT_EXPORT]))
                 m->mode = OUTPUT_EXPORT;
+        else if (streq(header, mime_types[OUTPUT_COLUMNAR]))
+                m->mode = OUTPUT_COLUMNAR;
         else
                 m->mode = OUTPUT_SHORT;
 
@@ -492,6 +557,12 @@ static int request_handler_entries(
                 m->n_entries_set = true;
         }
 
+        if (m->mode == OUTPUT_COLUMNAR && !m->columnar) {
+                r = journal_columnar_writer_new(NULL, JOURNAL_COLUMNAR_ROWS_DEFAULT, DEFAULT_COMPRESSION, &m->columnar);
+                if (r < 0)
+                        return mhd_respondf(connection, r, MHD_HTTP_INTERNAL_SERVER_ERROR, "Failed to set up columnar output: %m");
+        }
+
         if (m->cursor)
                 r = sd_journal_seek_cursor(m->journal, m->cursor);
         else if (m->n_skip >= 0)
@@ -10,7 +10,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/inotify.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include "sd-bus.h"
@@ -26,7 +28,9 @@
 #include "chase-symlinks.h"
 #include "chattr-util.h"
 #include "constants.h"
+#include "cpu-set-util.h"
 #include "dissect-image.h"
+#include "exit-status.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "format-table.h"
@@ -37,6 +41,7 @@
 #include "hostname-util.h"
 #include "id128-print.h"
 #include "io-util.h"
+#include "journal-columnar.h"
 #include "journal-def.h"
 #include "journal-internal.h"
 #include "journal-util.h"
@@ -57,11 +62,14 @@
 #include "path-util.h"
 #include "pcre2-util.h"
 #include "pretty-print.h"
+#include "process-util.h"
 #include "qrcode-util.h"
 #include "random-util.h"
 #include "rlimit-util.h"
 #include "set.h"
 #include "sigbus.h"
+#include "signal-util.h"
+#include "sort-util.h"
 #include "static-destruct.h"
 #include "stdio-util.h"
 #include "string-table.h"
@@ -348,8 +356,9 @@ static int help(void) {
                "                               short-iso, short-iso-precise, short-full,\n"
                "                               short-monotonic, short-unix, verbose, export,\n"
                "                               json, json-pretty, json-sse, json-seq, cat,\n"
-               "                               with-unit)\n"
-               "     --output-fields=LIST    Select fields to print in verbose/export/json modes\n"
+               "                               with-unit, columnar)\n"
+               "     --output-fields=LIST    Select fields to print in verbose/export/json/\n"
+               "                               columnar modes\n"
                "  -n --lines[=INTEGER]       Number of journal entries to show\n"
                "  -r --reverse               Show the newest entries first\n"
                "     --show-cursor           Print the cursor after all the entries\n"
@@ -561,7 +570,7 @@ static int parse_argv(int argc, char *argv[]) {
                         if (arg_output < 0)
                                 return log_error_errno(arg_output, "Unknown output format '%s'.", optarg);
 
-                        if (IN_SET(arg_output, OUTPUT_EXPORT, OUTPUT_JSON, OUTPUT_JSON_PRETTY, OUTPUT_JSON_SSE, OUTPUT_JSON_SEQ, OUTPUT_CAT))
+                        if (IN_SET(arg_output, OUTPUT_EXPORT, OUTPUT_JSON, OUTPUT_JSON_PRETTY, OUTPUT_JSON_SSE, OUTPUT_JSON_SEQ, OUTPUT_CAT, OUTPUT_COLUMNAR))
                                 arg_quiet = true;
 
                         if (OUTPUT_MODE_IS_JSON(arg_output))
@@ -1181,215 +1190,181 @@ static void boot_id_free_all(BootId *l) {
         }
 }
 
-static int discover_next_boot(sd_journal *j,
-                sd_id128_t previous_boot_id,
-                bool advance_older,
-                BootId **ret) {
+static int boot_id_compare_func(BootId * const *a, BootId * const *b) {
+        return CMP((*a)->first, (*b)->first);
+}
 
-        _cleanup_free_ BootId *next_boot = NULL;
+static int boot_id_find_range(sd_journal *j, BootId *b) {
         char match[STRLEN("_BOOT_ID=") + SD_ID128_STRING_MAX] = "_BOOT_ID=";
-        sd_id128_t boot_id;
         int r;
 
         assert(j);
-        assert(ret);
-
-        /* We expect the journal to be on the last position of a boot
-         * (in relation to the direction we are going), so that the next
-         * invocation of sd_journal_next/previous will be from a different
-         * boot. We then collect any information we desire and then jump
-         * to the last location of the new boot by using a _BOOT_ID match
-         * coming from the other journal direction. */
+        assert(b);
 
-        /* Make sure we aren't restricted by any _BOOT_ID matches, so that
-         * we can actually advance to a *different* boot. */
         sd_journal_flush_matches(j);
 
-        do {
-                if (advance_older)
-                        r = sd_journal_previous(j);
-                else
-                        r = sd_journal_next(j);
-                if (r < 0)
-                        return r;
-                else if (r == 0)
-                        return 0; /* End of journal, yay. */
-
-                r = sd_journal_get_monotonic_usec(j, NULL, &boot_id);
-                if (r < 0)
-                        return r;
-
-                /* We iterate through this in a loop, until the boot ID differs from the previous one. Note that
-                 * normally, this will only require a single iteration, as we seeked to the last entry of the previous
-                 * boot entry already. However, it might happen that the per-journal-field entry arrays are less
-                 * complete than the main entry array, and hence might reference an entry that's not actually the last
-                 * one of the boot ID as last one. Let's hence use the per-field array is initial seek position to
-                 * speed things up, but let's not trust that it is complete, and hence, manually advance as
-                 * necessary. */
-
-        } while (sd_id128_equal(boot_id, previous_boot_id));
-
-        next_boot = new0(BootId, 1);
-        if (!next_boot)
-                return -ENOMEM;
-
-        next_boot->id = boot_id;
-
-        r = sd_journal_get_realtime_usec(j, &next_boot->first);
+        sd_id128_to_string(b->id, match + STRLEN("_BOOT_ID="));
+        r = sd_journal_add_match(j, match, sizeof(match) - 1);
         if (r < 0)
                 return r;
 
-        /* Now seek to the last occurrence of this boot ID. */
-        sd_id128_to_string(next_boot->id, match + STRLEN("_BOOT_ID="));
-        r = sd_journal_add_match(j, match, sizeof(match) - 1);
+        r = sd_journal_seek_head(j);
         if (r < 0)
                 return r;
-
-        if (advance_older)
-                r = sd_journal_seek_head(j);
-        else
-                r = sd_journal_seek_tail(j);
+        r = sd_journal_next(j);
         if (r < 0)
                 return r;
+        if (r == 0)
+                return -ENODATA;
 
-        if (advance_older)
-                r = sd_journal_next(j);
-        else
-                r = sd_journal_previous(j);
+        r = sd_journal_get_realtime_usec(j, &b->first);
         if (r < 0)
                 return r;
-        else if (r == 0)
-                return log_debug_errno(SYNTHETIC_ERRNO(ENODATA),
-                                       "Whoopsie! We found a boot ID but can't read its last entry."); /* This shouldn't happen. We just came from this very boot ID. */
 
-        r = sd_journal_get_realtime_usec(j, &next_boot->last);
+        r = sd_journal_seek_tail(j);
         if (r < 0)
                 return r;
+        r = sd_journal_previous(j);
+        if (r < 0)
+                return r;
+        if (r == 0)
+                return -ENODATA;
 
-        *ret = TAKE_PTR(next_boot);
-
-        return 0;
+        return sd_journal_get_realtime_usec(j, &b->last);
 }
 
-static int get_boots(
-                sd_journal *j,
-                BootId **boots,
-                sd_id128_t *boot_id,
-                int offset) {
-
-        bool skip_once;
-        int r, count = 0;
+static int collect_boots(sd_journal *j, BootId **ret) {
+        _cleanup_free_ BootId **array = NULL;
         BootId *head = NULL, *tail = NULL;
-        const bool advance_older = boot_id && offset <= 0;
-        sd_id128_t previous_boot_id;
+        const void *data;
+        size_t n = 0, length;
+        int r;
 
         assert(j);
 
-        /* Adjust for the asymmetry that offset 0 is
-         * the last (and current) boot, while 1 is considered the
-         * (chronological) first boot in the journal. */
-        skip_once = boot_id && sd_id128_is_null(*boot_id) && offset <= 0;
+        /* Instead of walking from boot to boot through the entries, enumerate the boot IDs from the field
+         * indexes of the journal files, and then only look at the first and last entry of each boot. This
+         * only touches a handful of objects per boot, regardless how many entries there are. */
 
-        /* Advance to the earliest/latest occurrence of our reference
-         * boot ID (taking our lookup direction into account), so that
-         * discover_next_boot() can do its job.
-         * If no reference is given, the journal head/tail will do,
-         * they're "virtual" boots after all. */
-        if (boot_id && !sd_id128_is_null(*boot_id)) {
-                char match[STRLEN("_BOOT_ID=") + SD_ID128_STRING_MAX] = "_BOOT_ID=";
+        r = sd_journal_query_unique(j, "_BOOT_ID");
+        if (r < 0)
+                return r;
 
-                sd_journal_flush_matches(j);
+        SD_JOURNAL_FOREACH_UNIQUE(j, data, length) {
+                char s[SD_ID128_STRING_MAX];
+                sd_id128_t id;
 
-                sd_id128_to_string(*boot_id, match + STRLEN("_BOOT_ID="));
-                r = sd_journal_add_match(j, match, sizeof(match) - 1);
-                if (r < 0)
-                        return r;
+                if (length != STRLEN("_BOOT_ID=") + SD_ID128_STRING_MAX - 1)
+                        continue;
 
-                if (advance_older)
-                        r = sd_journal_seek_head(j); /* seek to oldest */
-                else
-                        r = sd_journal_seek_tail(j); /* seek to newest */
-                if (r < 0)
-                        return r;
+                memcpy(s, (const char*) data + STRLEN("_BOOT_ID="), SD_ID128_STRING_MAX - 1);
+                s[SD_ID128_STRING_MAX - 1] = 0;
 
-                if (advance_older)
-                        r = sd_journal_next(j);     /* read the oldest entry */
-                else
-                        r = sd_journal_previous(j); /* read the most recently added entry */
-                if (r < 0)
-                        return r;
-                else if (r == 0)
-                        goto finish;
-                else if (offset == 0) {
-                        count = 1;
-                        goto finish;
+                r = sd_id128_from_string(s, &id);
+                if (r < 0) {
+                        log_debug_errno(r, "Ignoring invalid boot ID '%s' in journal: %m", s);
+                        continue;
                 }
 
-                /* At this point the read pointer is positioned at the oldest/newest occurrence of the reference boot
-                 * ID. After flushing the matches, one more invocation of _previous()/_next() will hence place us at
-                 * the following entry, which must then have an older/newer boot ID */
-        } else {
+                if (!GREEDY_REALLOC(array, n + 1)) {
+                        r = -ENOMEM;
+                        goto fail;
+                }
 
-                if (advance_older)
-                        r = sd_journal_seek_tail(j); /* seek to newest */
-                else
-                        r = sd_journal_seek_head(j); /* seek to oldest */
+                array[n] = new(BootId, 1);
+                if (!array[n]) {
+                        r = -ENOMEM;
+                        goto fail;
+                }
+
+                *array[n++] = (BootId) {
+                        .id = id,
+                };
+        }
+
+        /* The data returned by the enumeration above points into the mapped journal files, hence only seek
+         * around once we have copied out all boot IDs. */
+        for (size_t i = 0; i < n;) {
+                r = boot_id_find_range(j, array[i]);
+                if (r == -ENODATA) {
+                        /* Only referenced from a field index, but not from any entry we can read. */
+                        free(array[i]);
+                        array[i] = array[--n];
+                        continue;
+                }
                 if (r < 0)
-                        return r;
+                        goto fail;
 
-                /* No sd_journal_next()/_previous() here.
-                 *
-                 * At this point the read pointer is positioned after the newest/before the oldest entry in the whole
-                 * journal. The next invocation of _previous()/_next() will hence position us at the newest/oldest
-                 * entry we have. */
+                i++;
         }
 
-        previous_boot_id = SD_ID128_NULL;
-        for (;;) {
-                _cleanup_free_ BootId *current = NULL;
+        sd_journal_flush_matches(j);
 
-                r = discover_next_boot(j, previous_boot_id, advance_older, &current);
-                if (r < 0) {
-                        boot_id_free_all(head);
-                        return r;
-                }
+        typesafe_qsort(array, n, boot_id_compare_func);
 
-                if (!current)
-                        break;
+        for (size_t i = 0; i < n; i++) {
+                LIST_INSERT_AFTER(boot_list, head, tail, array[i]);
+                tail = array[i];
+        }
 
-                previous_boot_id = current->id;
+        if (ret)
+                *ret = head;
+        else
+                boot_id_free_all(head);
+
+        return (int) MIN(n, (size_t) INT_MAX);
+
+fail:
+        for (size_t i = 0; i < n; i++)
+                free(array[i]);
+
+        sd_journal_flush_matches(j);
+        return r;
+}
 
-                if (boot_id) {
-                        if (!skip_once)
-                                offset += advance_older ? 1 : -1;
-                        skip_once = false;
+static int get_boots(
+                sd_journal *j,
+                sd_id128_t *boot_id,
+                int offset) {
 
-                        if (offset == 0) {
-                                count = 1;
-                                *boot_id = current->id;
+        BootId *head = NULL, *found = NULL;
+        int r;
+
+        assert(j);
+        assert(boot_id);
+
+        /* Resolve the boot through the same list --list-boots shows, so that the indexes shown there always
+         * select the same boot. */
+
+        r = collect_boots(j, &head);
+        if (r <= 0)
+                return r;
+
+        if (sd_id128_is_null(*boot_id)) {
+                /* Adjust for the asymmetry that offset 0 is the last (and current) boot, while 1 is
+                 * considered the (chronological) first boot in the journal. */
+                if (offset > 0) {
+                        found = head;
+                        offset--;
+                } else
+                        LIST_FIND_TAIL(boot_list, head, found);
+        } else
+                LIST_FOREACH(boot_list, i, head)
+                        if (sd_id128_equal(i->id, *boot_id)) {
+                                found = i;
                                 break;
                         }
-                } else {
-                        LIST_FOREACH(boot_list, id, head) {
-                                if (sd_id128_equal(id->id, current->id)) {
-                                        /* boot id already stored, something wrong with the journal files */
-                                        /* exiting as otherwise this problem would cause forever loop */
-                                        goto finish;
-                                }
-                        }
-                        LIST_INSERT_AFTER(boot_list, head, tail, current);
-                        tail = TAKE_PTR(current);
-                        count++;
-                }
-        }
 
-finish:
-        if (boots)
-                *boots = head;
+        for (; found && offset > 0; offset--)
+                found = found->boot_list_next;
+        for (; found && offset < 0; offset++)
+                found = found->boot_list_prev;
 
-        sd_journal_flush_matches(j);
+        if (found)
+                *boot_id = found->id;
 
-        return count;
+        boot_id_free_all(head);
+        return !!found;
 }
 
 static int list_boots(sd_journal *j) {
@@ -1399,7 +1374,7 @@ static int list_boots(sd_journal *j) {
 
         assert(j);
 
-        count = get_boots(j, &all_ids, NULL, 0);
+        count = collect_boots(j, &all_ids);
         if (count < 0)
                 return log_error_errno(count, "Failed to determine boots: %m");
         if (count == 0)
@@ -1459,7 +1434,7 @@ static int add_boot(sd_journal *j) {
                 return add_match_this_boot(j, arg_machine);
 
         boot_id = arg_boot_id;
-        r = get_boots(j, NULL, &boot_id, arg_boot_offset);
+        r = get_boots(j, &boot_id, arg_boot_offset);
         assert(r <= 1);
         if (r <= 0) {
                 const char *reason = (r == 0) ? "No such boot ID in journal" : STRERROR(r);
@@ -1961,51 +1936,224 @@ static int setup_keys(void) {
 #endif
 }
 
+static int verify_one(JournalFile *f, bool verbose, bool show_progress, uint64_t *shared_progress) {
+        usec_t first = 0, validated = 0, last = 0;
+        int r;
+
+        assert(f);
+
+#if HAVE_GCRYPT
+        if (!arg_verify_key && JOURNAL_HEADER_SEALED(f->header))
+                log_notice("Journal file %s has sealing enabled but verification key has not been passed using --verify-key=.", f->path);
+#endif
+
+        r = journal_file_verify_full(f, arg_verify_key, &first, &validated, &last, show_progress, shared_progress);
+        if (r == -EINVAL)
+                /* If the key was invalid give up right-away. */
+                return r;
+        if (r < 0)
+                return log_warning_errno(r, "FAIL: %s (%m)", f->path);
+
+        /* Another process draws the progress of all files, don't log into the middle of it */
+        if (shared_progress && verbose)
+                journal_verify_flush_progress();
+
+        char a[FORMAT_TIMESTAMP_MAX], b[FORMAT_TIMESTAMP_MAX];
+        log_full(verbose ? LOG_INFO : LOG_DEBUG, "PASS: %s", f->path);
+
+        if (arg_verify_key && JOURNAL_HEADER_SEALED(f->header)) {
+                if (validated > 0) {
+                        log_full(verbose ? LOG_INFO : LOG_DEBUG,
+                                 "=> Validated from %s to %s, final %s entries not sealed.",
+                                 format_timestamp_maybe_utc(a, sizeof(a), first),
+                                 format_timestamp_maybe_utc(b, sizeof(b), validated),
+                                 FORMAT_TIMESPAN(last > validated ? last - validated : 0, 0));
+                } else if (last > 0)
+                        log_full(verbose ? LOG_INFO : LOG_DEBUG,
+                                 "=> No sealing yet, %s of entries not sealed.",
+                                 FORMAT_TIMESPAN(last - first, 0));
+                else
+                        log_full(verbose ? LOG_INFO : LOG_DEBUG,
+                                 "=> No sealing yet, no entries in file.");
+        }
+
+        return 0;
+}
+
+typedef struct VerifyContext {
+        Hashmap *workers;       /* PID → index of the file */
+        JournalFile **files;
+        size_t n_files;
+        uint64_t *progress;     /* Shared with the workers, one counter per file */
+        bool show_progress;
+        usec_t start_usec;
+        usec_t last_usec;
+} VerifyContext;
+
+static void verify_context_done(VerifyContext *c) {
+        void *i, *p;
+
+        assert(c);
+
+        /* Only reached with workers left on failure, don't leave them running behind us */
+        HASHMAP_FOREACH_KEY(i, p, c->workers)
+                sigkill_wait(PTR_TO_PID(p));
+
+        c->workers = hashmap_free(c->workers);
+        c->files = mfree(c->files);
+
+        if (c->progress)
+                (void) munmap(c->progress, c->n_files * sizeof(uint64_t));
+        c->progress = NULL;
+}
+
+static void verify_draw_progress(VerifyContext *c) {
+        uint64_t total = 0, done = 0;
+
+        assert(c);
+
+        /* Each worker reports how far it got with its file, weigh that by the size of the file */
+        for (size_t i = 0; i < c->n_files; i++) {
+                uint64_t size = c->files[i]->last_stat.st_size;
+
+                total += size;
+                done += size * __atomic_load_n(c->progress + i, __ATOMIC_RELAXED) / 0xFFFF;
+        }
+
+        journal_verify_draw_progress(total > 0 ? MIN(done, total) * 0xFFFF / total : 0xFFFF, done,
+                                     c->start_usec, &c->last_usec);
+}
+
+static int verify_wait_one(VerifyContext *c, int *result) {
+        siginfo_t si;
+        JournalFile *f;
+        void *p;
+
+        assert(c);
+        assert(result);
+
+        /* We are the only ones forking off children while verifying, hence simply reap whichever of our
+         * workers finishes first, and fold its result into 'result'. While waiting, draw the progress. */
+        for (;;) {
+                si = (siginfo_t) {};
+
+                if (waitid(P_ALL, 0, &si, WEXITED|(c->show_progress ? WNOHANG : 0)) < 0)
+                        return log_error_errno(errno, "Failed to wait for verification worker: %m");
+                if (si.si_pid != 0)
+                        break;
+
+                verify_draw_progress(c);
+                (void) usleep(40 * USEC_PER_MSEC);
+        }
+
+        p = hashmap_remove(c->workers, PID_TO_PTR(si.si_pid));
+        if (!p)
+                return 0;
+
+        f = c->files[PTR_TO_SIZE(p) - 1];
+        c->progress[PTR_TO_SIZE(p) - 1] = 0xFFFF;
+
+        if (si.si_code == CLD_EXITED && si.si_status == EXIT_SUCCESS)
+                return 0;
+
+        if (si.si_code == CLD_EXITED && si.si_status == EXIT_INVALIDARGUMENT)
+                *result = -EINVAL;
+        else {
+                if (si.si_code != CLD_EXITED) {
+                        if (c->show_progress)
+                                journal_verify_flush_progress();
+                        log_warning("FAIL: %s (verification worker terminated by signal %s)",
+                                    f->path, signal_to_string(si.si_status));
+                }
+                if (*result != -EINVAL)
+                        *result = -EBADMSG;
+        }
+
+        return 0;
+}
+
 static int verify(sd_journal *j, bool verbose) {
-        int r = 0;
+        _cleanup_(verify_context_done) VerifyContext c = {};
+        unsigned n_workers;
         JournalFile *f;
+        int r = 0, k;
 
         assert(j);
 
         log_show_color(true);
 
-        ORDERED_HASHMAP_FOREACH(f, j->files) {
-                int k;
-                usec_t first = 0, validated = 0, last = 0;
+        /* Verifying a file is CPU bound and entirely independent of the other files, hence check them in
+         * parallel, one worker process per file and CPU. The workers report their progress through shared
+         * memory, and we draw the progress of all files combined. */
+        k = cpus_in_affinity_mask();
+        n_workers = k > 0 ? MIN((unsigned) k, ordered_hashmap_size(j->files)) : 1;
+
+        if (n_workers <= 1) {
+                ORDERED_HASHMAP_FOREACH(f, j->files) {
+                        k = verify_one(f, verbose, verbose, /* shared_progress= */ NULL);
+                        if (k == -EINVAL)
+                                return k;
+                        if (k < 0)
+                                r = k;
+                }
 
-#if HAVE_GCRYPT
-                if (!arg_verify_key && JOURNAL_HEADER_SEALED(f->header))
-                        log_notice("Journal file %s has sealing enabled but verification key has not been passed using --verify-key=.", f->path);
-#endif
+                return r;
+        }
+
+        c.workers = hashmap_new(NULL);
+        c.files = new(JournalFile*, ordered_hashmap_size(j->files));
+        if (!c.workers || !c.files)
+                return log_oom();
+
+        ORDERED_HASHMAP_FOREACH(f, j->files)
+                c.files[c.n_files++] = f;
+
+        c.progress = mmap(NULL, c.n_files * sizeof(uint64_t), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+        if (c.progress == MAP_FAILED) {
+                c.progress = NULL;
+                return log_error_errno(errno, "Failed to allocate shared memory for progress: %m");
+        }
+
+        c.show_progress = verbose && on_tty();
+        c.start_usec = now(CLOCK_MONOTONIC);
+
+        for (size_t i = 0; i < c.n_files; i++) {
+                pid_t pid;
+
+                while (hashmap_size(c.workers) >= n_workers) {
+                        k = verify_wait_one(&c, &r);
+                        if (k < 0)
+                                return k;
+                }
+
+                if (r == -EINVAL)
+                        break;
 
-                k = journal_file_verify(f, arg_verify_key, &first, &validated, &last, verbose);
-                if (k == -EINVAL)
-                        /* If the key was invalid give up right-away. */
+                k = safe_fork("(journal-verify)", FORK_RESET_SIGNALS|FORK_DEATHSIG|FORK_LOG, &pid);
+                if (k < 0)
                         return k;
-                else if (k < 0)
-                        r = log_warning_errno(k, "FAIL: %s (%m)", f->path);
-                else {
-                        char a[FORMAT_TIMESTAMP_MAX], b[FORMAT_TIMESTAMP_MAX];
-                        log_full(verbose ? LOG_INFO : LOG_DEBUG, "PASS: %s", f->path);
-
-                        if (arg_verify_key && JOURNAL_HEADER_SEALED(f->header)) {
-                                if (validated > 0) {
-                                        log_full(verbose ? LOG_INFO : LOG_DEBUG,
-                                                 "=> Validated from %s to %s, final %s entries not sealed.",
-                                                 format_timestamp_maybe_utc(a, sizeof(a), first),
-                                                 format_timestamp_maybe_utc(b, sizeof(b), validated),
-                                                 FORMAT_TIMESPAN(last > validated ? last - validated : 0, 0));
-                                } else if (last > 0)
-                                        log_full(verbose ? LOG_INFO : LOG_DEBUG,
-                                                 "=> No sealing yet, %s of entries not sealed.",
-                                                 FORMAT_TIMESPAN(last - first, 0));
-                                else
-                                        log_full(verbose ? LOG_INFO : LOG_DEBUG,
-                                                 "=> No sealing yet, no entries in file.");
-                        }
+                if (k == 0) {
+                        /* Child */
+                        k = verify_one(c.files[i], verbose, /* show_progress= */ false, c.progress + i);
+                        _exit(k == -EINVAL ? EXIT_INVALIDARGUMENT : k < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+                }
+
+                k = hashmap_put(c.workers, PID_TO_PTR(pid), SIZE_TO_PTR(i + 1));
+                if (k < 0) {
+                        sigkill_wait(pid);
+                        return log_oom();
                 }
         }
 
+        while (!hashmap_isempty(c.workers)) {
+                k = verify_wait_one(&c, &r);
+                if (k < 0)
+                        return k;
+        }
+
+        if (c.show_progress)
+                journal_verify_flush_progress();
+
         return r;
 }
 
@@ -2100,6 +2248,7 @@ int main(int argc, char *argv[]) {
         bool previous_boot_id_valid = false, first_line = true, ellipsized = false, need_seek = false;
         bool use_cursor = false, after_cursor = false;
         _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        _cleanup_(journal_columnar_writer_freep) JournalColumnarWriter *columnar = NULL;
         sd_id128_t previous_boot_id = SD_ID128_NULL, previous_boot_id_output = SD_ID128_NULL;
         dual_timestamp previous_ts_output = DUAL_TIMESTAMP_NULL;
         int n_shown = 0, r, poll_fd = -EBADF;
@@ -2558,6 +2707,14 @@ int main(int argc, char *argv[]) {
         if (r == 0)
                 need_seek = true;
 
+        if (arg_output == OUTPUT_COLUMNAR) {
+                r = journal_columnar_writer_new(arg_output_fields, JOURNAL_COLUMNAR_ROWS_DEFAULT, DEFAULT_COMPRESSION, &columnar);
+                if (r < 0) {
+                        log_error_errno(r, "Failed to set up columnar output: %m");
+                        goto finish;
+                }
+        }
+
         if (!arg_follow)
                 pager_open(arg_pager_flags);
 
@@ -2674,9 +2831,13 @@ int main(int argc, char *argv[]) {
                                 arg_utc * OUTPUT_UTC |
                                 arg_no_hostname * OUTPUT_NO_HOSTNAME;
 
-                        r = show_journal_entry(stdout, j, arg_output, 0, flags,
-                                               arg_output_fields, highlight, &ellipsized,
-                                               &previous_ts_output, &previous_boot_id_output);
+                        if (columnar)
+                                /* Entries are buffered and written out in row groups */
+                                r = journal_columnar_writer_add_entry(columnar, j, stdout);
+                        else
+                                r = show_journal_entry(stdout, j, arg_output, 0, flags,
+                                                       arg_output_fields, highlight, &ellipsized,
+                                                       &previous_ts_output, &previous_boot_id_output);
                         need_seek = true;
                         if (r == -EADDRNOTAVAIL)
                                 break;
@@ -2700,6 +2861,16 @@ int main(int argc, char *argv[]) {
                         }
                 }
 
+                if (columnar) {
+                        /* Write out the incomplete row group, so that followers get to see new entries
+                         * without waiting for the row group to fill up. */
+                        r = journal_columnar_writer_flush(columnar, stdout);
+                        if (r < 0) {
+                                log_error_errno(r, "Failed to write row group: %m");
+                                goto finish;
+                        }
+                }
+
                 if (!arg_follow) {
                         if (n_shown == 0 && !arg_quiet)
                                 printf("-- No entries --\n");
@@ -0,0 +1,273 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "sd-journal.h"
+
+#include "alloc-util.h"
+#include "chattr-util.h"
+#include "fd-util.h"
+#include "fileio.h"
+#include "io-util.h"
+#include "journal-columnar.h"
+#include "log.h"
+#include "managed-journal-file.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+#include "unaligned.h"
+
+#define N_ENTRIES 100
+#define N_ROWS 16
+
+static void append_entries(const char *path) {
+        _cleanup_(mmap_cache_unrefp) MMapCache *m = NULL;
+        dual_timestamp previous_ts = DUAL_TIMESTAMP_NULL;
+        ManagedJournalFile *f;
+
+        assert_se(m = mmap_cache_new());
+        assert_se(managed_journal_file_open(-1, path, O_RDWR|O_CREAT, JOURNAL_COMPRESS, 0644, UINT64_MAX, NULL, m, NULL, NULL, &f) == 0);
+
+        for (unsigned i = 0; i < N_ENTRIES; i++) {
+                _cleanup_free_ char *p = NULL, *q = NULL;
+                struct iovec iovec[3];
+                size_t n = 0;
+                dual_timestamp ts;
+
+                dual_timestamp_get(&ts);
+                if (ts.monotonic <= previous_ts.monotonic)
+                        ts.monotonic = previous_ts.monotonic + 1;
+                if (ts.realtime <= previous_ts.realtime)
+                        ts.realtime = previous_ts.realtime + 1;
+                previous_ts = ts;
+
+                assert_se(asprintf(&p, "NUMBER=%u", i) >= 0);
+                iovec[n++] = IOVEC_MAKE_STRING(p);
+
+                assert_se(asprintf(&q, "MAGIC=%s", i % 5 == 0 ? "quux" : "waldo") >= 0);
+                iovec[n++] = IOVEC_MAKE_STRING(q);
+
+                /* Leave the field unset in some entries */
+                if (i % 2 == 0)
+                        iovec[n++] = IOVEC_MAKE_STRING("EVEN=yes");
+
+                assert_se(journal_file_append_entry(f->file, &ts, NULL, iovec, n, NULL, NULL, NULL) == 0);
+        }
+
+        (void) managed_journal_file_close(f);
+}
+
+typedef struct Column {
+        char *name;
+        uint8_t type;
+        uint8_t compression;
+        uint8_t *payload;
+        size_t size;
+} Column;
+
+static size_t parse_row_group(const uint8_t *p, size_t left, Column *columns, size_t n_columns, uint32_t *ret_rows) {
+        const uint8_t *start = p;
+        uint32_t version, n;
+
+        assert_se(left >= 16);
+        assert_se(memcmp(p, JOURNAL_COLUMNAR_MAGIC, 4) == 0);
+        version = unaligned_read_le32(p + 4);
+        *ret_rows = unaligned_read_le32(p + 8);
+        n = unaligned_read_le32(p + 12);
+        assert_se(version == JOURNAL_COLUMNAR_VERSION);
+        assert_se(n == n_columns);
+        p += 16;
+
+        for (size_t i = 0; i < n; i++) {
+                uint64_t size, stored;
+                uint32_t l;
+
+                l = unaligned_read_le32(p);
+                p += 4;
+                columns[i].name = strndup((const char*) p, l);
+                assert_se(columns[i].name);
+                p += l;
+
+                columns[i].type = p[0];
+                columns[i].compression = p[1];
+                p += 4;
+
+                size = unaligned_read_le64(p);
+                stored = unaligned_read_le64(p + 8);
+                p += 16;
+
+                if (columns[i].compression == COMPRESSION_NONE) {
+                        assert_se(size == stored);
+                        columns[i].payload = memdup(p, stored);
+                        assert_se(columns[i].payload);
+                        columns[i].size = size;
+                } else {
+                        void *d = NULL;
+                        size_t dsize;
+
+                        assert_se(decompress_blob(columns[i].compression, p, stored, &d, &dsize, 0) >= 0);
+                        assert_se(dsize == size);
+                        columns[i].payload = d;
+                        columns[i].size = dsize;
+                }
+                p += stored;
+        }
+
+        assert_se((size_t) (p - start) <= left);
+        return p - start;
+}
+
+static const char* dictionary_lookup(const Column *c, uint32_t row, size_t n_rows, size_t *ret_size) {
+        const uint8_t *p = c->payload, *indexes;
+        uint32_t n_values, index;
+
+        assert_se(c->type == JOURNAL_COLUMN_DICTIONARY);
+
+        n_values = unaligned_read_le32(p);
+        p += 4;
+
+        indexes = c->payload + c->size - n_rows * 4;
+        index = unaligned_read_le32(indexes + row * 4);
+        assert_se(index <= n_values);
+        if (index == 0)
+                return NULL;
+
+        for (uint32_t i = 1; ; i++) {
+                uint32_t l = unaligned_read_le32(p);
+
+                if (i == index) {
+                        *ret_size = l;
+                        return (const char*) p + 4;
+                }
+                p += 4 + l;
+        }
+}
+
+static void test_columnar_one(Compression compression) {
+        _cleanup_(journal_columnar_writer_freep) JournalColumnarWriter *w = NULL;
+        _cleanup_(rm_rf_physical_and_freep) char *t = NULL;
+        _cleanup_(sd_journal_closep) sd_journal *j = NULL;
+        _cleanup_free_ char *buf = NULL, *path = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        const uint8_t *p;
+        size_t sz = 0, left;
+        unsigned number = 0, groups = 0;
+        uint64_t previous_realtime = 0;
+
+        log_info("/* %s(%s) */", __func__, strna(compression_to_string(compression)));
+
+        assert_se(mkdtemp_malloc("/var/tmp/journal-columnar-XXXXXX", &t) >= 0);
+        (void) chattr_path(t, FS_NOCOW_FL, FS_NOCOW_FL, NULL);
+        assert_se(path = path_join(t, "test.journal"));
+
+        append_entries(path);
+
+        assert_se(sd_journal_open_directory(&j, t, 0) >= 0);
+        assert_se(journal_columnar_writer_new(STRV_MAKE("NUMBER", "EVEN", "MAGIC", "NUMBER", "_BOOT_ID"), N_ROWS, compression, &w) >= 0);
+        assert_se(f = open_memstream_unlocked(&buf, &sz));
+
+        SD_JOURNAL_FOREACH(j)
+                assert_se(journal_columnar_writer_add_entry(w, j, f) >= 0);
+
+        assert_se(journal_columnar_writer_pending(w) == N_ENTRIES % N_ROWS);
+        assert_se(journal_columnar_writer_flush(w, f) == 1);
+        assert_se(journal_columnar_writer_flush(w, f) == 0);
+        assert_se(fflush_and_check(f) >= 0);
+
+        p = (const uint8_t*) buf;
+        left = sz;
+        while (left > 0) {
+                Column columns[6] = {};
+                uint32_t n_rows;
+                size_t l;
+
+                l = parse_row_group(p, left, columns, ELEMENTSOF(columns), &n_rows);
+                assert_se(n_rows == (groups < N_ENTRIES / N_ROWS ? N_ROWS : N_ENTRIES % N_ROWS));
+
+                assert_se(streq(columns[0].name, "__REALTIME_TIMESTAMP"));
+                assert_se(streq(columns[1].name, "__MONOTONIC_TIMESTAMP"));
+                assert_se(streq(columns[2].name, "_BOOT_ID"));
+                assert_se(streq(columns[3].name, "NUMBER"));
+                assert_se(streq(columns[4].name, "EVEN"));
+                assert_se(streq(columns[5].name, "MAGIC"));
+
+                assert_se(columns[0].type == JOURNAL_COLUMN_DELTA);
+                assert_se(columns[0].size == n_rows * 8);
+
+                /* MAGIC only has two distinct values, hence the dictionary must be small */
+                assert_se(unaligned_read_le32(columns[5].payload) <= 2);
+
+                for (uint32_t row = 0; row < n_rows; row++, number++) {
+                        _cleanup_free_ char *s = NULL;
+                        const char *v;
+                        uint64_t realtime;
+                        size_t vl;
+
+                        /* Each row group starts from zero again, so that it can be decoded on its own */
+                        realtime = unaligned_read_le64(columns[0].payload + row * 8) + (row > 0 ? previous_realtime : 0);
+                        assert_se(realtime > previous_realtime);
+                        previous_realtime = realtime;
+
+                        assert_se(v = dictionary_lookup(columns + 3, row, n_rows, &vl));
+                        assert_se(asprintf(&s, "%u", number) >= 0);
+                        assert_se(vl == strlen(s) && memcmp(v, s, vl) == 0);
+
+                        v = dictionary_lookup(columns + 4, row, n_rows, &vl);
+                        assert_se(number % 2 == 0 ? (v && vl == 3 && memcmp(v, "yes", 3) == 0) : !v);
+
+                        assert_se(v = dictionary_lookup(columns + 5, row, n_rows, &vl));
+                        if (number % 5 == 0)
+                                assert_se(vl == 4 && memcmp(v, "quux", 4) == 0);
+                        else
+                                assert_se(vl == 5 && memcmp(v, "waldo", 5) == 0);
+                }
+
+                for (size_t i = 0; i < ELEMENTSOF(columns); i++) {
+                        free(columns[i].name);
+                        free(columns[i].payload);
+                }
+
+                p += l;
+                left -= l;
+                groups++;
+        }
+
+        assert_se(number == N_ENTRIES);
+        assert_se(groups == DIV_ROUND_UP(N_ENTRIES, N_ROWS));
+}
+
+TEST(columnar) {
+        test_columnar_one(COMPRESSION_NONE);
+
+        for (Compression c = COMPRESSION_NONE + 1; c < _COMPRESSION_MAX; c++) {
+                char dummy = 'x';
+                size_t size;
+
+                /* Skip compression algorithms we have not been built with */
+                if (compress_blob_explicit(c, &dummy, 1, &dummy, 1, &size) == -EPROTONOSUPPORT)
+                        continue;
+
+                test_columnar_one(c);
+        }
+}
+
+TEST(columnar_invalid) {
+        JournalColumnarWriter *w = NULL;
+
+        assert_se(journal_columnar_writer_new(STRV_MAKE("MESSAGE", "FOO=BAR"), 0, COMPRESSION_NONE, &w) == -EINVAL);
+        assert_se(!w);
+}
+
+static int intro(void) {
+        /* managed_journal_file_open requires a valid machine id */
+        if (access("/etc/machine-id", F_OK) != 0)
+                return log_tests_skipped("/etc/machine-id not found");
+
+        return EXIT_SUCCESS;
+}
+
+DEFINE_TEST_MAIN_WITH_INTRO(LOG_INFO, intro);
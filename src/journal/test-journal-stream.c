@@ -172,6 +172,37 @@ static void run_test(void) {
         SD_JOURNAL_FOREACH_UNIQUE(j, data, l)
                 printf("%.*s\n", (int) l, (const char*) data);
 
+        /* Values show up in multiple files, but each must be returned exactly once */
+        for (unsigned pass = 0; pass < 2; pass++) {
+                _cleanup_free_ bool *seen = NULL;
+                unsigned n = 0;
+
+                assert_se(seen = new0(bool, N_ENTRIES));
+
+                sd_journal_restart_unique(j);
+                SD_JOURNAL_FOREACH_UNIQUE(j, data, l) {
+                        _cleanup_free_ char *k = NULL;
+                        unsigned u;
+
+                        assert_se(k = strndup(data, l));
+                        assert_se(safe_atou(k + 7, &u) >= 0);
+                        assert_se(u < N_ENTRIES);
+                        assert_se(!seen[u]);
+                        seen[u] = true;
+                        n++;
+                }
+
+                assert_se(n == N_ENTRIES);
+        }
+
+        assert_se(sd_journal_query_unique(j, "MAGIC") >= 0);
+        i = 0;
+        SD_JOURNAL_FOREACH_UNIQUE(j, data, l) {
+                assert_se(memcmp_nn(data, l, "MAGIC=quux", 10) == 0 || memcmp_nn(data, l, "MAGIC=waldo", 11) == 0);
+                i++;
+        }
+        assert_se(i == 2);
+
         assert_se(rm_rf(t, REMOVE_ROOT|REMOVE_PHYSICAL) >= 0);
 }
 
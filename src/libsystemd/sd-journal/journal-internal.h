@@ -95,6 +95,7 @@ struct sd_journal {
         char *unique_field;
         JournalFile *unique_file;
         uint64_t unique_offset;
+        Set *unique_values; /* Hashes of the values seen so far, to avoid probing all earlier files */
 
         /* Iterating through known fields */
         JournalFile *fields_file;
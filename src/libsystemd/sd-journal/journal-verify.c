@@ -9,6 +9,7 @@
 #include "compress.h"
 #include "fd-util.h"
 #include "fileio.h"
+#include "format-util.h"
 #include "fs-util.h"
 #include "journal-authenticate.h"
 #include "journal-def.h"
@@ -19,10 +20,15 @@
 #include "terminal-util.h"
 #include "tmpfile-util.h"
 
-static void draw_progress(uint64_t p, usec_t *last_usec) {
+/* Room for " 100%" and the throughput after the bar */
+#define PROGRESS_SUFFIX_MAX 16
+
+void journal_verify_draw_progress(uint64_t p, uint64_t bytes, usec_t start_usec, usec_t *last_usec) {
         unsigned n, i, j, k;
         usec_t z, x;
 
+        assert(last_usec);
+
         if (!on_tty())
                 return;
 
@@ -54,6 +60,9 @@ static void draw_progress(uint64_t p, usec_t *last_usec) {
 
         printf(" %3"PRIu64"%%", 100U * p / 65535U);
 
+        if (z > start_usec)
+                printf(" %s/s", FORMAT_BYTES(bytes * USEC_PER_SEC / (z - start_usec)));
+
         fputs("\r", stdout);
         if (colors_enabled())
                 fputs("\x1B[?25h", stdout);
@@ -72,7 +81,7 @@ static uint64_t scale_progress(uint64_t scale, uint64_t p, uint64_t m) {
         return scale * p / m;
 }
 
-static void flush_progress(void) {
+void journal_verify_flush_progress(void) {
         unsigned n, i;
 
         if (!on_tty())
@@ -82,30 +91,52 @@ static void flush_progress(void) {
 
         putchar('\r');
 
-        for (i = 0; i < n + 5; i++)
+        for (i = 0; i < n + PROGRESS_SUFFIX_MAX; i++)
                 putchar(' ');
 
         putchar('\r');
         fflush(stdout);
 }
 
+typedef struct VerifyProgress {
+        bool show;
+        uint64_t *shared;
+        uint64_t size;
+        usec_t start_usec;
+        usec_t last_usec;
+} VerifyProgress;
+
+static void update_progress(VerifyProgress *progress, uint64_t p) {
+        assert(progress);
+
+        /* The progress is drawn by whoever watches the shared counter, e.g. the parent of several
+         * verification workers. The throughput is measured in bytes of the file, assuming that each of the
+         * passes over the file takes about the same time. */
+        if (progress->shared)
+                __atomic_store_n(progress->shared, p, __ATOMIC_RELAXED);
+
+        if (progress->show)
+                journal_verify_draw_progress(p, scale_progress(progress->size, p, 0xFFFF),
+                                             progress->start_usec, &progress->last_usec);
+}
+
 #define debug(_offset, _fmt, ...) do {                                  \
-                flush_progress();                                       \
+                journal_verify_flush_progress();                        \
                 log_debug(OFSfmt": " _fmt, _offset, ##__VA_ARGS__);     \
         } while (0)
 
 #define warning(_offset, _fmt, ...) do {                                \
-                flush_progress();                                       \
+                journal_verify_flush_progress();                        \
                 log_warning(OFSfmt": " _fmt, _offset, ##__VA_ARGS__);   \
         } while (0)
 
 #define error(_offset, _fmt, ...) do {                                  \
-                flush_progress();                                       \
+                journal_verify_flush_progress();                        \
                 log_error(OFSfmt": " _fmt, (uint64_t)_offset, ##__VA_ARGS__); \
         } while (0)
 
 #define error_errno(_offset, error, _fmt, ...) do {               \
-                flush_progress();                                       \
+                journal_verify_flush_progress();                        \
                 log_error_errno(error, OFSfmt": " _fmt, (uint64_t)_offset, ##__VA_ARGS__); \
         } while (0)
 
@@ -529,8 +560,7 @@ static int verify_data_hash_table(
                 MMapFileDescriptor *cache_data_fd, uint64_t n_data,
                 MMapFileDescriptor *cache_entry_fd, uint64_t n_entries,
                 MMapFileDescriptor *cache_entry_array_fd, uint64_t n_entry_arrays,
-                usec_t *last_usec,
-                bool show_progress) {
+                VerifyProgress *progress) {
 
         uint64_t i, n;
         int r;
@@ -539,7 +569,7 @@ static int verify_data_hash_table(
         assert(cache_data_fd);
         assert(cache_entry_fd);
         assert(cache_entry_array_fd);
-        assert(last_usec);
+        assert(progress);
 
         n = le64toh(f->header->data_hash_table_size) / sizeof(HashItem);
         if (n <= 0)
@@ -552,8 +582,7 @@ static int verify_data_hash_table(
         for (i = 0; i < n; i++) {
                 uint64_t last = 0, p;
 
-                if (show_progress)
-                        draw_progress(0xC000 + scale_progress(0x3FFF, i, n), last_usec);
+                update_progress(progress, 0xC000 + scale_progress(0x3FFF, i, n));
 
                 p = le64toh(f->data_hash_table[i].head_hash_offset);
                 while (p != 0) {
@@ -695,8 +724,7 @@ static int verify_entry_array(
                 MMapFileDescriptor *cache_data_fd, uint64_t n_data,
                 MMapFileDescriptor *cache_entry_fd, uint64_t n_entries,
                 MMapFileDescriptor *cache_entry_array_fd, uint64_t n_entry_arrays,
-                usec_t *last_usec,
-                bool show_progress) {
+                VerifyProgress *progress) {
 
         uint64_t i = 0, a, n, last = 0;
         int r;
@@ -705,7 +733,7 @@ static int verify_entry_array(
         assert(cache_data_fd);
         assert(cache_entry_fd);
         assert(cache_entry_array_fd);
-        assert(last_usec);
+        assert(progress);
 
         n = le64toh(f->header->n_entries);
         a = le64toh(f->header->entry_array_offset);
@@ -713,8 +741,7 @@ static int verify_entry_array(
                 uint64_t next, m, j;
                 Object *o;
 
-                if (show_progress)
-                        draw_progress(0x8000 + scale_progress(0x3FFF, i, n), last_usec);
+                update_progress(progress, 0x8000 + scale_progress(0x3FFF, i, n));
 
                 if (a == 0) {
                         error(a, "Array chain too short at %"PRIu64" of %"PRIu64, i, n);
@@ -809,11 +836,12 @@ static int verify_hash_table(
         return 0;
 }
 
-int journal_file_verify(
+int journal_file_verify_full(
                 JournalFile *f,
                 const char *key,
                 usec_t *first_contained, usec_t *last_validated, usec_t *last_contained,
-                bool show_progress) {
+                bool show_progress,
+                uint64_t *shared_progress) {
         int r;
         Object *o;
         uint64_t p = 0, last_epoch = 0, last_tag_realtime = 0, last_sealed_realtime = 0;
@@ -822,7 +850,12 @@ int journal_file_verify(
         sd_id128_t entry_boot_id = {};  /* Unnecessary initialization to appease gcc */
         bool entry_seqnum_set = false, entry_monotonic_set = false, entry_realtime_set = false, found_main_entry_array = false;
         uint64_t n_objects = 0, n_entries = 0, n_data = 0, n_fields = 0, n_data_hash_tables = 0, n_field_hash_tables = 0, n_entry_arrays = 0, n_tags = 0;
-        usec_t last_usec = 0;
+        VerifyProgress progress = {
+                .show = show_progress,
+                .shared = shared_progress,
+                .size = f->last_stat.st_size,
+                .start_usec = now(CLOCK_MONOTONIC),
+        };
         _cleanup_close_ int data_fd = -EBADF, entry_fd = -EBADF, entry_array_fd = -EBADF;
         _cleanup_fclose_ FILE *data_fp = NULL, *entry_fp = NULL, *entry_array_fp = NULL;
         MMapFileDescriptor *cache_data_fd = NULL, *cache_entry_fd = NULL, *cache_entry_array_fd = NULL;
@@ -933,8 +966,7 @@ int journal_file_verify(
                 if (le64toh(f->header->tail_object_offset) == 0)
                         break;
 
-                if (show_progress)
-                        draw_progress(scale_progress(0x7FFF, p, le64toh(f->header->tail_object_offset)), &last_usec);
+                update_progress(&progress, scale_progress(0x7FFF, p, le64toh(f->header->tail_object_offset)));
 
                 r = journal_file_move_to_object(f, OBJECT_UNUSED, p, &o);
                 if (r < 0) {
@@ -1343,8 +1375,7 @@ int journal_file_verify(
                                cache_data_fd, n_data,
                                cache_entry_fd, n_entries,
                                cache_entry_array_fd, n_entry_arrays,
-                               &last_usec,
-                               show_progress);
+                               &progress);
         if (r < 0)
                 goto fail;
 
@@ -1352,13 +1383,12 @@ int journal_file_verify(
                                    cache_data_fd, n_data,
                                    cache_entry_fd, n_entries,
                                    cache_entry_array_fd, n_entry_arrays,
-                                   &last_usec,
-                                   show_progress);
+                                   &progress);
         if (r < 0)
                 goto fail;
 
         if (show_progress)
-                flush_progress();
+                journal_verify_flush_progress();
 
         mmap_cache_fd_free(cache_data_fd);
         mmap_cache_fd_free(cache_entry_fd);
@@ -1374,8 +1404,8 @@ int journal_file_verify(
         return 0;
 
 fail:
-        if (show_progress)
-                flush_progress();
+        if (show_progress || shared_progress)
+                journal_verify_flush_progress();
 
         log_error("File corruption detected at %s:"OFSfmt" (of %llu bytes, %"PRIu64"%%).",
                   f->path,
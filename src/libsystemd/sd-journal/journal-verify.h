@@ -3,4 +3,12 @@
 
 #include "journal-file.h"
 
-int journal_file_verify(JournalFile *f, const char *key, usec_t *first_contained, usec_t *last_validated, usec_t *last_contained, bool show_progress);
+/* If shared_progress is non-NULL, the progress is stored there too, in 1/65535 units */
+int journal_file_verify_full(JournalFile *f, const char *key, usec_t *first_contained, usec_t *last_validated, usec_t *last_contained, bool show_progress, uint64_t *shared_progress);
+static inline int journal_file_verify(JournalFile *f, const char *key, usec_t *first_contained, usec_t *last_validated, usec_t *last_contained, bool show_progress) {
+        return journal_file_verify_full(f, key, first_contained, last_validated, last_contained, show_progress, NULL);
+}
+
+/* Draws a progress bar for p in 1/65535 units, and the throughput for 'bytes' verified since start_usec */
+void journal_verify_draw_progress(uint64_t p, uint64_t bytes, usec_t start_usec, usec_t *last_usec);
+void journal_verify_flush_progress(void);
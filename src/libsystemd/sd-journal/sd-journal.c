@@ -36,6 +36,7 @@
 #include "path-util.h"
 #include "process-util.h"
 #include "replace-var.h"
+#include "siphash24.h"
 #include "stat-util.h"
 #include "stdio-util.h"
 #include "string-util.h"
@@ -1393,6 +1394,24 @@ static int add_file_by_name(
         return add_any_file(j, -1, path);
 }
 
+static bool has_file_by_name(
+                sd_journal *j,
+                const char *prefix,
+                const char *filename) {
+
+        _cleanup_free_ char *path = NULL;
+
+        assert(j);
+        assert(prefix);
+        assert(filename);
+
+        path = path_join(prefix, filename);
+        if (!path)
+                return false;
+
+        return ordered_hashmap_contains(j->files, path);
+}
+
 static int remove_file_by_name(
                 sd_journal *j,
                 const char *prefix,
@@ -2168,6 +2187,7 @@ _public_ void sd_journal_close(sd_journal *j) {
         free(j->prefix);
         free(j->namespace);
         free(j->unique_field);
+        set_free(j->unique_values);
         free(j->fields_buffer);
         free(j);
 }
@@ -2531,6 +2551,14 @@ static void process_inotify_event(sd_journal *j, const struct inotify_event *e)
 
                         /* Event for a journal file */
 
+                        if ((e->mask & (IN_CREATE|IN_MOVED_TO|IN_ATTRIB)) == 0 && (e->mask & IN_MODIFY) &&
+                            has_file_by_name(j, d->path, e->name))
+                                /* journald modifies the files it writes to all the time, which we have to
+                                 * follow, but that can never replace the inode we already track. Let's not
+                                 * reopen and stat the file on every single write then, there's nothing to
+                                 * do beyond waking up the caller. */
+                                return;
+
                         if (e->mask & (IN_CREATE|IN_MOVED_TO|IN_MODIFY|IN_ATTRIB))
                                 (void) add_file_by_name(j, d->path, e->name);
                         else if (e->mask & (IN_DELETE|IN_MOVED_FROM|IN_UNMOUNT))
@@ -2802,10 +2830,20 @@ _public_ int sd_journal_query_unique(sd_journal *j, const char *field) {
         j->unique_file = NULL;
         j->unique_offset = 0;
         j->unique_file_lost = false;
+        set_clear(j->unique_values);
 
         return 0;
 }
 
+static void* unique_value_hash(const void *data, size_t size) {
+        /* A fixed key is fine here: the hash is only used as a filter, and a collision merely means we fall
+         * back to looking the value up in the earlier files. Make sure we never end up with a NULL key. */
+        static const uint8_t key[16] = { 0x0a, 0x66, 0x9a, 0x1e, 0x14, 0xf0, 0x42, 0x4c,
+                                         0x8b, 0x3d, 0x53, 0x77, 0x06, 0xd1, 0x2e, 0xc9 };
+
+        return UINT64_TO_PTR(siphash24(data, size, key) | 1);
+}
+
 _public_ int sd_journal_enumerate_unique(
                 sd_journal *j,
                 const void **ret_data,
@@ -2833,7 +2871,7 @@ _public_ int sd_journal_enumerate_unique(
         for (;;) {
                 JournalFile *of;
                 Object *o;
-                void *odata;
+                void *odata, *h;
                 size_t ol;
                 bool found;
                 int r;
@@ -2896,35 +2934,44 @@ _public_ int sd_journal_enumerate_unique(
                                                j->unique_offset,
                                                j->unique_field);
 
-                /* OK, now let's see if we already returned this data object by checking if it exists in the
-                 * earlier traversed files. */
+                /* OK, now let's see if we already returned this data object. Every value of the earlier
+                 * traversed files has been hashed into j->unique_values, hence if the hash is not known yet
+                 * this is definitely a new value, and we can avoid looking it up in all earlier files. That
+                 * matters a lot for fields with many values on systems with many journal files. Only if the
+                 * hash is known we check if the value actually exists in one of the earlier files. */
+                h = unique_value_hash(odata, ol);
                 found = false;
-                ORDERED_HASHMAP_FOREACH(of, j->files) {
-                        if (of == j->unique_file)
-                                break;
-
-                        /* Skip this file it didn't have any fields indexed */
-                        if (JOURNAL_HEADER_CONTAINS(of->header, n_fields) && le64toh(of->header->n_fields) <= 0)
-                                continue;
+                if (set_contains(j->unique_values, h))
+                        ORDERED_HASHMAP_FOREACH(of, j->files) {
+                                if (of == j->unique_file)
+                                        break;
 
-                        /* We can reuse the hash from our current file only on old-style journal files
-                         * without keyed hashes. On new-style files we have to calculate the hash anew, to
-                         * take the per-file hash seed into consideration. */
-                        if (!JOURNAL_HEADER_KEYED_HASH(j->unique_file->header) && !JOURNAL_HEADER_KEYED_HASH(of->header))
-                                r = journal_file_find_data_object_with_hash(of, odata, ol, le64toh(o->data.hash), NULL, NULL);
-                        else
-                                r = journal_file_find_data_object(of, odata, ol, NULL, NULL);
-                        if (r < 0)
-                                return r;
-                        if (r > 0) {
-                                found = true;
-                                break;
+                                /* Skip this file it didn't have any fields indexed */
+                                if (JOURNAL_HEADER_CONTAINS(of->header, n_fields) && le64toh(of->header->n_fields) <= 0)
+                                        continue;
+
+                                /* We can reuse the hash from our current file only on old-style journal
+                                 * files without keyed hashes. On new-style files we have to calculate the
+                                 * hash anew, to take the per-file hash seed into consideration. */
+                                if (!JOURNAL_HEADER_KEYED_HASH(j->unique_file->header) && !JOURNAL_HEADER_KEYED_HASH(of->header))
+                                        r = journal_file_find_data_object_with_hash(of, odata, ol, le64toh(o->data.hash), NULL, NULL);
+                                else
+                                        r = journal_file_find_data_object(of, odata, ol, NULL, NULL);
+                                if (r < 0)
+                                        return r;
+                                if (r > 0) {
+                                        found = true;
+                                        break;
+                                }
                         }
-                }
 
                 if (found)
                         continue;
 
+                r = set_ensure_put(&j->unique_values, NULL, h);
+                if (r < 0)
+                        return r;
+
                 *ret_data = odata;
                 *ret_size = ol;
 
@@ -2953,6 +3000,7 @@ _public_ void sd_journal_restart_unique(sd_journal *j) {
         j->unique_file = NULL;
         j->unique_offset = 0;
         j->unique_file_lost = false;
+        set_clear(j->unique_values);
 }
 
 _public_ int sd_journal_enumerate_fields(sd_journal *j, const char **field) {
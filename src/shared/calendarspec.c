@@ -1103,9 +1103,53 @@ int calendar_spec_from_string(const char *p, CalendarSpec **spec) {
         return 0;
 }
 
+/* Plain calendar arithmetic. Unlike mktime() this doesn't need to consult the time zone database, and
+ * neither the day of week nor the length of a month depend on the time zone. find_next() calls these for
+ * every candidate day, hence avoid the expensive normalization where we can. */
+
+static bool year_is_leap(int year) {
+        return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int tm_days_in_month(const struct tm *tm) {
+        static const int days_per_month[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+        assert(tm);
+        assert(tm->tm_mon >= 0 && tm->tm_mon <= 11);
+
+        return days_per_month[tm->tm_mon] + (tm->tm_mon == 1 && year_is_leap(tm->tm_year + 1900));
+}
+
+static bool tm_date_is_normalized(const struct tm *tm) {
+        assert(tm);
+
+        return tm->tm_mon >= 0 && tm->tm_mon <= 11 &&
+                tm->tm_mday >= 1 && tm->tm_mday <= tm_days_in_month(tm);
+}
+
+static int tm_weekday(const struct tm *tm) {
+        static const int month_offset[12] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+        int y, w;
+
+        assert(tm);
+        assert(tm->tm_mon >= 0 && tm->tm_mon <= 11);
+
+        /* Returns the day of the week the same way as tm_wday, i.e. 0 is Sunday */
+        y = tm->tm_year + 1900 - (tm->tm_mon < 2);
+        w = (y + y / 4 - y / 100 + y / 400 + month_offset[tm->tm_mon] + tm->tm_mday) % 7;
+
+        return w < 0 ? w + 7 : w;
+}
+
 static int find_end_of_month(const struct tm *tm, bool utc, int day) {
         struct tm t = *tm;
 
+        if (tm_date_is_normalized(tm)) {
+                int d = tm_days_in_month(tm) + 1 - day;
+
+                return d >= 1 && d <= tm_days_in_month(tm) ? d : -1;
+        }
+
         t.tm_mon++;
         t.tm_mday = 1 - day;
 
@@ -1232,7 +1276,9 @@ static bool matches_weekday(int weekdays_bits, const struct tm *tm, bool utc) {
                 return true;
 
         t = *tm;
-        if (mktime_or_timegm(&t, utc) < 0)
+        if (tm_date_is_normalized(&t))
+                t.tm_wday = tm_weekday(&t);
+        else if (mktime_or_timegm(&t, utc) < 0)
                 return false;
 
         k = t.tm_wday == 0 ? 6 : t.tm_wday - 1;
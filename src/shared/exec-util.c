@@ -2,8 +2,10 @@
 
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/prctl.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <stdio.h>
 
@@ -11,13 +13,16 @@
 #include "conf-files.h"
 #include "env-file.h"
 #include "env-util.h"
+#include "escape.h"
 #include "errno-util.h"
 #include "exec-util.h"
 #include "fd-util.h"
 #include "fileio.h"
 #include "hashmap.h"
+#include "io-util.h"
 #include "macro.h"
 #include "missing_syscall.h"
+#include "parse-util.h"
 #include "path-util.h"
 #include "process-util.h"
 #include "rlimit-util.h"
@@ -29,6 +34,7 @@
 #include "string-util.h"
 #include "strv.h"
 #include "terminal-util.h"
+#include "time-util.h"
 #include "tmpfile-util.h"
 
 /* Put this test here for a lack of better place */
@@ -79,19 +85,106 @@ static int do_spawn(const char *path, char *argv[], int stdout_fd, pid_t *pid, b
         return 1;
 }
 
+typedef struct ExecChild {
+        char *path;
+        usec_t start;
+} ExecChild;
+
+static ExecChild* exec_child_free(ExecChild *c) {
+        if (!c)
+                return NULL;
+
+        free(c->path);
+        return mfree(c);
+}
+
+DEFINE_TRIVIAL_CLEANUP_FUNC(ExecChild*, exec_child_free);
+DEFINE_PRIVATE_HASH_OPS_WITH_VALUE_DESTRUCTOR(exec_child_hash_ops, void, trivial_hash_func, trivial_compare_func,
+                                              ExecChild, exec_child_free);
+
+static unsigned max_parallel(void) {
+        uint64_t n;
+        int r;
+
+        /* Optionally cap the number of executables that run at the same time, so that a large number of
+         * generators or hooks does not overcommit a system with few CPUs. 0 means no limit. */
+
+        r = getenv_uint64_secure("SYSTEMD_EXEC_DIR_MAX_PARALLEL", &n);
+        if (r == -ENXIO)
+                return 0;
+        if (r < 0) {
+                log_debug_errno(r, "Failed to parse $SYSTEMD_EXEC_DIR_MAX_PARALLEL, ignoring: %m");
+                return 0;
+        }
+
+        return (unsigned) MIN(n, (uint64_t) UINT_MAX);
+}
+
+static void record_runtime(const char *path, usec_t start, int runtimes_fd) {
+        _cleanup_free_ char *e = NULL, *line = NULL;
+        usec_t t;
+
+        assert(path);
+
+        t = usec_sub_unsigned(now(CLOCK_MONOTONIC), start);
+        log_debug("%s finished after %s.", path, FORMAT_TIMESPAN(t, USEC_PER_MSEC));
+
+        if (runtimes_fd < 0)
+                return;
+
+        /* Children write here concurrently, hence write each record with a single write() */
+        e = cescape(path);
+        if (!e || asprintf(&line, USEC_FMT " %s\n", t, e) < 0) {
+                log_oom_debug();
+                return;
+        }
+
+        (void) loop_write(runtimes_fd, line, strlen(line), false);
+}
+
+static int wait_for_child(Hashmap *pids, pid_t pid, int runtimes_fd) {
+        _cleanup_(exec_child_freep) ExecChild *c = NULL;
+        int r;
+
+        c = hashmap_remove(pids, PID_TO_PTR(pid));
+        assert(c);
+
+        r = wait_for_terminate_and_check(c->path, pid, WAIT_LOG);
+        record_runtime(c->path, c->start, runtimes_fd);
+
+        return r;
+}
+
+static int wait_for_any_child(Hashmap *pids, int runtimes_fd) {
+        siginfo_t si = {};
+
+        /* We run in our own (sd-executor) process, hence all our children are ones we forked off
+         * ourselves. Use WNOWAIT so that the child is reaped (and its exit status logged) by
+         * wait_for_child(). */
+
+        if (waitid(P_ALL, 0, &si, WEXITED|WNOWAIT) < 0)
+                return log_error_errno(errno, "Failed to wait for children: %m");
+
+        if (!hashmap_contains(pids, PID_TO_PTR(si.si_pid)))
+                return log_error_errno(SYNTHETIC_ERRNO(ECHILD), "Got exit status of unknown child " PID_FMT ".", si.si_pid);
+
+        return wait_for_child(pids, si.si_pid, runtimes_fd);
+}
+
 static int do_execute(
-                char **directories,
+                char* const* paths,
                 usec_t timeout,
                 gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
                 void* const callback_args[_STDOUT_CONSUME_MAX],
                 int output_fd,
                 char *argv[],
                 char *envp[],
-                ExecDirFlags flags) {
+                ExecDirFlags flags,
+                int runtimes_fd) {
 
-        _cleanup_hashmap_free_free_ Hashmap *pids = NULL;
-        _cleanup_strv_free_ char **paths = NULL;
-        int r;
+        _cleanup_hashmap_free_ Hashmap *pids = NULL;
+        unsigned n_max = 0;
+        int r, ret = 0;
         bool parallel_execution;
 
         /* We fork this all off from a child process so that we can somewhat cleanly make
@@ -102,14 +195,12 @@ static int do_execute(
          */
         parallel_execution = FLAGS_SET(flags, EXEC_DIR_PARALLEL) && !callbacks;
 
-        r = conf_files_list_strv(&paths, NULL, NULL, CONF_FILES_EXECUTABLE|CONF_FILES_REGULAR|CONF_FILES_FILTER_MASKED, (const char* const*) directories);
-        if (r < 0)
-                return log_error_errno(r, "Failed to enumerate executables: %m");
-
         if (parallel_execution) {
-                pids = hashmap_new(NULL);
+                pids = hashmap_new(&exec_child_hash_ops);
                 if (!pids)
                         return log_oom();
+
+                n_max = max_parallel();
         }
 
         /* Abort execution of this process after the timeout. We simply rely on SIGALRM as
@@ -125,6 +216,7 @@ static int do_execute(
         STRV_FOREACH(path, paths) {
                 _cleanup_free_ char *t = NULL;
                 _cleanup_close_ int fd = -EBADF;
+                usec_t start;
                 pid_t pid;
 
                 t = strdup(*path);
@@ -143,17 +235,42 @@ static int do_execute(
                                 return log_error_errno(fd, "Failed to open serialization file: %m");
                 }
 
+                if (parallel_execution && n_max > 0)
+                        while (hashmap_size(pids) >= n_max) {
+                                /* Executables that already failed don't keep the others from running,
+                                 * as without the cap they'd all have been started already anyway. */
+                                r = wait_for_any_child(pids, runtimes_fd);
+                                if (r < 0)
+                                        return r;
+                                if (r > 0 && ret == 0 && !FLAGS_SET(flags, EXEC_DIR_IGNORE_ERRORS))
+                                        ret = r;
+                        }
+
+                start = now(CLOCK_MONOTONIC);
+
                 r = do_spawn(t, argv, fd, &pid, FLAGS_SET(flags, EXEC_DIR_SET_SYSTEMD_EXEC_PID));
                 if (r <= 0)
                         continue;
 
                 if (parallel_execution) {
-                        r = hashmap_put(pids, PID_TO_PTR(pid), t);
+                        _cleanup_(exec_child_freep) ExecChild *c = NULL;
+
+                        c = new(ExecChild, 1);
+                        if (!c)
+                                return log_oom();
+
+                        *c = (ExecChild) {
+                                .path = TAKE_PTR(t),
+                                .start = start,
+                        };
+
+                        r = hashmap_put(pids, PID_TO_PTR(pid), c);
                         if (r < 0)
                                 return log_oom();
-                        t = NULL;
+                        TAKE_PTR(c);
                 } else {
                         r = wait_for_terminate_and_check(t, pid, WAIT_LOG);
+                        record_runtime(t, start, runtimes_fd);
                         if (FLAGS_SET(flags, EXEC_DIR_IGNORE_ERRORS)) {
                                 if (r < 0)
                                         continue;
@@ -178,44 +295,37 @@ static int do_execute(
                         return log_error_errno(r, "Callback two failed: %m");
         }
 
+        /* Reap the remaining children in the order they finish, so that the logged runtimes are accurate */
         while (!hashmap_isempty(pids)) {
-                _cleanup_free_ char *t = NULL;
-                pid_t pid;
-
-                pid = PTR_TO_PID(hashmap_first_key(pids));
-                assert(pid > 0);
-
-                t = hashmap_remove(pids, PID_TO_PTR(pid));
-                assert(t);
-
-                r = wait_for_terminate_and_check(t, pid, WAIT_LOG);
-                if (!FLAGS_SET(flags, EXEC_DIR_IGNORE_ERRORS) && r > 0)
+                r = wait_for_any_child(pids, runtimes_fd);
+                if (r < 0)
                         return r;
+                if (r > 0 && ret == 0 && !FLAGS_SET(flags, EXEC_DIR_IGNORE_ERRORS))
+                        ret = r;
         }
 
-        return 0;
+        return ret;
 }
 
-int execute_directories(
-                const char* const* directories,
+int execute_strv(
+                const char *name,
+                char* const* paths,
                 usec_t timeout,
                 gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
                 void* const callback_args[_STDOUT_CONSUME_MAX],
                 char *argv[],
                 char *envp[],
-                ExecDirFlags flags) {
+                ExecDirFlags flags,
+                int runtimes_fd) {
 
-        char **dirs = (char**) directories;
-        _cleanup_free_ char *name = NULL;
         _cleanup_close_ int fd = -EBADF;
-        int r;
         pid_t executor_pid;
+        int r;
 
-        assert(!strv_isempty(dirs));
+        assert(name);
 
-        r = path_extract_filename(dirs[0], &name);
-        if (r < 0)
-                return log_error_errno(r, "Failed to extract file name from '%s': %m", dirs[0]);
+        if (strv_isempty(paths))
+                return 0;
 
         if (callbacks) {
                 assert(callback_args);
@@ -228,15 +338,15 @@ int execute_directories(
                         return log_error_errno(fd, "Failed to open serialization file: %m");
         }
 
-        /* Executes all binaries in the directories serially or in parallel and waits for
-         * them to finish. Optionally a timeout is applied. If a file with the same name
-         * exists in more than one directory, the earliest one wins. */
+        /* Executes all binaries in the list serially or in parallel and waits for them to finish.
+         * Optionally a timeout is applied. If runtimes_fd is valid, a line with the runtime and the
+         * (C-escaped) path of each executable is appended to it, see exec_dir_runtimes_read(). */
 
         r = safe_fork("(sd-executor)", FORK_RESET_SIGNALS|FORK_DEATHSIG|FORK_LOG, &executor_pid);
         if (r < 0)
                 return r;
         if (r == 0) {
-                r = do_execute(dirs, timeout, callbacks, callback_args, fd, argv, envp, flags);
+                r = do_execute(paths, timeout, callbacks, callback_args, fd, argv, envp, flags, runtimes_fd);
                 _exit(r < 0 ? EXIT_FAILURE : r);
         }
 
@@ -259,6 +369,118 @@ int execute_directories(
         return 0;
 }
 
+int execute_directories(
+                const char* const* directories,
+                usec_t timeout,
+                gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
+                void* const callback_args[_STDOUT_CONSUME_MAX],
+                char *argv[],
+                char *envp[],
+                ExecDirFlags flags) {
+
+        _cleanup_strv_free_ char **paths = NULL;
+        _cleanup_free_ char *name = NULL;
+        int r;
+
+        assert(!strv_isempty((char**) directories));
+
+        /* If a file with the same name exists in more than one directory, the earliest one wins. */
+
+        r = conf_files_list_strv(&paths, NULL, NULL, CONF_FILES_EXECUTABLE|CONF_FILES_REGULAR|CONF_FILES_FILTER_MASKED, directories);
+        if (r < 0)
+                return log_error_errno(r, "Failed to enumerate executables: %m");
+
+        if (strv_isempty(paths)) {
+                log_debug("No executables found.");
+                return 0;
+        }
+
+        r = path_extract_filename(directories[0], &name);
+        if (r < 0)
+                return log_error_errno(r, "Failed to extract file name from '%s': %m", directories[0]);
+
+        return execute_strv(name, paths, timeout, callbacks, callback_args, argv, envp, flags, /* runtimes_fd= */ -EBADF);
+}
+
+void exec_dir_runtime_free_many(ExecDirRuntime *runtimes, size_t n) {
+        assert(runtimes || n == 0);
+
+        for (size_t i = 0; i < n; i++)
+                free(runtimes[i].path);
+
+        free(runtimes);
+}
+
+int exec_dir_runtimes_read(int fd, ExecDirRuntime **ret, size_t *ret_n) {
+        ExecDirRuntime *runtimes = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        _cleanup_close_ int copy = -EBADF;
+        size_t n = 0;
+        int r;
+
+        assert(fd >= 0);
+        assert(ret);
+        assert(ret_n);
+
+        /* Reads what execute_strv() appended to its runtimes_fd. Doesn't take possession of fd. */
+
+        if (lseek(fd, 0, SEEK_SET) < 0)
+                return -errno;
+
+        copy = fcntl(fd, F_DUPFD_CLOEXEC, 3);
+        if (copy < 0)
+                return -errno;
+
+        f = take_fdopen(&copy, "r");
+        if (!f)
+                return -errno;
+
+        for (;;) {
+                _cleanup_free_ char *line = NULL, *path = NULL;
+                char *p;
+                usec_t t;
+
+                r = read_line(f, LONG_LINE_MAX, &line);
+                if (r < 0)
+                        goto fail;
+                if (r == 0)
+                        break;
+
+                p = strchr(line, ' ');
+                if (!p) {
+                        r = -EBADMSG;
+                        goto fail;
+                }
+                *p++ = 0;
+
+                r = safe_atou64(line, &t);
+                if (r < 0)
+                        goto fail;
+
+                r = cunescape(p, 0, &path);
+                if (r < 0)
+                        goto fail;
+
+                if (!GREEDY_REALLOC(runtimes, n + 1)) {
+                        r = -ENOMEM;
+                        goto fail;
+                }
+
+                runtimes[n++] = (ExecDirRuntime) {
+                        .path = TAKE_PTR(path),
+                        .usec = t,
+                };
+        }
+
+        *ret = runtimes;
+        *ret_n = n;
+        return 0;
+
+fail:
+        exec_dir_runtime_free_many(runtimes, n);
+        return r;
+}
+
 static int gather_environment_generate(int fd, void *arg) {
         char ***env = ASSERT_PTR(arg);
         _cleanup_fclose_ FILE *f = NULL;
@@ -424,6 +646,7 @@ static const char* const exec_command_strings[] = {
         "no-setuid",      /* EXEC_COMMAND_NO_SETUID */
         "ambient",        /* EXEC_COMMAND_AMBIENT_MAGIC */
         "no-env-expand",  /* EXEC_COMMAND_NO_ENV_EXPAND */
+        "parallel",       /* EXEC_COMMAND_PARALLEL */
 };
 
 const char* exec_command_flags_to_string(ExecCommandFlags i) {
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "time-util.h"
 
@@ -27,9 +28,26 @@ typedef enum ExecCommandFlags {
         EXEC_COMMAND_NO_SETUID        = 1 << 2,
         EXEC_COMMAND_AMBIENT_MAGIC    = 1 << 3,
         EXEC_COMMAND_NO_ENV_EXPAND    = 1 << 4,
+        EXEC_COMMAND_PARALLEL         = 1 << 5,
         _EXEC_COMMAND_FLAGS_INVALID   = -EINVAL,
 } ExecCommandFlags;
 
+typedef struct ExecDirRuntime {
+        char *path;
+        usec_t usec;
+} ExecDirRuntime;
+
+int execute_strv(
+                const char *name,
+                char* const* paths,
+                usec_t timeout,
+                gather_stdout_callback_t const callbacks[_STDOUT_CONSUME_MAX],
+                void* const callback_args[_STDOUT_CONSUME_MAX],
+                char *argv[],
+                char *envp[],
+                ExecDirFlags flags,
+                int runtimes_fd);
+
 int execute_directories(
                 const char* const* directories,
                 usec_t timeout,
@@ -39,6 +57,9 @@ int execute_directories(
                 char *envp[],
                 ExecDirFlags flags);
 
+void exec_dir_runtime_free_many(ExecDirRuntime *runtimes, size_t n);
+int exec_dir_runtimes_read(int fd, ExecDirRuntime **ret, size_t *ret_n);
+
 int exec_command_flags_from_strv(char **ex_opts, ExecCommandFlags *flags);
 int exec_command_flags_to_strv(ExecCommandFlags flags, char ***ex_opts);
 
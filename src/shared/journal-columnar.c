@@ -0,0 +1,529 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/uio.h>
+
+#include "alloc-util.h"
+#include "hashmap.h"
+#include "io-util.h"
+#include "journal-columnar.h"
+#include "journal-file.h"
+#include "journal-internal.h"
+#include "journal-util.h"
+#include "log.h"
+#include "memory-util.h"
+#include "siphash24.h"
+#include "sparse-endian.h"
+#include "string-util.h"
+#include "strv.h"
+
+/* The columns that are used if no explicit field list is specified */
+static const char* const default_fields[] = {
+        "PRIORITY",
+        "SYSLOG_IDENTIFIER",
+        "_SYSTEMD_UNIT",
+        "_PID",
+        "_HOSTNAME",
+        "MESSAGE",
+        NULL
+};
+
+typedef struct JournalColumn {
+        char *name;
+        JournalColumnType type;
+
+        /* JOURNAL_COLUMN_DELTA */
+        uint64_t *numbers;
+
+        /* JOURNAL_COLUMN_DICTIONARY: the hashmap maps struct iovec → index + 1, the index refers to the
+         * values array, which owns the keys. An index of 0 in the indexes array means the field is not set
+         * in the row. */
+        Hashmap *dictionary;
+        struct iovec **values;
+        size_t n_values;
+        uint32_t *indexes;
+
+        /* Columns populated from entry data: the field name, as key in columns_by_field, and the value for
+         * the row that is currently being added, as offset and size in the writer's scratch buffer. */
+        struct iovec field;
+        bool pending;
+        size_t pending_offset, pending_size;
+} JournalColumn;
+
+struct JournalColumnarWriter {
+        JournalColumn *columns;
+        size_t n_columns;
+
+        /* Field name → JournalColumn* for the columns that are populated from entry data. The keys are
+         * struct iovec, so that fields can be looked up directly from the entry data. */
+        Hashmap *columns_by_field;
+
+        /* Copies of the values of the entry that is currently being added. They are only interned into
+         * the dictionaries once the whole entry could be read. */
+        uint8_t *scratch;
+        size_t scratch_size;
+
+        size_t n_rows, max_rows;
+        Compression compression;
+};
+
+enum {
+        COLUMN_REALTIME,
+        COLUMN_MONOTONIC,
+        COLUMN_BOOT_ID,
+        _COLUMN_FIXED_MAX,
+};
+
+static void iovec_hash_func(const struct iovec *iov, struct siphash *state) {
+        siphash24_compress(&iov->iov_len, sizeof(iov->iov_len), state);
+        siphash24_compress_safe(iov->iov_base, iov->iov_len, state);
+}
+
+static int iovec_compare_func(const struct iovec *a, const struct iovec *b) {
+        return memcmp_nn(a->iov_base, a->iov_len, b->iov_base, b->iov_len);
+}
+
+DEFINE_PRIVATE_HASH_OPS(iovec_hash_ops, struct iovec, iovec_hash_func, iovec_compare_func);
+
+static void journal_column_done(JournalColumn *c) {
+        assert(c);
+
+        free(c->name);
+        free(c->numbers);
+        free(c->indexes);
+        hashmap_free(c->dictionary);
+
+        for (size_t i = 0; i < c->n_values; i++) {
+                free(c->values[i]->iov_base);
+                free(c->values[i]);
+        }
+        free(c->values);
+}
+
+static void journal_column_reset(JournalColumn *c) {
+        assert(c);
+
+        /* Dictionaries are local to a row group, so that each row group can be decoded on its own */
+        hashmap_clear(c->dictionary);
+
+        for (size_t i = 0; i < c->n_values; i++) {
+                free(c->values[i]->iov_base);
+                free(c->values[i]);
+        }
+        c->n_values = 0;
+}
+
+static int journal_column_init(JournalColumn *c, const char *name, JournalColumnType type, size_t max_rows) {
+        assert(c);
+        assert(name);
+        assert(max_rows > 0);
+
+        c->name = strdup(name);
+        if (!c->name)
+                return -ENOMEM;
+
+        c->type = type;
+
+        if (type == JOURNAL_COLUMN_DELTA) {
+                c->numbers = new(uint64_t, max_rows);
+                if (!c->numbers)
+                        return -ENOMEM;
+        } else {
+                c->indexes = new(uint32_t, max_rows);
+                if (!c->indexes)
+                        return -ENOMEM;
+
+                c->dictionary = hashmap_new(&iovec_hash_ops);
+                if (!c->dictionary)
+                        return -ENOMEM;
+        }
+
+        return 0;
+}
+
+static int journal_column_put_value(JournalColumn *c, size_t row, const void *data, size_t size) {
+        _cleanup_free_ struct iovec *iov = NULL;
+        struct iovec key = IOVEC_MAKE((void*) data, size);
+        void *p;
+        int r;
+
+        assert(c);
+        assert(c->type == JOURNAL_COLUMN_DICTIONARY);
+        assert(data || size == 0);
+
+        p = hashmap_get(c->dictionary, &key);
+        if (p) {
+                c->indexes[row] = PTR_TO_UINT32(p);
+                return 0;
+        }
+
+        if (c->n_values >= UINT32_MAX - 1)
+                return -E2BIG;
+
+        if (!GREEDY_REALLOC(c->values, c->n_values + 1))
+                return -ENOMEM;
+
+        iov = new(struct iovec, 1);
+        if (!iov)
+                return -ENOMEM;
+
+        *iov = IOVEC_MAKE(memdup_suffix0(data, size), size);
+        if (!iov->iov_base)
+                return -ENOMEM;
+
+        r = hashmap_put(c->dictionary, iov, UINT32_TO_PTR(c->n_values + 1));
+        if (r < 0) {
+                free(iov->iov_base);
+                return r;
+        }
+
+        c->values[c->n_values++] = TAKE_PTR(iov);
+        c->indexes[row] = c->n_values;
+        return 0;
+}
+
+JournalColumnarWriter* journal_columnar_writer_free(JournalColumnarWriter *w) {
+        if (!w)
+                return NULL;
+
+        for (size_t i = 0; i < w->n_columns; i++)
+                journal_column_done(w->columns + i);
+        free(w->columns);
+
+        hashmap_free(w->columns_by_field);
+        free(w->scratch);
+
+        return mfree(w);
+}
+
+int journal_columnar_writer_new(
+                char **fields,
+                size_t max_rows,
+                Compression compression,
+                JournalColumnarWriter **ret) {
+
+        _cleanup_(journal_columnar_writer_freep) JournalColumnarWriter *w = NULL;
+        int r;
+
+        assert(compression >= 0);
+        assert(compression < _COMPRESSION_MAX);
+        assert(ret);
+
+        if (strv_isempty(fields))
+                fields = (char**) default_fields;
+
+        w = new(JournalColumnarWriter, 1);
+        if (!w)
+                return -ENOMEM;
+
+        *w = (JournalColumnarWriter) {
+                .max_rows = max_rows > 0 ? MIN(max_rows, (size_t) UINT32_MAX) : JOURNAL_COLUMNAR_ROWS_DEFAULT,
+                .compression = compression,
+        };
+
+        w->columns = new0(JournalColumn, _COLUMN_FIXED_MAX + strv_length(fields));
+        if (!w->columns)
+                return -ENOMEM;
+
+        w->columns_by_field = hashmap_new(&iovec_hash_ops);
+        if (!w->columns_by_field)
+                return -ENOMEM;
+
+        /* The columns array is zero-initialized, hence bump n_columns first so that partially initialized
+         * columns are released too on failure. */
+        w->n_columns = _COLUMN_FIXED_MAX;
+
+        r = journal_column_init(w->columns + COLUMN_REALTIME, "__REALTIME_TIMESTAMP", JOURNAL_COLUMN_DELTA, w->max_rows);
+        if (r < 0)
+                return r;
+        r = journal_column_init(w->columns + COLUMN_MONOTONIC, "__MONOTONIC_TIMESTAMP", JOURNAL_COLUMN_DELTA, w->max_rows);
+        if (r < 0)
+                return r;
+        r = journal_column_init(w->columns + COLUMN_BOOT_ID, "_BOOT_ID", JOURNAL_COLUMN_DICTIONARY, w->max_rows);
+        if (r < 0)
+                return r;
+
+        STRV_FOREACH(field, fields) {
+                JournalColumn *c;
+
+                if (!journal_field_valid(*field, SIZE_MAX, true))
+                        return log_debug_errno(SYNTHETIC_ERRNO(EINVAL), "Invalid field name: %s", *field);
+
+                /* The boot ID is always included, and duplicates make no sense */
+                if (streq(*field, "_BOOT_ID") || hashmap_contains(w->columns_by_field, &IOVEC_MAKE_STRING(*field)))
+                        continue;
+
+                c = w->columns + w->n_columns++;
+                r = journal_column_init(c, *field, JOURNAL_COLUMN_DICTIONARY, w->max_rows);
+                if (r < 0)
+                        return r;
+
+                c->field = IOVEC_MAKE_STRING(c->name);
+
+                r = hashmap_put(w->columns_by_field, &c->field, c);
+                if (r < 0)
+                        return r;
+        }
+
+        *ret = TAKE_PTR(w);
+        return 0;
+}
+
+size_t journal_columnar_writer_pending(JournalColumnarWriter *w) {
+        assert(w);
+
+        return w->n_rows;
+}
+
+static int buffer_append(uint8_t **buf, size_t *size, const void *p, size_t n) {
+        assert(buf);
+        assert(size);
+        assert(p || n == 0);
+
+        if (n == 0)
+                return 0;
+
+        if (!GREEDY_REALLOC(*buf, *size + n))
+                return -ENOMEM;
+
+        memcpy(*buf + *size, p, n);
+        *size += n;
+        return 0;
+}
+
+static int buffer_append_le32(uint8_t **buf, size_t *size, uint32_t v) {
+        le32_t le = htole32(v);
+        return buffer_append(buf, size, &le, sizeof(le));
+}
+
+static int buffer_append_le64(uint8_t **buf, size_t *size, uint64_t v) {
+        le64_t le = htole64(v);
+        return buffer_append(buf, size, &le, sizeof(le));
+}
+
+static int journal_column_serialize(JournalColumn *c, size_t n_rows, uint8_t **ret, size_t *ret_size) {
+        _cleanup_free_ uint8_t *buf = NULL;
+        size_t size = 0;
+        int r;
+
+        assert(c);
+        assert(ret);
+        assert(ret_size);
+
+        if (c->type == JOURNAL_COLUMN_DELTA) {
+                uint64_t previous = 0;
+
+                /* Timestamps of consecutive entries are close to each other, hence store the differences
+                 * only, which makes them compress very well. */
+                for (size_t i = 0; i < n_rows; i++) {
+                        r = buffer_append_le64(&buf, &size, c->numbers[i] - previous);
+                        if (r < 0)
+                                return r;
+
+                        previous = c->numbers[i];
+                }
+        } else {
+                r = buffer_append_le32(&buf, &size, c->n_values);
+                if (r < 0)
+                        return r;
+
+                for (size_t i = 0; i < c->n_values; i++) {
+                        r = buffer_append_le32(&buf, &size, c->values[i]->iov_len);
+                        if (r < 0)
+                                return r;
+
+                        r = buffer_append(&buf, &size, c->values[i]->iov_base, c->values[i]->iov_len);
+                        if (r < 0)
+                                return r;
+                }
+
+                for (size_t i = 0; i < n_rows; i++) {
+                        r = buffer_append_le32(&buf, &size, c->indexes[i]);
+                        if (r < 0)
+                                return r;
+                }
+        }
+
+        *ret = TAKE_PTR(buf);
+        *ret_size = size;
+        return 0;
+}
+
+static int journal_column_write(JournalColumnarWriter *w, JournalColumn *c, FILE *f) {
+        _cleanup_free_ uint8_t *buf = NULL, *compressed = NULL;
+        const uint8_t *payload;
+        size_t size, payload_size;
+        Compression compression = COMPRESSION_NONE;
+        uint8_t header[4] = {};
+        le32_t name_size;
+        le64_t sizes[2];
+        int r;
+
+        assert(w);
+        assert(c);
+        assert(f);
+
+        r = journal_column_serialize(c, w->n_rows, &buf, &size);
+        if (r < 0)
+                return r;
+
+        payload = buf;
+        payload_size = size;
+
+        if (w->compression != COMPRESSION_NONE && size > 0) {
+                size_t compressed_size;
+
+                /* Only keep the compressed payload if it is actually smaller */
+                compressed = malloc(size);
+                if (!compressed)
+                        return -ENOMEM;
+
+                r = compress_blob_explicit(w->compression, buf, size, compressed, size - 1, &compressed_size);
+                if (r >= 0) {
+                        compression = r;
+                        payload = compressed;
+                        payload_size = compressed_size;
+                } else
+                        log_debug_errno(r, "Failed to compress column %s, storing it uncompressed: %m", c->name);
+        }
+
+        name_size = htole32(strlen(c->name));
+        sizes[0] = htole64(size);
+        sizes[1] = htole64(payload_size);
+        header[0] = c->type;
+        header[1] = compression;
+
+        fwrite(&name_size, sizeof(name_size), 1, f);
+        fputs(c->name, f);
+        fwrite(header, sizeof(header), 1, f);
+        fwrite(sizes, sizeof(sizes), 1, f);
+        fwrite(payload, 1, payload_size, f);
+
+        return 0;
+}
+
+int journal_columnar_writer_flush(JournalColumnarWriter *w, FILE *f) {
+        le32_t header[3];
+        int r;
+
+        assert(w);
+        assert(f);
+
+        if (w->n_rows == 0)
+                return 0;
+
+        header[0] = htole32(JOURNAL_COLUMNAR_VERSION);
+        header[1] = htole32(w->n_rows);
+        header[2] = htole32(w->n_columns);
+
+        fputs(JOURNAL_COLUMNAR_MAGIC, f);
+        fwrite(header, sizeof(header), 1, f);
+
+        for (size_t i = 0; i < w->n_columns; i++) {
+                r = journal_column_write(w, w->columns + i, f);
+                if (r < 0)
+                        return r;
+
+                if (w->columns[i].type == JOURNAL_COLUMN_DICTIONARY)
+                        journal_column_reset(w->columns + i);
+        }
+
+        w->n_rows = 0;
+
+        if (ferror(f))
+                return -EIO;
+
+        return 1;
+}
+
+int journal_columnar_writer_add_entry(JournalColumnarWriter *w, sd_journal *j, FILE *f) {
+        const void *data;
+        sd_id128_t boot_id;
+        size_t length, row;
+        int r;
+
+        assert(w);
+        assert(j);
+        assert(f);
+        assert(w->n_rows < w->max_rows);
+
+        row = w->n_rows;
+
+        (void) sd_journal_set_data_threshold(j, 0);
+
+        r = sd_journal_get_realtime_usec(j, &w->columns[COLUMN_REALTIME].numbers[row]);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get realtime timestamp: %m");
+
+        r = sd_journal_get_monotonic_usec(j, &w->columns[COLUMN_MONOTONIC].numbers[row], &boot_id);
+        if (r < 0)
+                return log_error_errno(r, "Failed to get monotonic timestamp: %m");
+
+        for (size_t i = _COLUMN_FIXED_MAX; i < w->n_columns; i++)
+                w->columns[i].pending = false;
+        w->scratch_size = 0;
+
+        JOURNAL_FOREACH_DATA_RETVAL(j, data, length, r) {
+                JournalColumn *c;
+                const char *eq;
+                size_t fieldlen;
+
+                eq = memchr(data, '=', length);
+                if (!eq)
+                        continue;
+
+                fieldlen = eq - (const char*) data;
+                c = hashmap_get(w->columns_by_field, &IOVEC_MAKE((void*) data, fieldlen));
+                if (!c)
+                        continue;
+
+                /* Only the first value is recorded if a field is set multiple times */
+                if (c->pending)
+                        continue;
+
+                /* The data returned by the enumeration is only valid until the next call, hence copy it */
+                c->pending = true;
+                c->pending_offset = w->scratch_size;
+                c->pending_size = length - fieldlen - 1;
+
+                r = buffer_append(&w->scratch, &w->scratch_size, eq + 1, c->pending_size);
+                if (r < 0)
+                        return log_oom();
+        }
+        if (r == -EBADMSG) {
+                /* The row is not committed, the slot is simply reused by the next entry */
+                log_debug_errno(r, "Skipping message we can't read: %m");
+                return 0;
+        }
+        if (r < 0)
+                return log_error_errno(r, "Failed to read journal entry: %m");
+
+        r = journal_column_put_value(w->columns + COLUMN_BOOT_ID, row, SD_ID128_TO_STRING(boot_id), SD_ID128_STRING_MAX - 1);
+        if (r < 0)
+                return log_error_errno(r, "Failed to add boot ID to row group: %m");
+
+        for (size_t i = _COLUMN_FIXED_MAX; i < w->n_columns; i++) {
+                JournalColumn *c = w->columns + i;
+
+                if (!c->pending) {
+                        c->indexes[row] = 0;
+                        continue;
+                }
+
+                r = journal_column_put_value(c, row,
+                                             c->pending_size > 0 ? w->scratch + c->pending_offset : (const uint8_t*) "",
+                                             c->pending_size);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to add field %s to row group: %m", c->name);
+        }
+
+        w->n_rows++;
+
+        if (w->n_rows < w->max_rows)
+                return 0;
+
+        r = journal_columnar_writer_flush(w, f);
+        if (r < 0)
+                return log_error_errno(r, "Failed to write row group: %m");
+
+        return 1;
+}
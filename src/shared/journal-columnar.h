@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+#pragma once
+
+#include <stdio.h>
+
+#include "sd-journal.h"
+
+#include "compress.h"
+#include "macro.h"
+
+/* Writer for the columnar journal export format, see docs/JOURNAL_EXPORT_FORMATS.md for details. Entries are
+ * buffered in memory and written out as self-contained, dictionary encoded and compressed row groups. */
+
+#define JOURNAL_COLUMNAR_MAGIC "JCRG"
+#define JOURNAL_COLUMNAR_VERSION 1U
+#define JOURNAL_COLUMNAR_ROWS_DEFAULT 4096U
+
+typedef enum JournalColumnType {
+        JOURNAL_COLUMN_DELTA,      /* le64 values, each stored as difference to the previous row */
+        JOURNAL_COLUMN_DICTIONARY, /* dictionary of distinct values, plus a le32 index per row */
+        _JOURNAL_COLUMN_TYPE_MAX,
+        _JOURNAL_COLUMN_TYPE_INVALID = -EINVAL,
+} JournalColumnType;
+
+typedef struct JournalColumnarWriter JournalColumnarWriter;
+
+int journal_columnar_writer_new(
+                char **fields,
+                size_t max_rows,
+                Compression compression,
+                JournalColumnarWriter **ret);
+JournalColumnarWriter* journal_columnar_writer_free(JournalColumnarWriter *w);
+DEFINE_TRIVIAL_CLEANUP_FUNC(JournalColumnarWriter*, journal_columnar_writer_free);
+
+size_t journal_columnar_writer_pending(JournalColumnarWriter *w);
+
+/* Adds the current entry of the journal to the row group. Once the row group is full it is written to 'f'
+ * and 1 is returned, 0 otherwise. */
+int journal_columnar_writer_add_entry(JournalColumnarWriter *w, sd_journal *j, FILE *f);
+
+/* Writes out the pending rows, if there are any. Returns 1 if a row group was written, 0 otherwise. */
+int journal_columnar_writer_flush(JournalColumnarWriter *w, FILE *f);
@@ -20,6 +20,7 @@
 #include "hostname-util.h"
 #include "id128-util.h"
 #include "io-util.h"
+#include "journal-columnar.h"
 #include "journal-internal.h"
 #include "journal-util.h"
 #include "json.h"
@@ -1265,6 +1266,49 @@ static int output_cat(
         return 0;
 }
 
+static int output_columnar(
+                FILE *f,
+                sd_journal *j,
+                OutputMode mode,
+                unsigned n_columns,
+                OutputFlags flags,
+                const Set *output_fields,
+                const size_t highlight[2],
+                const dual_timestamp *ts,
+                const sd_id128_t *boot_id,
+                const dual_timestamp *previous_ts,
+                const sd_id128_t *previous_boot_id) {
+
+        _cleanup_(journal_columnar_writer_freep) JournalColumnarWriter *w = NULL;
+        _cleanup_free_ char **fields = NULL;
+        int r;
+
+        assert(j);
+
+        /* This is only used when a single entry is shown, callers that show many entries, i.e.
+         * show_journal() and journalctl, keep one JournalColumnarWriter for the whole run instead. Each
+         * entry hence becomes a row group of its own. As the output fields are passed as a Set here, they
+         * are written in alphabetical order. */
+
+        if (!set_isempty(output_fields)) {
+                fields = set_get_strv((Set*) output_fields);
+                if (!fields)
+                        return log_oom();
+
+                strv_sort(fields);
+        }
+
+        r = journal_columnar_writer_new(fields, 1, DEFAULT_COMPRESSION, &w);
+        if (r < 0)
+                return log_error_errno(r, "Failed to allocate columnar writer: %m");
+
+        r = journal_columnar_writer_add_entry(w, j, f);
+        if (r < 0)
+                return r;
+
+        return 0;
+}
+
 static int get_dual_timestamp(sd_journal *j, dual_timestamp *ret_ts, sd_id128_t *ret_boot_id) {
         const void *data;
         _cleanup_free_ char *realtime = NULL, *monotonic = NULL;
@@ -1347,6 +1391,7 @@ static int (*output_funcs[_OUTPUT_MODE_MAX])(
         [OUTPUT_JSON_SEQ]          = output_json,
         [OUTPUT_CAT]               = output_cat,
         [OUTPUT_WITH_UNIT]         = output_short,
+        [OUTPUT_COLUMNAR]          = output_columnar,
 };
 
 int show_journal_entry(
@@ -1423,6 +1468,7 @@ int show_journal(
                 OutputFlags flags,
                 bool *ellipsized) {
 
+        _cleanup_(journal_columnar_writer_freep) JournalColumnarWriter *columnar = NULL;
         int r;
         unsigned line = 0;
         bool need_seek = false;
@@ -1434,6 +1480,13 @@ int show_journal(
         assert(mode >= 0);
         assert(mode < _OUTPUT_MODE_MAX);
 
+        if (mode == OUTPUT_COLUMNAR) {
+                /* Entries are buffered and written out in row groups */
+                r = journal_columnar_writer_new(NULL, JOURNAL_COLUMNAR_ROWS_DEFAULT, DEFAULT_COMPRESSION, &columnar);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to set up columnar output: %m");
+        }
+
         if (how_many == UINT_MAX)
                 need_seek = true;
         else {
@@ -1477,12 +1530,21 @@ int show_journal(
                 line++;
                 maybe_print_begin_newline(f, &flags);
 
-                r = show_journal_entry(f, j, mode, n_columns, flags, NULL, NULL, ellipsized,
-                                       &previous_ts, &previous_boot_id);
+                if (columnar)
+                        r = journal_columnar_writer_add_entry(columnar, j, f);
+                else
+                        r = show_journal_entry(f, j, mode, n_columns, flags, NULL, NULL, ellipsized,
+                                               &previous_ts, &previous_boot_id);
                 if (r < 0)
                         return r;
         }
 
+        if (columnar) {
+                r = journal_columnar_writer_flush(columnar, f);
+                if (r < 0)
+                        return log_error_errno(r, "Failed to write row group: %m");
+        }
+
         if (warn_cutoff && line < how_many && not_before > 0) {
                 sd_id128_t boot_id;
                 usec_t cutoff = 0;
@@ -118,6 +118,19 @@ static uint64_t ms_flags_to_mount_attr(unsigned long a) {
 
 static bool skip_mount_set_attr = false;
 
+static bool deny_list_applies(char **deny_list, const char *prefix) {
+        assert(prefix);
+
+        /* Returns true if any entry of the deny list excludes a submount of prefix, i.e. if we have to look
+         * at the individual submounts instead of remounting the whole tree in one go. */
+
+        STRV_FOREACH(i, deny_list)
+                if (!path_equal(*i, prefix) && path_startswith(*i, prefix))
+                        return true;
+
+        return false;
+}
+
 /* Use this function only if you do not have direct access to /proc/self/mountinfo but the caller can open it
  * for you. This is the case when /proc is masked or not mounted. Otherwise, use bind_remount_recursive. */
 int bind_remount_recursive_with_mountinfo(
@@ -134,7 +147,7 @@ int bind_remount_recursive_with_mountinfo(
 
         assert(prefix);
 
-        if ((flags_mask & ~MS_CONVERTIBLE_FLAGS) == 0 && strv_isempty(deny_list) && !skip_mount_set_attr) {
+        if ((flags_mask & ~MS_CONVERTIBLE_FLAGS) == 0 && !deny_list_applies(deny_list, prefix) && !skip_mount_set_attr) {
                 /* Let's take a shortcut for all the flags we know how to convert into mount_setattr() flags */
 
                 if (mount_setattr(AT_FDCWD, prefix, AT_SYMLINK_NOFOLLOW|AT_RECURSIVE,
@@ -312,6 +325,13 @@ int bind_remount_recursive_with_mountinfo(
                         if (r < 0)
                                 return r;
 
+                        /* Sandboxed services typically remount large trees of which many submounts already
+                         * carry the requested flags, don't bother the kernel with those. */
+                        if (((flags ^ new_flags) & flags_mask & ~MS_RELATIME) == 0) {
+                                log_debug("Mount point '%s' already has the requested flags, not remounting.", x);
+                                continue;
+                        }
+
                         /* Now, remount this with the new flags set, but exclude MS_RELATIME from it. (It's
                          * the default anyway, thus redundant, and in userns we'll get an error if we try to
                          * explicitly enable it) */
@@ -2,6 +2,8 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <linux/filter.h>
 #include <linux/seccomp.h>
 #include <stddef.h>
 #include <sys/mman.h>
@@ -17,16 +19,40 @@
 #include "alloc-util.h"
 #include "env-util.h"
 #include "errno-list.h"
+#include "fd-util.h"
 #include "macro.h"
+#include "memfd-util.h"
 #include "namespace-util.h"
 #include "nsflags.h"
 #include "nulstr-util.h"
 #include "process-util.h"
 #include "seccomp-util.h"
 #include "set.h"
+#include "sort-util.h"
 #include "string-util.h"
 #include "strv.h"
 
+typedef struct SeccompSyscallItem {
+        int id;
+        int error;
+} SeccompSyscallItem;
+
+typedef struct SeccompProgram {
+        uint32_t arch;
+        struct sock_fprog fprog;
+} SeccompProgram;
+
+struct SeccompFilterCache {
+        /* The parameters the programs were compiled from */
+        uint32_t default_action;
+        uint32_t action;
+        SeccompSyscallItem *syscalls;
+        size_t n_syscalls;
+
+        SeccompProgram *programs;
+        size_t n_programs;
+};
+
 /* This array will be modified at runtime as seccomp_restrict_archs is called. */
 uint32_t seccomp_local_archs[] = {
 
@@ -1087,6 +1113,46 @@ int seccomp_load_syscall_filter_set(uint32_t default_action, const SyscallFilter
         return 0;
 }
 
+static int seccomp_add_syscall_filter_set_raw(scmp_filter_ctx seccomp, Hashmap* filter, uint32_t action, bool log_missing) {
+        void *syscall_id, *val;
+        int r;
+
+        assert(seccomp);
+
+        HASHMAP_FOREACH_KEY(val, syscall_id, filter) {
+                uint32_t a = action;
+                int id = PTR_TO_INT(syscall_id) - 1;
+                int error = PTR_TO_INT(val);
+
+                if (error == SECCOMP_ERROR_NUMBER_KILL)
+                        a = scmp_act_kill_process();
+#ifdef SCMP_ACT_LOG
+                else if (action == SCMP_ACT_LOG)
+                        a = SCMP_ACT_LOG;
+#endif
+                else if (error >= 0)
+                        a = SCMP_ACT_ERRNO(error);
+
+                r = seccomp_rule_add_exact(seccomp, a, id, 0);
+                if (r < 0) {
+                        /* If the system call is not known on this architecture, then that's
+                         * fine, let's ignore it */
+                        _cleanup_free_ char *n = NULL;
+                        bool ignore;
+
+                        n = seccomp_syscall_resolve_num_arch(SCMP_ARCH_NATIVE, id);
+                        ignore = r == -EDOM;
+                        if (!ignore || log_missing)
+                                log_debug_errno(r, "Failed to add rule for system call %s() / %d%s: %m",
+                                                strna(n), id, ignore ? ", ignoring" : "");
+                        if (!ignore)
+                                return r;
+                }
+        }
+
+        return 0;
+}
+
 int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* filter, uint32_t action, bool log_missing) {
         uint32_t arch;
         int r;
@@ -1099,7 +1165,6 @@ int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* filter
 
         SECCOMP_FOREACH_LOCAL_ARCH(arch) {
                 _cleanup_(seccomp_releasep) scmp_filter_ctx seccomp = NULL;
-                void *syscall_id, *val;
 
                 log_debug("Operating on architecture: %s", seccomp_arch_to_string(arch));
 
@@ -1107,36 +1172,9 @@ int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* filter
                 if (r < 0)
                         return r;
 
-                HASHMAP_FOREACH_KEY(val, syscall_id, filter) {
-                        uint32_t a = action;
-                        int id = PTR_TO_INT(syscall_id) - 1;
-                        int error = PTR_TO_INT(val);
-
-                        if (error == SECCOMP_ERROR_NUMBER_KILL)
-                                a = scmp_act_kill_process();
-#ifdef SCMP_ACT_LOG
-                        else if (action == SCMP_ACT_LOG)
-                                a = SCMP_ACT_LOG;
-#endif
-                        else if (error >= 0)
-                                a = SCMP_ACT_ERRNO(error);
-
-                        r = seccomp_rule_add_exact(seccomp, a, id, 0);
-                        if (r < 0) {
-                                /* If the system call is not known on this architecture, then that's
-                                 * fine, let's ignore it */
-                                _cleanup_free_ char *n = NULL;
-                                bool ignore;
-
-                                n = seccomp_syscall_resolve_num_arch(SCMP_ARCH_NATIVE, id);
-                                ignore = r == -EDOM;
-                                if (!ignore || log_missing)
-                                        log_debug_errno(r, "Failed to add rule for system call %s() / %d%s: %m",
-                                                        strna(n), id, ignore ? ", ignoring" : "");
-                                if (!ignore)
-                                        return r;
-                        }
-                }
+                r = seccomp_add_syscall_filter_set_raw(seccomp, filter, action, log_missing);
+                if (r < 0)
+                        return r;
 
                 r = seccomp_load(seccomp);
                 if (ERRNO_IS_SECCOMP_FATAL(r))
@@ -1149,6 +1187,184 @@ int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* filter
         return 0;
 }
 
+static int seccomp_syscall_item_compare(const SeccompSyscallItem *a, const SeccompSyscallItem *b) {
+        int r;
+
+        r = CMP(a->id, b->id);
+        if (r != 0)
+                return r;
+
+        return CMP(a->error, b->error);
+}
+
+SeccompFilterCache* seccomp_filter_cache_free(SeccompFilterCache *c) {
+        if (!c)
+                return NULL;
+
+        for (size_t i = 0; i < c->n_programs; i++)
+                free(c->programs[i].fprog.filter);
+
+        free(c->programs);
+        free(c->syscalls);
+        return mfree(c);
+}
+
+static int seccomp_export_program(scmp_filter_ctx seccomp, struct sock_fprog *ret) {
+        _cleanup_free_ struct sock_filter *insns = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        struct stat st;
+        ssize_t n;
+        int r;
+
+        assert(seccomp);
+        assert(ret);
+
+        fd = memfd_new("seccomp-bpf");
+        if (fd < 0)
+                return fd;
+
+        r = seccomp_export_bpf(seccomp, fd);
+        if (r < 0)
+                return r;
+
+        if (fstat(fd, &st) < 0)
+                return -errno;
+
+        if (st.st_size <= 0 ||
+            st.st_size % sizeof(struct sock_filter) != 0 ||
+            st.st_size / sizeof(struct sock_filter) > USHRT_MAX)
+                return -EBADMSG;
+
+        insns = malloc(st.st_size);
+        if (!insns)
+                return -ENOMEM;
+
+        n = pread(fd, insns, st.st_size, 0);
+        if (n < 0)
+                return -errno;
+        if (n != st.st_size)
+                return -EIO;
+
+        *ret = (struct sock_fprog) {
+                .len = st.st_size / sizeof(struct sock_filter),
+                .filter = TAKE_PTR(insns),
+        };
+
+        return 0;
+}
+
+int seccomp_filter_cache_update(SeccompFilterCache **cache, uint32_t default_action, Hashmap *filter, uint32_t action) {
+        _cleanup_(seccomp_filter_cache_freep) SeccompFilterCache *c = NULL;
+        _cleanup_free_ SeccompSyscallItem *syscalls = NULL;
+        size_t n_syscalls = 0;
+        void *syscall_id, *val;
+        uint32_t arch;
+        int r;
+
+        assert(cache);
+
+        /* Compiles the same filters seccomp_load_syscall_filter_set_raw() would install into BPF programs,
+         * unless the cache already contains them for exactly this filter. Returns 1 if the programs were
+         * (re)compiled, 0 if the cache was up-to-date. On failure the cache is dropped. */
+
+        if (!hashmap_isempty(filter)) {
+                syscalls = new(SeccompSyscallItem, hashmap_size(filter));
+                if (!syscalls)
+                        return -ENOMEM;
+        }
+
+        HASHMAP_FOREACH_KEY(val, syscall_id, filter)
+                syscalls[n_syscalls++] = (SeccompSyscallItem) {
+                        .id = PTR_TO_INT(syscall_id) - 1,
+                        .error = PTR_TO_INT(val),
+                };
+
+        typesafe_qsort(syscalls, n_syscalls, seccomp_syscall_item_compare);
+
+        if (*cache &&
+            (*cache)->default_action == default_action &&
+            (*cache)->action == action &&
+            (*cache)->n_syscalls == n_syscalls &&
+            memcmp_safe((*cache)->syscalls, syscalls, n_syscalls * sizeof(SeccompSyscallItem)) == 0)
+                return 0;
+
+        *cache = seccomp_filter_cache_free(*cache);
+
+        c = new(SeccompFilterCache, 1);
+        if (!c)
+                return -ENOMEM;
+
+        *c = (SeccompFilterCache) {
+                .default_action = default_action,
+                .action = action,
+                .syscalls = TAKE_PTR(syscalls),
+                .n_syscalls = n_syscalls,
+        };
+
+        if (n_syscalls > 0 || default_action != SCMP_ACT_ALLOW)
+                SECCOMP_FOREACH_LOCAL_ARCH(arch) {
+                        _cleanup_(seccomp_releasep) scmp_filter_ctx seccomp = NULL;
+
+                        r = seccomp_init_for_arch(&seccomp, arch, default_action);
+                        if (r < 0)
+                                return r;
+
+                        r = seccomp_add_syscall_filter_set_raw(seccomp, filter, action, false);
+                        if (r < 0)
+                                return r;
+
+                        if (!GREEDY_REALLOC(c->programs, c->n_programs + 1))
+                                return -ENOMEM;
+
+                        r = seccomp_export_program(seccomp, &c->programs[c->n_programs].fprog);
+                        if (r < 0)
+                                return r;
+
+                        c->programs[c->n_programs++].arch = arch;
+                }
+
+        *cache = TAKE_PTR(c);
+        return 1;
+}
+
+static bool seccomp_local_arch_is_active(uint32_t arch) {
+        uint32_t a;
+
+        SECCOMP_FOREACH_LOCAL_ARCH(a)
+                if (a == arch)
+                        return true;
+
+        return false;
+}
+
+int seccomp_filter_cache_load(const SeccompFilterCache *c) {
+        assert(c);
+
+        /* Installs the precompiled programs, with the same semantics as seccomp_load_syscall_filter_set_raw(),
+         * but without building and compiling the filters again. */
+
+        for (size_t i = 0; i < c->n_programs; i++) {
+                const SeccompProgram *p = c->programs + i;
+
+                /* seccomp_restrict_archs() might have blocked this architecture since the programs were
+                 * compiled, in which case seccomp_load_syscall_filter_set_raw() would skip it too. */
+                if (!seccomp_local_arch_is_active(p->arch))
+                        continue;
+
+                log_debug("Operating on architecture: %s", seccomp_arch_to_string(p->arch));
+
+                if (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &p->fprog, 0, 0) < 0) {
+                        if (ERRNO_IS_SECCOMP_FATAL(errno))
+                                return -errno;
+
+                        log_debug_errno(errno, "Failed to install system call filter for architecture %s, skipping: %m",
+                                        seccomp_arch_to_string(p->arch));
+                }
+        }
+
+        return 0;
+}
+
 int seccomp_parse_syscall_filter(
                 const char *name,
                 int errno_num,
@@ -74,6 +74,16 @@ int seccomp_add_syscall_filter_item(
                 char ***added);
 
 int seccomp_load_syscall_filter_set(uint32_t default_action, const SyscallFilterSet *set, uint32_t action, bool log_missing);
+/* The BPF programs seccomp_load_syscall_filter_set_raw() would load for the local architectures, so that they
+ * can be compiled once and then installed repeatedly. */
+typedef struct SeccompFilterCache SeccompFilterCache;
+
+SeccompFilterCache* seccomp_filter_cache_free(SeccompFilterCache *c);
+DEFINE_TRIVIAL_CLEANUP_FUNC(SeccompFilterCache*, seccomp_filter_cache_free);
+
+int seccomp_filter_cache_update(SeccompFilterCache **cache, uint32_t default_action, Hashmap *filter, uint32_t action);
+int seccomp_filter_cache_load(const SeccompFilterCache *c);
+
 int seccomp_load_syscall_filter_set_raw(uint32_t default_action, Hashmap* set, uint32_t action, bool log_missing);
 
 typedef enum SeccompParseFlags {
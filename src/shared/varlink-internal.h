@@ -8,3 +8,4 @@
 
 int varlink_server_serialize(VarlinkServer *s, FILE *f, FDSet *fds);
 int varlink_server_deserialize_one(VarlinkServer *s, const char *value, FDSet *fds);
+bool varlink_server_contains_socket(VarlinkServer *s, const char *address);
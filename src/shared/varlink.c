@@ -10,6 +10,7 @@
 #include "hashmap.h"
 #include "io-util.h"
 #include "list.h"
+#include "path-util.h"
 #include "process-util.h"
 #include "selinux-util.h"
 #include "serialize.h"
@@ -1123,6 +1124,19 @@ int varlink_get_events(Varlink *v) {
         return ret;
 }
 
+int varlink_get_output_buffer_size(Varlink *v, size_t *ret) {
+        assert_return(v, -EINVAL);
+        assert_return(ret, -EINVAL);
+
+        if (v->state == VARLINK_DISCONNECTED)
+                return varlink_log_errno(v, SYNTHETIC_ERRNO(ENOTCONN), "Not connected.");
+
+        /* Returns how much data is queued but not written to the socket yet. Useful for servers generating
+         * a lot of replies, to decide when to generate more. */
+        *ret = v->output_buffer_size;
+        return 0;
+}
+
 int varlink_get_timeout(Varlink *v, usec_t *ret) {
         assert_return(v, -EINVAL);
 
@@ -2615,6 +2629,17 @@ int varlink_server_serialize(VarlinkServer *s, FILE *f, FDSet *fds) {
         return 0;
 }
 
+bool varlink_server_contains_socket(VarlinkServer *s, const char *address) {
+        assert(s);
+        assert(address);
+
+        LIST_FOREACH(sockets, ss, s->sockets)
+                if (ss->address && path_equal(ss->address, address))
+                        return true;
+
+        return false;
+}
+
 int varlink_server_deserialize_one(VarlinkServer *s, const char *value, FDSet *fds) {
         _cleanup_(varlink_server_socket_freep) VarlinkServerSocket *ss = NULL;
         _cleanup_free_ char *address = NULL;
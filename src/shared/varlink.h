@@ -63,6 +63,7 @@ Varlink* varlink_unref(Varlink *v);
 int varlink_get_fd(Varlink *v);
 int varlink_get_events(Varlink *v);
 int varlink_get_timeout(Varlink *v, usec_t *ret);
+int varlink_get_output_buffer_size(Varlink *v, size_t *ret);
 
 int varlink_attach_event(Varlink *v, sd_event *e, int64_t priority);
 void varlink_detach_event(Varlink *v);
@@ -174,3 +175,4 @@ DEFINE_TRIVIAL_CLEANUP_FUNC(VarlinkServer *, varlink_server_unref);
 #define VARLINK_ERROR_INVALID_PARAMETER "org.varlink.service.InvalidParameter"
 #define VARLINK_ERROR_SUBSCRIPTION_TAKEN "org.varlink.service.SubscriptionTaken"
 #define VARLINK_ERROR_PERMISSION_DENIED "org.varlink.service.PermissionDenied"
+#define VARLINK_ERROR_EXPECTED_MORE "org.varlink.service.ExpectedMore"
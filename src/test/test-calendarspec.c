@@ -225,6 +225,45 @@ TEST(calendar_spec_next) {
         /* Check that we don't start looping if mktime() moves us backwards */
         test_next("Sun *-*-* 01:00:00 Europe/Dublin", "", 1616412478000000, 1617494400000000);
         test_next("Sun *-*-* 01:00:00 Europe/Dublin", "IST", 1616412478000000, 1617494400000000);
+        /* Check end-of-month and weekday calculations across leap years and months */
+        test_next("*-02~01 UTC", "", 1704067200000000, 1709164800000000);
+        test_next("*-*~03 UTC", "", 1675209600000000, 1677369600000000);
+        test_next("Fri *-*-13 00:00:00 UTC", "", 1672531200000000, 1673568000000000);
+        test_next("Fri *-*-13 00:00:00 UTC", "", 1673654400000000, 1697155200000000);
+        test_next("Fri *-*-13 00:00:00", "Europe/Berlin", 1673654400000000, 1697148000000000);
+}
+
+TEST(calendar_spec_next_benchmark) {
+        static const char * const specs[] = {
+                "*-*-* *:00/15:00",
+                "Mon..Fri *-*-* 09:30:00",
+                "*-*~01 23:59:00",
+                "Fri *-*-13 00:00:00",
+                "Sat,Sun *-*-1..7 04:00:00 Europe/Berlin",
+        };
+        unsigned iterations = slow_tests_enabled() ? 100000 : 1000;
+
+        for (size_t i = 0; i < ELEMENTSOF(specs); i++) {
+                CalendarSpec *c;
+                usec_t t, q, u;
+
+                assert_se(calendar_spec_from_string(specs[i], &c) >= 0);
+
+                /* Specs with a time zone fork for every call, hence keep them short */
+                unsigned n = isempty(c->timezone) ? iterations : iterations / 100 + 1;
+
+                t = now(CLOCK_MONOTONIC);
+
+                /* Start from a different hour of 2023 each time */
+                for (unsigned j = 0; j < n; j++)
+                        assert_se(calendar_spec_next_usec(c, 1672531200000000 + j * USEC_PER_HOUR, &u) >= 0);
+
+                q = now(CLOCK_MONOTONIC) - t;
+
+                log_info("%s: %u iterations, %lf µs each", specs[i], n, (double) q / n);
+
+                calendar_spec_free(c);
+        }
 }
 
 TEST(calendar_spec_from_string) {
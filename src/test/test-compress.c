@@ -41,7 +41,7 @@ typedef int (decompress_sw_t)(const void *src, uint64_t src_size,
                               const void *prefix, size_t prefix_len,
                               uint8_t extra);
 
-typedef int (compress_stream_t)(int fdf, int fdt, uint64_t max_bytes, uint64_t *uncompressed_size);
+typedef int (compress_stream_t)(int fdf, int fdt, uint64_t max_bytes, uint64_t max_input_bytes, uint64_t *uncompressed_size);
 typedef int (decompress_stream_t)(int fdf, int fdt, uint64_t max_size);
 
 #if HAVE_COMPRESSION
@@ -170,12 +170,14 @@ _unused_ static void test_compress_stream(int flag,
                                           decompress_stream_t decompress,
                                           const char *srcfile) {
 
-        _cleanup_close_ int src = -EBADF, dst = -EBADF, dst2 = -EBADF;
+        _cleanup_close_ int src = -EBADF, dst = -EBADF, dst2 = -EBADF, dst3 = -EBADF, dst4 = -EBADF;
         _cleanup_(unlink_tempfilep) char
                 pattern[] = "/tmp/systemd-test.compressed.XXXXXX",
-                pattern2[] = "/tmp/systemd-test.compressed.XXXXXX";
+                pattern2[] = "/tmp/systemd-test.compressed.XXXXXX",
+                pattern3[] = "/tmp/systemd-test.compressed.XXXXXX",
+                pattern4[] = "/tmp/systemd-test.compressed.XXXXXX";
         int r;
-        _cleanup_free_ char *cmd = NULL, *cmd2 = NULL;
+        _cleanup_free_ char *cmd = NULL, *cmd2 = NULL, *cmd3 = NULL;
         struct stat st = {};
         uint64_t uncompressed_size;
 
@@ -195,7 +197,7 @@ _unused_ static void test_compress_stream(int flag,
 
         assert_se((dst = mkostemp_safe(pattern)) >= 0);
 
-        assert_se(compress(src, dst, -1, &uncompressed_size) == flag);
+        assert_se(compress(src, dst, -1, -1, &uncompressed_size) == flag);
 
         if (cat) {
                 assert_se(asprintf(&cmd, "%s %s | diff %s -", cat, pattern, srcfile) > 0);
@@ -226,6 +228,21 @@ _unused_ static void test_compress_stream(int flag,
         assert_se(lseek(dst2, 0, SEEK_SET) == 0);
         r = decompress(dst, dst2, st.st_size - 1);
         assert_se(r == -EFBIG);
+
+        log_debug("/* test compression with limited input */");
+
+        assert_se(lseek(src, 0, SEEK_SET) == 0);
+        assert_se((dst3 = mkostemp_safe(pattern3)) >= 0);
+        assert_se(compress(src, dst3, -1, st.st_size / 2, &uncompressed_size) == flag);
+        assert_se(uncompressed_size == (uint64_t) st.st_size / 2);
+        assert_se(lseek(src, 0, SEEK_CUR) == st.st_size / 2);
+
+        assert_se((dst4 = mkostemp_safe(pattern4)) >= 0);
+        assert_se(lseek(dst3, 0, SEEK_SET) == 0);
+        assert_se(decompress(dst3, dst4, st.st_size) == 0);
+
+        assert_se(asprintf(&cmd3, "head -c %" PRIu64 " %s | diff - %s", (uint64_t) st.st_size / 2, srcfile, pattern4) > 0);
+        assert_se(system(cmd3) == 0);
 }
 #endif
 
@@ -0,0 +1,225 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include "core-varlink.h"
+#include "manager.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "service.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+#include "varlink.h"
+#include "varlink-internal.h"
+
+typedef struct ListUnitsResult {
+        bool done;
+        char *error_id;
+        char **ids;
+        size_t n_fields_max;
+} ListUnitsResult;
+
+static void list_units_result_done(ListUnitsResult *r) {
+        assert(r);
+
+        r->error_id = mfree(r->error_id);
+        r->ids = strv_free(r->ids);
+}
+
+static int reply_list_units(Varlink *link, JsonVariant *parameters, const char *error_id, VarlinkReplyFlags flags, void *userdata) {
+        ListUnitsResult *r = ASSERT_PTR(userdata);
+
+        if (error_id)
+                assert_se(free_and_strdup(&r->error_id, error_id) >= 0);
+        else {
+                JsonVariant *id;
+
+                assert_se(id = json_variant_by_key(parameters, "id"));
+                assert_se(strv_extend(&r->ids, json_variant_string(id)) >= 0);
+
+                r->n_fields_max = MAX(r->n_fields_max, json_variant_elements(parameters) / 2);
+        }
+
+        if (!FLAGS_SET(flags, VARLINK_REPLY_CONTINUES))
+                r->done = true;
+
+        return 0;
+}
+
+static void list_units(Manager *m, const char *address, bool more, JsonVariant *parameters, ListUnitsResult *ret) {
+        _cleanup_(varlink_close_unrefp) Varlink *link = NULL;
+
+        assert_se(varlink_connect_address(&link, address) >= 0);
+        varlink_set_userdata(link, ret);
+        assert_se(varlink_bind_reply(link, reply_list_units) >= 0);
+        assert_se(varlink_attach_event(link, m->event, SD_EVENT_PRIORITY_NORMAL) >= 0);
+
+        if (more)
+                assert_se(varlink_observe(link, "io.systemd.Manager.ListUnits", parameters) >= 0);
+        else
+                assert_se(varlink_invoke(link, "io.systemd.Manager.ListUnits", parameters) >= 0);
+
+        while (!ret->done)
+                assert_se(sd_event_run(m->event, UINT64_MAX) >= 0);
+}
+
+int main(int argc, char *argv[]) {
+        _cleanup_(rm_rf_physical_and_freep) char *runtime_dir = NULL, *tmpdir = NULL;
+        _cleanup_(manager_freep) Manager *m = NULL;
+        _cleanup_(varlink_server_unrefp) VarlinkServer *s = NULL;
+        _cleanup_free_ char *unit_dir = NULL, *address = NULL;
+        Unit *a, *b;
+        int r;
+
+        test_setup_logging(LOG_DEBUG);
+
+        r = enter_cgroup_subroot(NULL);
+        if (r == -ENOMEDIUM)
+                return log_tests_skipped("cgroupfs not available");
+
+        assert_se(get_testdata_dir("units", &unit_dir) >= 0);
+        assert_se(set_unit_path(unit_dir) >= 0);
+        assert_se(runtime_dir = setup_fake_runtime_dir());
+
+        r = manager_new(LOOKUP_SCOPE_USER, MANAGER_TEST_RUN_BASIC, &m);
+        if (manager_errno_skip_test(r))
+                return log_tests_skipped_errno(r, "manager_new");
+        assert_se(r >= 0);
+        assert_se(manager_startup(m, NULL, NULL, NULL) >= 0);
+
+        assert_se(manager_load_startable_unit_or_warn(m, "a.service", NULL, &a) >= 0);
+        assert_se(manager_load_startable_unit_or_warn(m, "b.service", NULL, &b) >= 0);
+
+        assert_se(mkdtemp_malloc("/tmp/test-core-varlink-XXXXXX", &tmpdir) >= 0);
+        assert_se(address = path_join(tmpdir, "io.systemd.Manager"));
+
+        assert_se(manager_setup_varlink_server(m, &s) >= 0);
+        assert_se(varlink_server_listen_address(s, address, 0600) >= 0);
+        assert_se(varlink_server_attach_event(s, m->event, SD_EVENT_PRIORITY_NORMAL) >= 0);
+
+        assert_se(varlink_server_contains_socket(s, address));
+        assert_se(!varlink_server_contains_socket(s, VARLINK_ADDR_PATH_MANAGER_SYSTEM));
+
+        /* Only the requested fields are returned, one reply per matching unit */
+        {
+                _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+                _cleanup_(list_units_result_done) ListUnitsResult result = {};
+
+                assert_se(json_build(&v, JSON_BUILD_OBJECT(
+                                                     JSON_BUILD_PAIR_STRV("patterns", STRV_MAKE("a.service", "b.service")),
+                                                     JSON_BUILD_PAIR_STRV("fields", STRV_MAKE("id")))) >= 0);
+
+                list_units(m, address, /* more= */ true, v, &result);
+
+                assert_se(!result.error_id);
+                strv_sort(result.ids);
+                assert_se(strv_equal(result.ids, STRV_MAKE("a.service", "b.service")));
+                assert_se(result.n_fields_max == 1);
+        }
+
+        /* Without a field list, all fields are returned */
+        {
+                _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+                _cleanup_(list_units_result_done) ListUnitsResult result = {};
+
+                assert_se(json_build(&v, JSON_BUILD_OBJECT(
+                                                     JSON_BUILD_PAIR_STRV("patterns", STRV_MAKE("a.service")))) >= 0);
+
+                list_units(m, address, /* more= */ true, v, &result);
+
+                assert_se(!result.error_id);
+                assert_se(strv_equal(result.ids, STRV_MAKE("a.service")));
+                assert_se(result.n_fields_max > 1);
+        }
+
+        /* The state filter matches the load, active and sub state */
+        {
+                _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+                _cleanup_(list_units_result_done) ListUnitsResult result = {};
+
+                assert_se(json_build(&v, JSON_BUILD_OBJECT(
+                                                     JSON_BUILD_PAIR_STRV("states", STRV_MAKE("inactive")),
+                                                     JSON_BUILD_PAIR_STRV("patterns", STRV_MAKE("a.service", "b.service")),
+                                                     JSON_BUILD_PAIR_STRV("fields", STRV_MAKE("id", "activeState")))) >= 0);
+
+                list_units(m, address, /* more= */ true, v, &result);
+
+                assert_se(!result.error_id);
+                strv_sort(result.ids);
+                assert_se(strv_equal(result.ids, STRV_MAKE("a.service", "b.service")));
+                assert_se(result.n_fields_max == 2);
+        }
+
+        {
+                _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+                _cleanup_(list_units_result_done) ListUnitsResult result = {};
+
+                assert_se(json_build(&v, JSON_BUILD_OBJECT(
+                                                     JSON_BUILD_PAIR_STRV("states", STRV_MAKE("active")),
+                                                     JSON_BUILD_PAIR_STRV("patterns", STRV_MAKE("a.service", "b.service")))) >= 0);
+
+                list_units(m, address, /* more= */ true, v, &result);
+
+                assert_se(streq_ptr(result.error_id, "io.systemd.Manager.NoSuchUnit"));
+                assert_se(strv_isempty(result.ids));
+        }
+
+        /* Unknown fields are refused */
+        {
+                _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+                _cleanup_(list_units_result_done) ListUnitsResult result = {};
+
+                assert_se(json_build(&v, JSON_BUILD_OBJECT(
+                                                     JSON_BUILD_PAIR_STRV("fields", STRV_MAKE("id", "foobar")))) >= 0);
+
+                list_units(m, address, /* more= */ true, v, &result);
+
+                assert_se(streq_ptr(result.error_id, VARLINK_ERROR_INVALID_PARAMETER));
+        }
+
+        /* The method must be called with the "more" flag */
+        {
+                _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+                _cleanup_(list_units_result_done) ListUnitsResult result = {};
+
+                assert_se(json_build(&v, JSON_BUILD_EMPTY_OBJECT) >= 0);
+
+                list_units(m, address, /* more= */ false, v, &result);
+
+                assert_se(streq_ptr(result.error_id, VARLINK_ERROR_EXPECTED_MORE));
+        }
+
+        /* Replies exceeding the connection's buffer limit in total are generated as the client reads them */
+        {
+                _cleanup_(json_variant_unrefp) JsonVariant *v = NULL;
+                _cleanup_(list_units_result_done) ListUnitsResult result = {};
+                _cleanup_free_ char *description = NULL;
+
+                assert_se(description = strrep("x", 64U*1024U));
+
+                for (unsigned i = 0; i < 300; i++) {
+                        _cleanup_free_ char *name = NULL;
+                        Unit *u;
+
+                        assert_se(asprintf(&name, "many-%u.service", i) >= 0);
+                        assert_se(unit_new_for_name(m, sizeof(Service), name, &u) >= 0);
+                        assert_se(unit_set_description(u, description) >= 0);
+                }
+
+                assert_se(json_build(&v, JSON_BUILD_OBJECT(
+                                                     JSON_BUILD_PAIR_STRV("patterns", STRV_MAKE("many-*.service")),
+                                                     JSON_BUILD_PAIR_STRV("fields", STRV_MAKE("id", "description")))) >= 0);
+
+                /* Don't log all the messages */
+                log_set_max_level(LOG_INFO);
+                list_units(m, address, /* more= */ true, v, &result);
+                log_set_max_level(LOG_DEBUG);
+
+                assert_se(!result.error_id);
+                assert_se(strv_length(result.ids) == 300);
+                assert_se(result.n_fields_max == 2);
+                assert_se(hashmap_isempty(m->varlink_list_units));
+        }
+
+        return 0;
+}
@@ -17,6 +17,7 @@
 #include "macro.h"
 #include "path-util.h"
 #include "rm-rf.h"
+#include "serialize.h"
 #include "string-util.h"
 #include "strv.h"
 #include "tests.h"
@@ -409,6 +410,89 @@ TEST(error_catching) {
         assert_se(r == 42);
 }
 
+TEST(max_parallel) {
+        _cleanup_(rm_rf_physical_and_freep) char *tmpdir = NULL;
+        _cleanup_free_ char *counts = NULL;
+        const char *name;
+        int r;
+
+        assert_se(mkdtemp_malloc("/tmp/test-exec-util.XXXXXXX", &tmpdir) >= 0);
+
+        const char *dirs[] = { tmpdir, NULL };
+
+        /* Each script records how many scripts are running while it is */
+        for (unsigned i = 0; i < 4; i++) {
+                name = strjoina(tmpdir, "/", CHAR_TO_STR('1' + i), "-script");
+
+                assert_se(write_string_file(name,
+                                            "#!/bin/sh\n"
+                                            "d=$(dirname $0)\n"
+                                            "touch $d/running.$$\n"
+                                            "sleep 0.2\n"
+                                            "ls $d | grep -c '^running' >>$d/counts\n"
+                                            "rm $d/running.$$\n"
+                                            "touch $d/done.$(basename $0)\n",
+                                            WRITE_STRING_FILE_CREATE) == 0);
+                assert_se(chmod(name, 0755) == 0);
+        }
+
+        /* The first one to run fails, that must neither stop the others from being started, nor be lost */
+        name = strjoina(tmpdir, "/0-fail");
+        assert_se(write_string_file(name, "#!/bin/sh\nexit 42\n", WRITE_STRING_FILE_CREATE) == 0);
+        assert_se(chmod(name, 0755) == 0);
+
+        if (access(name, X_OK) < 0 && ERRNO_IS_PRIVILEGE(errno))
+                return;
+
+        assert_se(setenv("SYSTEMD_EXEC_DIR_MAX_PARALLEL", "1", 1) >= 0);
+        r = execute_directories(dirs, DEFAULT_TIMEOUT_USEC, NULL, NULL, NULL, NULL, EXEC_DIR_PARALLEL);
+        assert_se(unsetenv("SYSTEMD_EXEC_DIR_MAX_PARALLEL") >= 0);
+        assert_se(r == 42);
+
+        assert_se(chdir(tmpdir) >= 0);
+        assert_se(access("done.1-script", F_OK) >= 0);
+        assert_se(access("done.2-script", F_OK) >= 0);
+        assert_se(access("done.3-script", F_OK) >= 0);
+        assert_se(access("done.4-script", F_OK) >= 0);
+
+        assert_se(read_full_file("counts", &counts, NULL) >= 0);
+        assert_se(streq(counts, "1\n1\n1\n1\n"));
+}
+
+TEST(runtimes) {
+        _cleanup_(rm_rf_physical_and_freep) char *tmpdir = NULL;
+        _cleanup_strv_free_ char **paths = NULL;
+        _cleanup_close_ int fd = -EBADF;
+        ExecDirRuntime *runtimes;
+        size_t n;
+
+        assert_se(mkdtemp_malloc("/tmp/test-exec-util.XXXXXXX", &tmpdir) >= 0);
+
+        assert_se(paths = strv_new(strjoina(tmpdir, "/slow script"), strjoina(tmpdir, "/fast")));
+
+        assert_se(write_string_file(paths[0], "#!/bin/sh\nsleep 0.2\n", WRITE_STRING_FILE_CREATE) == 0);
+        assert_se(chmod(paths[0], 0755) == 0);
+        assert_se(write_string_file(paths[1], "#!/bin/sh\nexit 1\n", WRITE_STRING_FILE_CREATE) == 0);
+        assert_se(chmod(paths[1], 0755) == 0);
+
+        if (access(paths[0], X_OK) < 0 && ERRNO_IS_PRIVILEGE(errno))
+                return;
+
+        assert_se((fd = open_serialization_fd("runtimes")) >= 0);
+
+        /* Failing executables are recorded too, in the order the executables finish */
+        assert_se(execute_strv("test", paths, DEFAULT_TIMEOUT_USEC, NULL, NULL, NULL, NULL,
+                               EXEC_DIR_PARALLEL|EXEC_DIR_IGNORE_ERRORS, fd) >= 0);
+        assert_se(exec_dir_runtimes_read(fd, &runtimes, &n) >= 0);
+
+        assert_se(n == 2);
+        assert_se(streq(runtimes[0].path, paths[1]));
+        assert_se(streq(runtimes[1].path, paths[0]));
+        assert_se(runtimes[1].usec >= 200 * USEC_PER_MSEC);
+
+        exec_dir_runtime_free_many(runtimes, n);
+}
+
 TEST(exec_command_flags_from_strv) {
         ExecCommandFlags flags = 0;
         char **valid_strv = STRV_MAKE("no-env-expand", "no-setuid", "ignore-failure");
@@ -434,12 +518,12 @@ TEST(exec_command_flags_to_strv) {
         ExecCommandFlags flags = 0;
         int r;
 
-        flags |= (EXEC_COMMAND_AMBIENT_MAGIC|EXEC_COMMAND_NO_ENV_EXPAND|EXEC_COMMAND_IGNORE_FAILURE);
+        flags |= (EXEC_COMMAND_AMBIENT_MAGIC|EXEC_COMMAND_NO_ENV_EXPAND|EXEC_COMMAND_IGNORE_FAILURE|EXEC_COMMAND_PARALLEL);
 
         r = exec_command_flags_to_strv(flags, &opts);
 
         assert_se(r == 0);
-        assert_se(strv_equal(opts, STRV_MAKE("ignore-failure", "ambient", "no-env-expand")));
+        assert_se(strv_equal(opts, STRV_MAKE("ignore-failure", "ambient", "no-env-expand", "parallel")));
 
         r = exec_command_flags_to_strv(0, &empty_opts);
 
@@ -900,6 +900,7 @@ static void test_exec_environment(Manager *m) {
         test(m, "exec-environment.service", 0, CLD_EXITED);
         test(m, "exec-environment-multiple.service", 0, CLD_EXITED);
         test(m, "exec-environment-empty.service", 0, CLD_EXITED);
+        test(m, "exec-environment-pid.service", 0, CLD_EXITED);
 }
 
 static void test_exec_environmentfile(Manager *m) {
@@ -1105,6 +1106,13 @@ static void test_exec_condition(Manager *m) {
         test_service(m, "exec-condition-skip.service", SERVICE_SKIP_CONDITION);
 }
 
+static void test_exec_parallel(Manager *m) {
+        (void) unlink("/tmp/test-exec-parallel");
+
+        test_service(m, "exec-parallel.service", SERVICE_SUCCESS);
+        test_service(m, "exec-parallel-failure.service", SERVICE_FAILURE_EXIT_CODE);
+}
+
 static void test_exec_umask_namespace(Manager *m) {
         /* exec-specifier-credentials-dir.service creates /run/credentials and enables implicit
          * InaccessiblePath= for the directory for all later services with mount namespace. */
@@ -1163,6 +1171,7 @@ int main(int argc, char *argv[]) {
                 entry(test_exec_mount_apivfs),
                 entry(test_exec_noexecpaths),
                 entry(test_exec_oomscoreadjust),
+                entry(test_exec_parallel),
                 entry(test_exec_passenvironment),
                 entry(test_exec_personality),
                 entry(test_exec_privatedevices),
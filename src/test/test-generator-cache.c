@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc-util.h"
+#include "constants.h"
+#include "errno-util.h"
+#include "fileio.h"
+#include "fs-util.h"
+#include "generator-cache.h"
+#include "mkdir.h"
+#include "path-util.h"
+#include "rm-rf.h"
+#include "string-util.h"
+#include "strv.h"
+#include "tests.h"
+#include "tmpfile-util.h"
+
+static void write_executable(const char *path, const char *contents) {
+        assert_se(write_string_file(path, contents, WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_TRUNCATE) >= 0);
+        assert_se(chmod(path, 0755) >= 0);
+}
+
+static char* key(const char *executable, char **envp) {
+        char *k;
+
+        assert_se(generator_cache_key(executable, envp, &k) > 0);
+        assert_se(k);
+        return k;
+}
+
+TEST(generator_cache_key) {
+        _cleanup_(rm_rf_physical_and_freep) char *tmpdir = NULL;
+        _cleanup_free_ char *k1 = NULL, *k2 = NULL, *k3 = NULL, *k4 = NULL, *k5 = NULL, *k6 = NULL;
+        const char *gen, *inputs, *file, *dir;
+        char *k;
+
+        assert_se(mkdtemp_malloc("/tmp/test-generator-cache.XXXXXX", &tmpdir) >= 0);
+
+        gen = strjoina(tmpdir, "/gen");
+        inputs = strjoina(gen, GENERATOR_INPUTS_SUFFIX);
+        file = strjoina(tmpdir, "/input");
+        dir = strjoina(tmpdir, "/input.d");
+
+        write_executable(gen, "#!/bin/sh\n");
+
+        /* Without a declaration the output is never cached */
+        assert_se(generator_cache_key(gen, NULL, &k) == 0);
+        assert_se(!k);
+
+        assert_se(write_string_filef(inputs, WRITE_STRING_FILE_CREATE, "# comment\n\n%s\n%s\n", file, dir) >= 0);
+
+        /* Missing inputs are fine, and the key is stable */
+        k1 = key(gen, NULL);
+        k = key(gen, NULL);
+        assert_se(streq(k1, k));
+        free(k);
+
+        assert_se(write_string_file(file, "a", WRITE_STRING_FILE_CREATE) >= 0);
+        k2 = key(gen, NULL);
+        assert_se(!streq(k1, k2));
+
+        assert_se(write_string_file(file, "b", WRITE_STRING_FILE_TRUNCATE) >= 0);
+        k3 = key(gen, NULL);
+        assert_se(!streq(k2, k3));
+
+        /* Directories are compared by their entries and the contents of the files in them */
+        assert_se(mkdir(dir, 0755) >= 0);
+        k4 = key(gen, NULL);
+        assert_se(!streq(k3, k4));
+
+        assert_se(symlinkat("foo", AT_FDCWD, strjoina(dir, "/link")) >= 0);
+        k5 = key(gen, NULL);
+        assert_se(!streq(k4, k5));
+
+        /* The environment and the generator itself are part of the key too */
+        k = key(gen, STRV_MAKE("SYSTEMD_IN_INITRD=1"));
+        assert_se(!streq(k5, k));
+        free(k);
+
+        write_executable(gen, "#!/bin/sh\nexit 0\n");
+        k6 = key(gen, NULL);
+        assert_se(!streq(k5, k6));
+
+        /* Relative inputs are refused */
+        assert_se(write_string_file(inputs, "input", WRITE_STRING_FILE_TRUNCATE) >= 0);
+        assert_se(generator_cache_key(gen, NULL, &k) == -EINVAL);
+}
+
+static void run_generators(const char *tmpdir, char **executables, char **outputs, int expected) {
+        char *argv[] = { NULL, outputs[0], outputs[1], outputs[2], NULL };
+
+        STRV_FOREACH(o, outputs) {
+                assert_se(rm_rf(*o, REMOVE_ROOT|REMOVE_PHYSICAL|REMOVE_MISSING_OK) >= 0);
+                assert_se(mkdir_p(*o, 0755) >= 0);
+        }
+
+        assert_se(generator_cache_execute(strjoina(tmpdir, "/cache"), executables, DEFAULT_TIMEOUT_USEC,
+                                          argv, NULL, EXEC_DIR_PARALLEL, -EBADF) == expected);
+}
+
+static void assert_runs(const char *tmpdir, const char *name, const char *expected) {
+        _cleanup_free_ char *runs = NULL;
+
+        assert_se(read_full_file(strjoina(tmpdir, "/runs.", name), &runs, NULL) >= 0);
+        assert_se(streq(runs, expected));
+}
+
+TEST(generator_cache_execute) {
+        _cleanup_(rm_rf_physical_and_freep) char *tmpdir = NULL;
+        _cleanup_strv_free_ char **executables = NULL, **outputs = NULL;
+        _cleanup_free_ char *target = NULL;
+        const char *input;
+
+        assert_se(mkdtemp_malloc("/tmp/test-generator-cache.XXXXXX", &tmpdir) >= 0);
+
+        assert_se(executables = strv_new(strjoina(tmpdir, "/cached"), strjoina(tmpdir, "/uncached")));
+        assert_se(outputs = strv_new(strjoina(tmpdir, "/normal"), strjoina(tmpdir, "/early"), strjoina(tmpdir, "/late")));
+        input = strjoina(tmpdir, "/input");
+
+        /* Both record each run, and write a unit and a relative symlink to it into the late dir */
+        STRV_FOREACH(e, executables) {
+                _cleanup_free_ char *name = NULL, *script = NULL;
+
+                assert_se(path_extract_filename(*e, &name) >= 0);
+                assert_se(script = strjoin("#!/bin/sh\n"
+                                           "echo run >>", tmpdir, "/runs.", name, "\n"
+                                           "test -e ", input, " || exit 1\n"
+                                           "echo '[Unit]' >$3/", name, ".service\n"
+                                           "mkdir $3/default.target.wants\n"
+                                           "ln -s ../", name, ".service $3/default.target.wants/\n"));
+                write_executable(*e, script);
+        }
+
+        if (access(executables[0], X_OK) < 0 && ERRNO_IS_PRIVILEGE(errno))
+                return (void) log_tests_skipped("Can't execute files in /tmp/");
+
+        assert_se(write_string_filef(strjoina(executables[0], GENERATOR_INPUTS_SUFFIX),
+                                     WRITE_STRING_FILE_CREATE, "%s\n", input) >= 0);
+        assert_se(write_string_file(input, "1", WRITE_STRING_FILE_CREATE) >= 0);
+
+        run_generators(tmpdir, executables, outputs, 0);
+        assert_runs(tmpdir, "cached", "run\n");
+        assert_runs(tmpdir, "uncached", "run\n");
+
+        /* Second time around only the generator without declaration runs, the output is complete anyway */
+        run_generators(tmpdir, executables, outputs, 0);
+        assert_runs(tmpdir, "cached", "run\n");
+        assert_runs(tmpdir, "uncached", "run\nrun\n");
+
+        assert_se(access(strjoina(tmpdir, "/late/cached.service"), F_OK) >= 0);
+        assert_se(readlink_malloc(strjoina(tmpdir, "/late/default.target.wants/cached.service"), &target) >= 0);
+        assert_se(streq(target, "../cached.service"));
+        assert_se(access(strjoina(tmpdir, "/late/uncached.service"), F_OK) >= 0);
+
+        /* Changing an input invalidates the output */
+        assert_se(write_string_file(input, "2", WRITE_STRING_FILE_TRUNCATE) >= 0);
+        run_generators(tmpdir, executables, outputs, 0);
+        assert_runs(tmpdir, "cached", "run\nrun\n");
+
+        /* Output of failed runs is not cached */
+        assert_se(unlink(input) >= 0);
+        run_generators(tmpdir, executables, outputs, 1);
+        run_generators(tmpdir, executables, outputs, 1);
+        assert_runs(tmpdir, "cached", "run\nrun\nrun\nrun\n");
+}
+
+DEFINE_TEST_MAIN(LOG_DEBUG);
@@ -928,10 +928,13 @@ TEST(hashmap_reserve) {
 
         m = hashmap_new(&string_hash_ops);
 
+        assert_se(hashmap_memory_usage(NULL) == 0);
         assert_se(hashmap_reserve(m, 1) == 0);
         assert_se(hashmap_buckets(m) < 1000);
+        assert_se(hashmap_memory_usage(m) < 1000 * sizeof(void*));
         assert_se(hashmap_reserve(m, 1000) == 0);
         assert_se(hashmap_buckets(m) >= 1000);
+        assert_se(hashmap_memory_usage(m) >= 1000 * 2 * sizeof(void*));
         assert_se(hashmap_isempty(m));
 
         assert_se(hashmap_put(m, "key 1", (void*) "val 1") == 1);
@@ -191,6 +191,15 @@ TEST(config_parse_exec) {
         assert_se(r == 0);
         assert_se(c1->command_next == NULL);
 
+        log_info("/* parallel, only honoured in some settings of services */");
+        r = config_parse_exec(NULL, "fake", 4, "section", 1,
+                              "LValue", 0, "&-/RValue argv0 r1",
+                              &c, u);
+        assert_se(r >= 0);
+        c1 = c1->command_next;
+        check_execcommand(c1, "/RValue", NULL, "argv0", "r1", true);
+        assert_se(!FLAGS_SET(c1->flags, EXEC_COMMAND_PARALLEL));
+
         log_info("/* semicolon */");
         r = config_parse_exec(NULL, "fake", 5, "section", 1,
                               "LValue", 0,
@@ -874,6 +874,61 @@ TEST(load_syscall_filter_set_raw) {
         assert_se(wait_for_terminate_and_check("syscallrawseccomp", pid, WAIT_LOG) == EXIT_SUCCESS);
 }
 
+TEST(filter_cache) {
+        pid_t pid;
+
+        if (!is_seccomp_available()) {
+                log_notice("Seccomp not available, skipping %s", __func__);
+                return;
+        }
+        if (!have_seccomp_privs()) {
+                log_notice("Not privileged, skipping %s", __func__);
+                return;
+        }
+
+        pid = fork();
+        assert_se(pid >= 0);
+
+        if (pid == 0) {
+                _cleanup_(seccomp_filter_cache_freep) SeccompFilterCache *c = NULL;
+                _cleanup_hashmap_free_ Hashmap *s = NULL;
+
+                assert_se(s = hashmap_new(NULL));
+#if defined __NR_access && __NR_access >= 0
+                assert_se(hashmap_put(s, UINT32_TO_PTR(__NR_access + 1), INT_TO_PTR(-1)) >= 0);
+#endif
+#if defined __NR_faccessat && __NR_faccessat >= 0
+                assert_se(hashmap_put(s, UINT32_TO_PTR(__NR_faccessat + 1), INT_TO_PTR(-1)) >= 0);
+#endif
+#if defined __NR_faccessat2 && __NR_faccessat2 >= 0
+                assert_se(hashmap_put(s, UINT32_TO_PTR(__NR_faccessat2 + 1), INT_TO_PTR(-1)) >= 0);
+#endif
+                assert_se(!hashmap_isempty(s));
+
+                assert_se(seccomp_filter_cache_update(&c, SCMP_ACT_ALLOW, s, SCMP_ACT_ERRNO(EUCLEAN)) == 1);
+                assert_se(c);
+                assert_se(seccomp_filter_cache_update(&c, SCMP_ACT_ALLOW, s, SCMP_ACT_ERRNO(EUCLEAN)) == 0);
+
+                /* A different action must invalidate the cached programs */
+                assert_se(seccomp_filter_cache_update(&c, SCMP_ACT_ALLOW, s, SCMP_ACT_ERRNO(EILSEQ)) == 1);
+                assert_se(seccomp_filter_cache_update(&c, SCMP_ACT_ALLOW, s, SCMP_ACT_ERRNO(EUCLEAN)) == 1);
+
+                assert_se(access("/", F_OK) >= 0);
+                assert_se(poll(NULL, 0, 0) == 0);
+
+                assert_se(seccomp_filter_cache_load(c) >= 0);
+
+                assert_se(access("/", F_OK) < 0);
+                assert_se(errno == EUCLEAN);
+
+                assert_se(poll(NULL, 0, 0) == 0);
+
+                _exit(EXIT_SUCCESS);
+        }
+
+        assert_se(wait_for_terminate_and_check("filtercacheseccomp", pid, WAIT_LOG) == EXIT_SUCCESS);
+}
+
 TEST(native_syscalls_filtered) {
         pid_t pid;
 
@@ -1,8 +1,14 @@
 /* SPDX-License-Identifier: LGPL-2.1-or-later */
 
+#include "fd-util.h"
+#include "fileio.h"
+#include "manager-serialize.h"
+#include "path-util.h"
 #include "rm-rf.h"
 #include "service.h"
 #include "tests.h"
+#include "tmpfile-util.h"
+#include "unit-serialize.h"
 
 static char *runtime_dir = NULL;
 
@@ -52,6 +58,177 @@ TEST(deserialize_exec_command) {
         test_deserialize_exec_command_one(m, "control-command", "ExecWhat 11 /a/b c d e", -EINVAL);
 }
 
+static const struct {
+        const char *name;
+        const char *contents;
+} round_trip_units[_UNIT_TYPE_MAX] = {
+        [UNIT_SERVICE]   = { "test-serialize.service",   "[Service]\nExecStart=/bin/true\n" },
+        [UNIT_MOUNT]     = { "tmp-serialize.mount",      "[Mount]\nWhat=tmpfs\nWhere=/tmp/serialize\nType=tmpfs\n" },
+        [UNIT_SWAP]      = { "dev-serialize.swap",       "[Swap]\nWhat=/dev/serialize\n" },
+        [UNIT_SOCKET]    = { "test-serialize.socket",    "[Socket]\nListenStream=/tmp/test-serialize.socket\n" },
+        [UNIT_TARGET]    = { "test-serialize.target",    "[Unit]\nDescription=Test\n" },
+        [UNIT_DEVICE]    = { "dev-serialize.device",     NULL },
+        [UNIT_AUTOMOUNT] = { "tmp-serialize.automount",  "[Automount]\nWhere=/tmp/serialize\n" },
+        [UNIT_TIMER]     = { "test-serialize.timer",     "[Timer]\nOnActiveSec=1h\nUnit=test-serialize.service\n" },
+        [UNIT_PATH]      = { "test-serialize.path",      "[Path]\nPathExists=/tmp/test-serialize\nUnit=test-serialize.service\n" },
+        [UNIT_SLICE]     = { "test-serialize.slice",     "[Slice]\n" },
+        [UNIT_SCOPE]     = { "test-serialize.scope",     NULL },
+};
+
+static char* unit_serialize_to_string(Unit *u) {
+        _cleanup_fdset_free_ FDSet *fds = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        char *buf = NULL;
+        size_t sz;
+
+        assert_se(fds = fdset_new());
+        assert_se(f = open_memstream_unlocked(&buf, &sz));
+        assert_se(unit_serialize(u, f, fds, /* switching_root= */ false) >= 0);
+        assert_se(fflush_and_check(f) >= 0);
+
+        return buf;
+}
+
+static void test_serialize_round_trip_one(bool with_index) {
+        _cleanup_(manager_freep) Manager *m = NULL, *m2 = NULL;
+        _cleanup_fdset_free_ FDSet *fds = NULL;
+        _cleanup_fclose_ FILE *f = NULL;
+        const char *t;
+        Unit *u;
+        int r;
+
+        log_info("/* %s(with_index=%s) */", __func__, yes_no(with_index));
+
+        assert_se(setenv("SYSTEMD_SERIALIZATION_INDEX", one_zero(with_index), 1) >= 0);
+
+        r = manager_new(LOOKUP_SCOPE_USER, MANAGER_TEST_RUN_BASIC, &m);
+        if (manager_errno_skip_test(r))
+                return (void) log_tests_skipped_errno(r, "manager_new");
+        assert_se(r >= 0);
+        assert_se(manager_startup(m, NULL, NULL, NULL) >= 0);
+
+        for (UnitType i = 0; i < _UNIT_TYPE_MAX; i++) {
+                if (!unit_type_supported(i)) {
+                        log_notice("Unit type %s is not supported, not testing it.", unit_type_to_string(i));
+                        continue;
+                }
+
+                assert_se(manager_load_unit(m, round_trip_units[i].name, NULL, NULL, &u) >= 0);
+                assert_se(u->type == i);
+        }
+
+        /* Units without state change timestamp get the current time on deserialization */
+        HASHMAP_FOREACH(u, m->units)
+                dual_timestamp_get(&u->state_change_timestamp);
+
+        assert_se(fds = fdset_new());
+        assert_se(manager_open_serialization(m, &f) >= 0);
+        assert_se(manager_serialize(m, f, fds, /* switching_root= */ false) >= 0);
+        assert_se(fseeko(f, 0, SEEK_SET) >= 0);
+
+        assert_se(manager_new(LOOKUP_SCOPE_USER, MANAGER_TEST_RUN_BASIC, &m2) >= 0);
+        assert_se(manager_startup(m2, NULL, NULL, NULL) >= 0);
+        assert_se(manager_deserialize(m2, f, fds) >= 0);
+
+        HASHMAP_FOREACH_KEY(u, t, m->units) {
+                _cleanup_free_ char *a = NULL, *b = NULL;
+                Unit *u2;
+
+                if (u->id != t)
+                        continue;
+
+                log_debug("Comparing %s", u->id);
+
+                assert_se(u2 = manager_get_unit(m2, u->id));
+                assert_se(a = unit_serialize_to_string(u));
+                assert_se(b = unit_serialize_to_string(u2));
+                assert_se(streq(a, b));
+        }
+
+        assert_se(unsetenv("SYSTEMD_SERIALIZATION_INDEX") >= 0);
+}
+
+TEST(serialize_round_trip) {
+        _cleanup_(rm_rf_physical_and_freep) char *unit_dir = NULL;
+
+        assert_se(mkdtemp_malloc("/tmp/test-unit-serialize.XXXXXX", &unit_dir) >= 0);
+
+        for (UnitType i = 0; i < _UNIT_TYPE_MAX; i++) {
+                assert_se(round_trip_units[i].name);
+                assert_se(unit_name_to_type(round_trip_units[i].name) == i);
+
+                if (round_trip_units[i].contents)
+                        assert_se(write_string_file(
+                                                  prefix_roota(unit_dir, round_trip_units[i].name),
+                                                  round_trip_units[i].contents,
+                                                  WRITE_STRING_FILE_CREATE) >= 0);
+        }
+
+        assert_se(set_unit_path(unit_dir) >= 0);
+
+        test_serialize_round_trip_one(false);
+        test_serialize_round_trip_one(true);
+}
+
+static void write_unit(const char *dir, const char *name, const char *contents) {
+        assert_se(write_string_file(prefix_roota(dir, name), contents,
+                                    WRITE_STRING_FILE_CREATE|WRITE_STRING_FILE_TRUNCATE) >= 0);
+}
+
+TEST(reload_incremental) {
+        _cleanup_(rm_rf_physical_and_freep) char *unit_dir = NULL;
+        _cleanup_(manager_freep) Manager *m = NULL;
+        Unit *a, *b, *t, *b2;
+        int r;
+
+        assert_se(mkdtemp_malloc("/tmp/test-unit-serialize.XXXXXX", &unit_dir) >= 0);
+
+        write_unit(unit_dir, "test-reload-a.service", "[Unit]\nWants=test-reload-b.service\nAfter=test-reload-b.service\n[Service]\nExecStart=/bin/true\n");
+        write_unit(unit_dir, "test-reload-b.service", "[Unit]\nDescription=old\n[Service]\nExecStart=/bin/true\n");
+        write_unit(unit_dir, "test-reload.target", "[Unit]\nWants=test-reload-b.service\n");
+
+        assert_se(set_unit_path(unit_dir) >= 0);
+
+        r = manager_new(LOOKUP_SCOPE_USER, MANAGER_TEST_RUN_BASIC, &m);
+        if (manager_errno_skip_test(r))
+                return (void) log_tests_skipped_errno(r, "manager_new");
+        assert_se(r >= 0);
+        assert_se(manager_startup(m, NULL, NULL, NULL) >= 0);
+
+        assert_se(manager_load_unit(m, "test-reload-a.service", NULL, NULL, &a) >= 0);
+        assert_se(manager_load_unit(m, "test-reload-b.service", NULL, NULL, &b) >= 0);
+        assert_se(manager_load_unit(m, "test-reload.target", NULL, NULL, &t) >= 0);
+        assert_se(streq(b->description, "old"));
+
+        /* Nothing changed, nothing is replaced */
+        assert_se(manager_reload(m, /* full= */ false) >= 0);
+        assert_se(manager_get_unit(m, "test-reload-a.service") == a);
+        assert_se(manager_get_unit(m, "test-reload-b.service") == b);
+        assert_se(manager_get_unit(m, "test-reload.target") == t);
+
+        /* Only the changed unit is loaded again, and the dependencies other units have on it are kept */
+        write_unit(unit_dir, "test-reload-b.service", "[Unit]\nDescription=new\n[Service]\nExecStart=/bin/false\n");
+        assert_se(manager_reload(m, /* full= */ false) >= 0);
+        assert_se(manager_get_unit(m, "test-reload-a.service") == a);
+        assert_se(manager_get_unit(m, "test-reload.target") == t);
+        assert_se(b2 = manager_get_unit(m, "test-reload-b.service"));
+        assert_se(b2->load_state == UNIT_LOADED);
+        assert_se(streq(b2->description, "new"));
+
+        assert_se(hashmap_contains(unit_get_dependencies(a, UNIT_WANTS), b2));
+        assert_se(hashmap_contains(unit_get_dependencies(a, UNIT_AFTER), b2));
+        assert_se(hashmap_contains(unit_get_dependencies(b2, UNIT_BEFORE), a));
+        assert_se(hashmap_contains(unit_get_dependencies(b2, UNIT_WANTED_BY), a));
+        assert_se(hashmap_contains(unit_get_dependencies(t, UNIT_WANTS), b2));
+        assert_se(hashmap_contains(unit_get_dependencies(t, UNIT_AFTER), b2));
+        assert_se(hashmap_contains(unit_get_dependencies(b2, UNIT_BEFORE), t));
+
+        /* Changes of the manager configuration reload everything */
+        assert_se(manager_reload(m, /* full= */ true) >= 0);
+        assert_se(a = manager_get_unit(m, "test-reload-a.service"));
+        assert_se(hashmap_contains(unit_get_dependencies(a, UNIT_AFTER), manager_get_unit(m, "test-reload-b.service")));
+}
+
 static int intro(void) {
         if (enter_cgroup_subroot(NULL) == -ENOMEDIUM)
                 return log_tests_skipped("cgroupfs not available");
@@ -154,6 +154,13 @@ journalctl --disk-usage
 journalctl --dmesg -n 1
 journalctl --fields
 journalctl --list-boots
+# The indexes shown by --list-boots must select the very same boots with -b. Use --directory= to avoid
+# the shortcut -b takes for the current boot.
+JOURNAL_DIR=/var/log/journal
+[[ -d "$JOURNAL_DIR" ]] || JOURNAL_DIR=/run/log/journal
+journalctl --directory="$JOURNAL_DIR" --list-boots -q | while read -r idx boot_id _; do
+    [[ "$(journalctl --directory="$JOURNAL_DIR" -b "$idx" -n 1 -o export | sed -n 's/^_BOOT_ID=//p')" == "$boot_id" ]]
+done
 journalctl --update-catalog
 journalctl --list-catalog
 
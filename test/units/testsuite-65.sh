@@ -11,13 +11,15 @@ export SYSTEMD_LOG_LEVEL=debug
 
 # Sanity checks
 #
-# We can't really test time, blame, critical-chain and plot verbs here, as
-# the testsuite service is a part of the boot transaction, so let's assume
-# they fail
+# We can't really test time, blame, critical-chain, critical-edges and plot
+# verbs here, as the testsuite service is a part of the boot transaction, so
+# let's assume they fail
 systemd-analyze || :
 systemd-analyze time || :
 systemd-analyze blame || :
 systemd-analyze critical-chain || :
+systemd-analyze critical-edges || :
+systemd-analyze critical-edges default.target || :
 systemd-analyze plot >/dev/null || :
 # legacy/deprecated options (moved to systemctl, but still usable from analyze)
 systemd-analyze log-level